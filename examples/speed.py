@@ -25,7 +25,7 @@ HELP_STRING = (
 )
 
 
-def runner(name_list, use_dfs, use_heuristic):
+def runner(name_list, use_dfs, use_heuristic, n_threads, use_coloring):
     print(
         "{:<18s}{:>18s}{:>18s}{:>18s}{:>18s}".format(
             "Name", "#Vertices", "#Edges", "Clique Size", "Time"
@@ -39,6 +39,8 @@ def runner(name_list, use_dfs, use_heuristic):
             upper_bound=65535,
             use_dfs=use_dfs,
             use_heuristic=use_heuristic,
+            n_threads=n_threads,
+            use_coloring=use_coloring,
         )
         t = time.time() - start
         print(
@@ -67,6 +69,20 @@ def main():
         type=int,
         help="Use the depth-first search method (0 or 1)",
     )
+    parser.add_argument(
+        "-t",
+        "--n-threads",
+        default=1,
+        type=int,
+        help="Number of threads for the depth-first search (0 for all cores)",
+    )
+    parser.add_argument(
+        "-c",
+        "--use-coloring",
+        default=False,
+        type=int,
+        help="Prune the depth-first search with a coloring bound (0 or 1)",
+    )
     a = parser.parse_args()
     if a.names == []:
         a.names = sorted(list(BENCHMARK_GRAPHS.keys()))
@@ -76,7 +92,13 @@ def main():
                 x in BENCHMARK_GRAPHS.keys()
             ), "%s is invalid benchmark graph name" % (x)
 
-    runner(a.names, bool(a.use_dfs), bool(a.use_heuristic))
+    runner(
+        a.names,
+        bool(a.use_dfs),
+        bool(a.use_heuristic),
+        a.n_threads,
+        bool(a.use_coloring),
+    )
 
 
 if __name__ == "__main__":
@@ -1,9 +1,11 @@
 #include <detail/graph/graph.h>
 #include <detail/graph/dfs.h>
 #include <detail/mmio.h>
+#include <cstdio>
 #include <cstdlib>
 #include <chrono>
 #include <iostream>
+#include <string>
 
 namespace cmd = cliquematch::detail;
 
@@ -26,14 +28,24 @@ int main(int argc, char* argv[])
     reading_time = static_cast<double>(elapsed.count()) / 1e6;
 
     start = std::chrono::steady_clock::now();
-    cmd::graph* G = new cmd::graph(no_of_vertices, no_of_edges, std::move(edges));
-    // cmd::graph* G = new cmd::graph(no_of_vertices, no_of_edges, edges);
+    cmd::graph* G = new cmd::graph(std::move(edges));
     elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
         std::chrono::steady_clock::now() - start);
     loading_time = static_cast<double>(elapsed.count()) / 1e6;
     std::cout << "File reading took " << reading_time << "s" << std::endl;
     std::cout << "Graph loading took " << loading_time << "s" << std::endl;
 
+    // search on the graph reloaded from a binary file
+    const std::string binfile = std::string(argv[1]) + ".bin";
+    G->to_binary(binfile);
+    delete G;
+    start = std::chrono::steady_clock::now();
+    G = new cmd::graph(binfile);
+    elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start);
+    loading_time = static_cast<double>(elapsed.count()) / 1e6;
+    std::cout << "Binary loading took " << loading_time << "s" << std::endl;
+
     clique_time = G->find_max_cliques(start_vertex, true, false, -1);
     auto ans = G->get_max_clique();
     std::cout << "Clique finding (via heuristic) took " << clique_time
@@ -43,10 +55,17 @@ int main(int argc, char* argv[])
 
     G->CUR_MAX_CLIQUE_SIZE = 1;
     G->CUR_MAX_CLIQUE_LOCATION = start_vertex = 0;
-    clique_time = G->find_max_cliques(start_vertex, false, true, 10);
+    // a tiny time limit pauses the search often, each call continues it
+    u64 n_pauses = 0;
+    clique_time = 0;
+    do
+    {
+        clique_time += G->find_max_cliques(start_vertex, false, true, 1e-4);
+        n_pauses++;
+    } while (start_vertex < G->n_vert);
     ans = G->get_max_clique();
-    std::cout << "Clique finding (via recursion) took " << clique_time
-              << "s\nclique of size: " << ans.size() << "\n";
+    std::cout << "Clique finding (via stack, " << n_pauses << " calls) took "
+              << clique_time << "s\nclique of size: " << ans.size() << "\n";
     for (auto x : ans) { std::cout << x << " "; }
     std::cout << "\n\n";
 
@@ -59,6 +78,24 @@ int main(int argc, char* argv[])
     for (auto x : ans) { std::cout << x << " "; }
     std::cout << "\n\n";
 
+    G->CUR_MAX_CLIQUE_SIZE = 1;
+    G->CUR_MAX_CLIQUE_LOCATION = start_vertex = 0;
+    clique_time = G->find_max_cliques(start_vertex, false, true, -1, 0);
+    ans = G->get_max_clique();
+    std::cout << "Clique finding (via parallel stack) took " << clique_time
+              << "s\nclique of size: " << ans.size() << "\n";
+    for (auto x : ans) { std::cout << x << " "; }
+    std::cout << "\n\n";
+
+    G->CUR_MAX_CLIQUE_SIZE = 1;
+    G->CUR_MAX_CLIQUE_LOCATION = start_vertex = 0;
+    clique_time = G->find_max_cliques(start_vertex, false, true, -1, 1, true);
+    ans = G->get_max_clique();
+    std::cout << "Clique finding (via coloring) took " << clique_time
+              << "s\nclique of size: " << ans.size() << "\n";
+    for (auto x : ans) { std::cout << x << " "; }
+    std::cout << "\n\n";
+
     clique_size = G->CUR_MAX_CLIQUE_SIZE - 1;
     std::cout << "Enumerating all cliques of size " << clique_size << std::endl;
     cmd::CliqueEnumerator en(clique_size);
@@ -74,7 +111,24 @@ int main(int argc, char* argv[])
           std::cout << "\n\n";*/
     }
     std::cout << ct << " cliques of size " << clique_size << std::endl;
+
+    ct = 0;
+    {
+        cmd::ParallelEnumerator pen(*G, clique_size, 0);
+        while (pen.next(ans)) ct += (ans.size() == clique_size);
+    }
+    std::cout << ct << " cliques of size " << clique_size << " (parallel)" << std::endl;
+
+    // every maximum clique is maximal, and has size clique_size + 1
+    ct = 0;
+    {
+        cmd::MaximalEnumerator men(clique_size);
+        while ((start_vertex = men.process_graph(*G)) < G->n_vert)
+            ct += (G->get_max_clique(start_vertex).size() == clique_size + 1);
+    }
+    std::cout << ct << " maximal cliques of size " << clique_size + 1 << std::endl;
     delete G;
+    std::remove(binfile.c_str());
     return 0;
 }
 
@@ -24,19 +24,13 @@ int main(int argc, char** argv)
     auto edges = cmd::mmio4_reader(argv[1], no_of_vertices, no_of_edges);
     weights.reserve(no_of_vertices + 1);
     weights.push_back(0);
-    for (u64 i = 1; i <= no_of_vertices; i++)
-    {
-        weights.push_back(1);
-        edges.first.push_back(i);
-        edges.second.push_back(i);
-    }
+    for (u64 i = 1; i <= no_of_vertices; i++) weights.push_back(1);
     auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
         std::chrono::steady_clock::now() - start);
     auto reading_time = static_cast<double>(elapsed.count()) / 1e6;
 
     start = std::chrono::steady_clock::now();
-    auto G = new cmd::nwgraph(no_of_vertices, no_of_edges, std::move(edges),
-                              std::move(weights));
+    auto G = new cmd::nwgraph(std::move(edges), std::move(weights));
     elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
         std::chrono::steady_clock::now() - start);
     auto loading_time = static_cast<double>(elapsed.count()) / 1e6;
@@ -68,6 +62,39 @@ int main(int argc, char** argv)
     for (auto& x : ans2) { std::cout << x << " "; }
     std::cout << std::endl;
 
+    G->CUR_MAX_CLIQUE_SIZE = 1;
+    G->CUR_MAX_CLIQUE_LOCATION = start_vertex = 0;
+    start = std::chrono::steady_clock::now();
+    G->find_max_cliques(start_vertex, false, true, false, 0);
+    elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start);
+    dfs_time = static_cast<double>(elapsed.count()) / 1e6;
+    ans2 = G->get_max_clique();
+    std::cout << dfs_time << "s: Via parallel DFS we get a clique of weight: "
+              << G->get_clique_weight(ans2) << std::endl;
+    for (auto& x : ans2) { std::cout << x << " "; }
+    std::cout << std::endl;
+
+    // a tiny time limit pauses the search often, each call continues it
+    G->CUR_MAX_CLIQUE_SIZE = 1;
+    G->CUR_MAX_CLIQUE_LOCATION = start_vertex = 0;
+    u64 n_pauses = 0;
+    start = std::chrono::steady_clock::now();
+    do
+    {
+        G->find_max_cliques(start_vertex, false, true, false, 1, 1e-4);
+        n_pauses++;
+    } while (start_vertex < G->n_vert);
+    elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start);
+    dfs_time = static_cast<double>(elapsed.count()) / 1e6;
+    ans2 = G->get_max_clique();
+    std::cout << dfs_time << "s: Via paused DFS (" << n_pauses
+              << " calls) we get a clique of weight: " << G->get_clique_weight(ans2)
+              << std::endl;
+    for (auto& x : ans2) { std::cout << x << " "; }
+    std::cout << std::endl;
+
     double clique_weight = G->get_clique_weight(ans2) - 1;
     std::cout << "Enumerating all cliques of weight " << clique_weight << std::endl;
     cmd::NWCliqueEnumerator en(clique_weight);
@@ -58,7 +58,11 @@ class BuildExt(_build_ext):
 
     c_opts = {
         "msvc": ["/EHsc"],  # msvc has c++11 by default
-        "unix": ["-Wall", "-Wpedantic", "-Wno-unused-result"],
+        "unix": ["-Wall", "-Wpedantic", "-Wno-unused-result", "-pthread"],
+    }
+    l_opts = {
+        "msvc": [],
+        "unix": ["-pthread"],
     }
 
     if platform.system() == "Windows":
@@ -71,6 +75,7 @@ class BuildExt(_build_ext):
     def build_extensions(self):
         ct = self.compiler.compiler_type
         opts = self.c_opts.get(ct)
+        link_opts = self.l_opts.get(ct, [])
         if ct == "unix":
             opts.append("-fvisibility=hidden")
             if self.compiler.compiler_so:
@@ -78,6 +83,7 @@ class BuildExt(_build_ext):
                     self.compiler.compiler_so.remove("-g")
         elif ct == "mingw32":
             opts = self.c_opts.get("unix")
+            link_opts = self.l_opts.get("unix")
 
         eigen_dir = os.environ.get("EIGEN_DIR", "include")
         sample_file = os.path.abspath(os.path.join(eigen_dir, "Eigen", "Dense"))
@@ -95,6 +101,7 @@ class BuildExt(_build_ext):
 
         for ext in self.extensions:
             ext.extra_compile_args = opts
+            ext.extra_link_args = link_opts
         _build_ext.build_extensions(self)
 
 
@@ -110,8 +117,8 @@ setup(
     classifiers=[
     ],
     zip_safe=False,
-    install_requires=["pybind11>=2.2", "numpy>=1.14"],
-    setup_requires=["pybind11>=2.2"],
+    install_requires=["pybind11>=2.6", "numpy>=1.14"],
+    setup_requires=["pybind11>=2.6"],
     ext_modules=ext_modules,
     cmdclass={"build_ext": BuildExt},
 )
@@ -8,6 +8,7 @@
 #include <cmath>
 #include <memory>
 #include <stdexcept>
+#include <chrono>
 #include <pybind11/pybind11.h>
 // need to #include<cmath> before pybind11/numpy otherwise issues with ::hypot
 #include <pybind11/numpy.h>
@@ -25,6 +26,34 @@ namespace core
     template <typename dtype>
     using ndarray =
         pybind11::array_t<dtype, pybind11::array::c_style | pybind11::array::forcecast>;
+
+    // used as the interrupt of a graph whose search runs without the GIL: it
+    // checks for signals (e.g. Ctrl-C) at most once every 50ms, and the search
+    // is paused if one was raised; rethrow() then raises it in Python
+    class SignalCheck
+    {
+       private:
+        std::chrono::steady_clock::time_point last;
+        bool raised;
+
+       public:
+        SignalCheck() : last(std::chrono::steady_clock::now()), raised(false){};
+        bool operator()()
+        {
+            auto now = std::chrono::steady_clock::now();
+            if (raised || now - last < std::chrono::milliseconds(50)) return raised;
+            last = now;
+            pybind11::gil_scoped_acquire acquire;
+            raised = (PyErr_CheckSignals() != 0);
+            return raised;
+        }
+        void rethrow() const
+        {
+            if (!raised) return;
+            pybind11::gil_scoped_acquire acquire;
+            throw pybind11::error_already_set();
+        }
+    };
 }  // namespace core
 }  // namespace cliquematch
 
@@ -13,20 +13,33 @@ namespace core
     namespace py = pybind11;
     // Initialization and Destruction
 
-    pygraph::pygraph()
+    pygraph::pygraph() : search_lock(std::make_shared<std::mutex>())
     {
         nvert = 0;
         nedges = 0;
         current_vertex = 0;
         finished_all = false;
     }
-    void pygraph::load_graph(u64 n_vertices, u64 n_edges,
-                             std::pair<std::vector<u64>, std::vector<u64>>&& edges)
+    void pygraph::load_graph(detail::csrBuilder&& edges, std::vector<u64>&& vmap)
     {
-        this->nvert = n_vertices;
-        this->nedges = n_edges;
-        this->G = std::make_shared<detail::graph>(this->nvert, this->nedges,
-                                                  std::move(edges));
+        // the graph is constructed before taking the lock
+        auto g = std::make_shared<detail::graph>(std::move(edges));
+        std::lock_guard<std::mutex> guard(*search_lock);
+        this->G = std::move(g);
+        this->vmap = std::move(vmap);
+        // subtract 1 because 0 is a sentinel vertex for graph
+        this->nvert = this->G->n_vert - 1;
+        this->nedges = this->G->n_edges();
+    }
+    void pygraph::load_binary(std::string filename)
+    {
+        auto g = std::make_shared<detail::graph>(filename);
+        std::lock_guard<std::mutex> guard(*search_lock);
+        this->G = std::move(g);
+        this->vmap.clear();
+        // subtract 1 because 0 is a sentinel vertex for graph
+        this->nvert = this->G->n_vert - 1;
+        this->nedges = this->G->n_edges();
     }
     void pygraph::check_loaded() const
     {
@@ -37,6 +50,7 @@ namespace core
     // Computation
     void pygraph::reset_search()
     {
+        std::lock_guard<std::mutex> guard(*search_lock);
         this->G->CUR_MAX_CLIQUE_SIZE = 1;
         this->finished_all = false;
         this->current_vertex = 0;
@@ -44,7 +58,21 @@ namespace core
 
     std::vector<u64> pygraph::get_max_clique(u64 lower_bound, u64 upper_bound,
                                              double time_limit, bool use_heuristic,
-                                             bool use_dfs, bool continue_search)
+                                             bool use_dfs, bool continue_search,
+                                             u64 n_threads, bool use_coloring,
+                                             bool use_bitmatrix)
+    {
+        std::lock_guard<std::mutex> guard(*search_lock);
+        return this->find_max_clique(lower_bound, upper_bound, time_limit,
+                                     use_heuristic, use_dfs, continue_search,
+                                     n_threads, use_coloring, use_bitmatrix);
+    }
+
+    std::vector<u64> pygraph::find_max_clique(u64 lower_bound, u64 upper_bound,
+                                              double time_limit, bool use_heuristic,
+                                              bool use_dfs, bool continue_search,
+                                              u64 n_threads, bool use_coloring,
+                                              bool use_bitmatrix)
     {
         if (!continue_search)
             current_vertex = 0;
@@ -57,8 +85,15 @@ namespace core
                                            : this->G->CUR_MAX_CLIQUE_SIZE;
         this->G->CLIQUE_LIMIT =
             upper_bound < this->G->CLIQUE_LIMIT ? upper_bound : this->G->CLIQUE_LIMIT;
-        this->G->find_max_cliques(current_vertex, use_heuristic, use_dfs, time_limit);
-        finished_all = (current_vertex >= nvert);
+        // Ctrl-C pauses the search like the time limit, so it can be continued
+        auto signals = std::make_shared<SignalCheck>();
+        this->G->interrupt = [signals]() { return (*signals)(); };
+        this->G->find_max_cliques(current_vertex, use_heuristic, use_dfs, time_limit,
+                                  n_threads, use_coloring, use_bitmatrix);
+        this->G->interrupt = nullptr;
+        // (the search returns G->n_vert, which is nvert + 1, when it is done)
+        finished_all = (current_vertex >= this->G->n_vert);
+        signals->rethrow();
         auto ans = this->G->get_max_clique();
         if (lower_bound > ans.size())
             throw CM_ERROR("Unable to find maximum clique with given bounds (" +
@@ -68,10 +103,11 @@ namespace core
     }
 
     std::pair<std::vector<u64>, std::vector<u64>> pygraph::get_correspondence2(
-        u64 len1, u64 len2, std::vector<u64> clique)
+        u64 len1, u64 len2, const std::vector<u64>& clique,
+        const std::vector<u64>& vmap)
     {
         std::pair<std::vector<u64>, std::vector<u64>> ans;
-        u64 i, t1, t2;
+        u64 i, v, t1, t2;
         for (i = 0; i < clique.size(); i++)
         {
             if (clique[i] == 0)
@@ -80,8 +116,9 @@ namespace core
                     "Sentinel Value (0) appeared in clique. Increase the time "
                     "limit; if repeated, reset graph\n");
             }
-            t1 = (clique[i] - 1) / len2;
-            t2 = (clique[i] - 1) % len2;
+            v = vmap.empty() ? clique[i] : vmap[clique[i] - 1];
+            t1 = (v - 1) / len2;
+            t2 = (v - 1) % len2;
             ans.first.push_back(t1);
             ans.second.push_back(t2);
         }
@@ -90,12 +127,17 @@ namespace core
 
     std::pair<std::vector<u64>, std::vector<u64>> pygraph::get_correspondence(
         u64 len1, u64 len2, u64 lower_bound, u64 upper_bound, double time_limit,
-        bool use_heuristic, bool use_dfs, bool continue_search)
+        bool use_heuristic, bool use_dfs, bool continue_search, u64 n_threads,
+        bool use_coloring, bool use_bitmatrix)
     {
-        return this->get_correspondence2(
+        // the clique is decoded before load_graph can replace G and vmap
+        std::lock_guard<std::mutex> guard(*search_lock);
+        return get_correspondence2(
             len1, len2,
-            this->get_max_clique(lower_bound, upper_bound, time_limit, use_heuristic,
-                                 use_dfs, continue_search));
+            this->find_max_clique(lower_bound, upper_bound, time_limit, use_heuristic,
+                                  use_dfs, continue_search, n_threads, use_coloring,
+                                  use_bitmatrix),
+            this->vmap);
     }
     // IO
 
@@ -114,31 +156,28 @@ namespace core
     {
         u64 no_of_vertices, no_of_edges;
         pygraph pg;
-        auto edges =
-            detail::mmio4_reader(filename.c_str(), no_of_vertices, no_of_edges);
+        pg.load_graph(
+            detail::mmio4_reader(filename.c_str(), no_of_vertices, no_of_edges));
+        return pg;
+    }
 
-        if (edges.first.size() == 0 || edges.second.size() == 0)
-            throw CM_ERROR("Could not extract edges!!\n");
-        pg.load_graph(no_of_vertices, no_of_edges, std::move(edges));
+    pygraph from_binary(std::string filename)
+    {
+        pygraph pg;
+        pg.load_binary(filename);
         return pg;
     }
 
     pygraph from_edgelist(ndarray<u64> edge_list1, u64 no_of_vertices)
     {
         //	std::cout<<"Constructing graph from the list of edges (Nx2 matrix)\n";
-        u64 no_of_edges = 0;
         u64 v1, v2;
         auto edge_list = edge_list1.unchecked<2>();
-        std::pair<std::vector<u64>, std::vector<u64>> edges;
-        edges.first.resize(no_of_vertices + 1);
-        edges.second.resize(no_of_vertices + 1);
+        py::gil_scoped_release release;  // (edge_list1 keeps the data alive)
+        detail::csrBuilder edges(no_of_vertices);
         pygraph pg;
 
-        for (u64 i = 0; i < edges.first.size(); i++)
-        {
-            edges.first[i] = i;
-            edges.second[i] = i;
-        }
+        // the edges are read twice: once to count, and once to fill
         for (auto i = 0; i < edge_list.shape(0); i++)
         {
             v1 = edge_list(i, 0);
@@ -151,16 +190,13 @@ namespace core
                 throw CM_ERROR(
                     "Vertex numbers must begin at 1, 0 is used as a sentinel value\n");
             }
-            no_of_edges++;
-            edges.first.push_back(v1);
-            edges.second.push_back(v2);
-            edges.first.push_back(v2);
-            edges.second.push_back(v1);
+            edges.count(v1, v2);
         }
+        edges.start_fill();
+        for (auto i = 0; i < edge_list.shape(0); i++)
+            edges.add(edge_list(i, 0), edge_list(i, 1));
 
-        if (edges.first.size() == 0 || edges.second.size() == 0)
-            throw CM_ERROR("Could not extract edges!!\n");
-        pg.load_graph(no_of_vertices, no_of_edges, std::move(edges));
+        pg.load_graph(std::move(edges));
         return pg;
     }
 
@@ -172,33 +208,30 @@ namespace core
             throw CM_ERROR("Adjacency matrix has to be a square matrix!!\n");
         else
         {
+            py::gil_scoped_release release;  // (adjmat1 keeps the data alive)
             u64 no_of_vertices = adjmat.shape(0);
-            u64 no_of_edges = 0;
+            detail::csrBuilder edges(no_of_vertices);
             pygraph pg;
 
-            std::pair<std::vector<u64>, std::vector<u64>> edges;
-
-            edges.first.push_back(0);
-            edges.second.push_back(0);
+            // the matrix is read twice: once to count, and once to fill
+            // (i, j) is an edge if either adjmat(i, j) or adjmat(j, i) is set
             for (u64 i = 0; i < no_of_vertices; i++)
             {
-                for (u64 j = 0; j < no_of_vertices; j++)
+                for (u64 j = i + 1; j < no_of_vertices; j++)
                 {
-                    if (adjmat(i, j) || i == j)
-                    {
-                        edges.first.push_back(i + 1);
-                        edges.second.push_back(j + 1);
-                        edges.first.push_back(j + 1);
-                        edges.second.push_back(i + 1);
-                        no_of_edges += (i != j);
-                    }
+                    if (adjmat(i, j) || adjmat(j, i)) edges.count(i + 1, j + 1);
+                }
+            }
+            edges.start_fill();
+            for (u64 i = 0; i < no_of_vertices; i++)
+            {
+                for (u64 j = i + 1; j < no_of_vertices; j++)
+                {
+                    if (adjmat(i, j) || adjmat(j, i)) edges.add(i + 1, j + 1);
                 }
             }
 
-            no_of_edges /= 2;
-            if (edges.first.size() == 0 || edges.second.size() == 0)
-                throw CM_ERROR("Could not extract edges!!\n");
-            pg.load_graph(no_of_vertices, no_of_edges, std::move(edges));
+            pg.load_graph(std::move(edges));
             return pg;
         }
     }
@@ -210,25 +243,30 @@ namespace core
         if (n_vertices != edges.size() - 1)
             throw CM_ERROR("Number of vertices don't match!\n");
 
-        std::pair<std::vector<u64>, std::vector<u64>> edges2;
+        // each edge (i, j) is in both edges[i] and edges[j], so use only i < j
+        detail::csrBuilder edges2(n_vertices);
         pygraph pg;
         for (u64 i = 0; i < edges.size(); i++)
         {
-            edges2.first.push_back(i);
-            edges2.second.push_back(i);
             for (auto& j : edges[i])
             {
                 if (j == 0 || j > n_vertices || j == i ||
                     edges[j].find(i) == edges[j].end())
                     throw CM_ERROR("Invalid edge in adjacency list!\n");
-
-                edges2.first.push_back(i);
-                edges2.second.push_back(j);
+                if (i < j) edges2.count(i, j);
                 e++;
             }
         }
         if (e / 2 != n_edges) throw CM_ERROR("Number of edges don't match!\n");
-        pg.load_graph(n_vertices, n_edges, std::move(edges2));
+        edges2.start_fill();
+        for (u64 i = 0; i < edges.size(); i++)
+        {
+            for (auto& j : edges[i])
+            {
+                if (i < j) edges2.add(i, j);
+            }
+        }
+        pg.load_graph(std::move(edges2));
         return pg;
     }
 
@@ -239,20 +277,26 @@ namespace core
         elist1.resize({this->nedges, static_cast<u64>(2)});
         auto elist = elist1.mutable_unchecked<2>();
         u64 k = 0, N = this->nedges;
-        this->G->send_data(
-            [&elist, &k, &N](u64 i, u64 j)
-            {
-                // I could use N for checking bounds
-                elist(k, 0) = i;
-                elist(k, 1) = j;
-                k++;
-            });
+        {
+            // the array is allocated with the GIL, and filled without it
+            py::gil_scoped_release release;
+            std::lock_guard<std::mutex> guard(*search_lock);
+            this->G->send_data(
+                [&elist, &k, &N](u64 i, u64 j)
+                {
+                    // I could use N for checking bounds
+                    elist(k, 0) = i;
+                    elist(k, 1) = j;
+                    k++;
+                });
+        }
         return elist1;
     }
 
     void pygraph::to_file(std::string filename) const
     {
         check_loaded();
+        std::lock_guard<std::mutex> guard(*search_lock);
         std::ofstream f(filename, std::ios::out);
         if (!f.is_open())
         {
@@ -268,31 +312,43 @@ namespace core
         f.close();
     }
 
+    void pygraph::to_binary(std::string filename) const
+    {
+        check_loaded();
+        std::lock_guard<std::mutex> guard(*search_lock);
+        this->G->to_binary(filename);
+    }
+
     ndarray<bool> pygraph::to_adj_matrix() const
     {
         check_loaded();
         ndarray<bool> adjmat1(this->nvert * this->nvert);
         adjmat1.resize({this->nvert, this->nvert});
         auto adjmat = adjmat1.mutable_unchecked<2>();
-        // zero out while initializing ??
-        for (u64 i = 0; i < this->nvert; i++)
-            for (u64 j = 0; j < this->nvert; ++j) { adjmat(i, j) = false; }
+        {
+            py::gil_scoped_release release;
+            std::lock_guard<std::mutex> guard(*search_lock);
+            // zero out while initializing ??
+            for (u64 i = 0; i < this->nvert; i++)
+                for (u64 j = 0; j < this->nvert; ++j) { adjmat(i, j) = false; }
 
-        // internals are 1-indexed , so subtract by one
-        // out of bounds can only happen if either is zero,
-        // which means there is already an error elsewhere
-        this->G->send_data(
-            [&adjmat](u64 i, u64 j)
-            {
-                adjmat(i - 1, j - 1) = true;
-                adjmat(j - 1, i - 1) = true;
-            });
+            // internals are 1-indexed , so subtract by one
+            // out of bounds can only happen if either is zero,
+            // which means there is already an error elsewhere
+            this->G->send_data(
+                [&adjmat](u64 i, u64 j)
+                {
+                    adjmat(i - 1, j - 1) = true;
+                    adjmat(j - 1, i - 1) = true;
+                });
+        }
         return adjmat1;
     }
 
     std::vector<std::set<u64>> pygraph::to_adj_list() const
     {
         check_loaded();
+        std::lock_guard<std::mutex> guard(*search_lock);
         std::vector<std::set<u64>> edges(this->nvert + 1);
         this->G->send_data(
             [&edges](u64 i, u64 j)
@@ -310,11 +366,17 @@ namespace core
     }
 
     // Subgraph isomorphisms
-    std::pair<std::vector<u64>, std::vector<u64>> iso_edges(u64& nv, u64& ne,
-                                                            const pygraph& g1,
-                                                            const pygraph& g2)
+    detail::csrBuilder iso_edges(const pygraph& g1, const pygraph& g2)
+    {
+        return iso_edges(*(g1.G), *(g2.G));
+    }
+    detail::csrBuilder iso_edges(const pygraph& g1, const pygraph& g2,
+                                 const bool use_degree,
+                                 const std::vector<u64>& labels1,
+                                 const std::vector<u64>& labels2,
+                                 std::vector<u64>& vmap)
     {
-        return iso_edges(nv, ne, *(g1.G), *(g2.G));
+        return iso_edges(*(g1.G), *(g2.G), use_degree, labels1, labels2, vmap);
     }
 }  // namespace core
 }  // namespace cliquematch
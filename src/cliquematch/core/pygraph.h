@@ -3,6 +3,7 @@
 
 #include <detail/graph/graph.h>
 #include <core/core.h>
+#include <mutex>
 
 namespace cliquematch
 {
@@ -15,44 +16,68 @@ namespace core
     {
        private:
         std::shared_ptr<detail::graph> G;
+        // get_max_clique, with search_lock already held by the CALLER
+        std::vector<u64> find_max_clique(u64 lower_bound, u64 upper_bound,
+                                         double time_limit, bool use_heuristic,
+                                         bool use_dfs, bool continue_search,
+                                         u64 n_threads, bool use_coloring,
+                                         bool use_bitmatrix);
 
        public:
+        // the long-running methods are called without the GIL, so this is held
+        // (with the GIL released) whenever G is searched or replaced
+        std::shared_ptr<std::mutex> search_lock;
         bool finished_all;
         u64 nvert, nedges;
         u64 current_vertex;
+        // if not empty, vertex v of a filtered correspondence graph is the
+        // vertex vmap[v - 1] of the full one (see iso_edges); replaced along
+        // with G, so it is read under search_lock as well
+        std::vector<u64> vmap;
 
         pygraph();
-        void load_graph(u64, u64, std::pair<std::vector<u64>, std::vector<u64>>&&);
+        void load_graph(detail::csrBuilder&&, std::vector<u64>&& vmap = {});
+        void load_binary(std::string filename);
         void check_loaded() const;
         std::vector<u64> get_max_clique(u64 lower_bound = 1, u64 upper_bound = 0xFFFF,
                                         double time_limit = -1,
                                         bool use_heuristic = true, bool use_dfs = true,
-                                        bool continue_search = false);
+                                        bool continue_search = false,
+                                        u64 n_threads = 1, bool use_coloring = false,
+                                        bool use_bitmatrix = false);
         void reset_search();
         std::pair<std::vector<u64>, std::vector<u64>> get_correspondence(
             u64 len1, u64 len2, u64 lower_bound = 1, u64 upper_bound = 0xFFFF,
             double time_limit = -1, bool use_heuristic = true, bool use_dfs = true,
-            bool continue_search = false);
-        std::pair<std::vector<u64>, std::vector<u64>> get_correspondence2(
-            u64 len1, u64 len2, std::vector<u64> clique);
+            bool continue_search = false, u64 n_threads = 1, bool use_coloring = false,
+            bool use_bitmatrix = false);
+        // the vertices of clique as pairs of indices, vmap as above
+        static std::pair<std::vector<u64>, std::vector<u64>> get_correspondence2(
+            u64 len1, u64 len2, const std::vector<u64>& clique,
+            const std::vector<u64>& vmap);
 
         std::string showdata() const;
         ndarray<bool> to_adj_matrix() const;
         ndarray<u64> to_edgelist() const;
         std::vector<std::set<u64>> to_adj_list() const;
         void to_file(std::string filename) const;
+        void to_binary(std::string filename) const;
         std::set<u64> get_vertex_data(u64 i) const;
 
-        friend std::pair<std::vector<u64>, std::vector<u64>> iso_edges(u64&, u64&,
-                                                                       const pygraph&,
-                                                                       const pygraph&);
+        friend detail::csrBuilder iso_edges(const pygraph&, const pygraph&);
+        friend detail::csrBuilder iso_edges(const pygraph&, const pygraph&, const bool,
+                                            const std::vector<u64>&,
+                                            const std::vector<u64>&,
+                                            std::vector<u64>&);
         friend class CliqueIterator;
         friend class CorrespondenceIterator;
+        friend class MaximalCliqueIterator;
     };
 
     pygraph from_adj_matrix(ndarray<bool> adjmat);
     pygraph from_edgelist(ndarray<u64> edge_list, u64 no_of_vertices);
     pygraph from_file(std::string filename);
+    pygraph from_binary(std::string filename);
     pygraph from_adj_list(u64 n_vertices, u64 n_edges,
                           std::vector<std::set<u64>> edges);
 }  // namespace core
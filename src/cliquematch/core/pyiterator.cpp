@@ -5,32 +5,104 @@ namespace cliquematch
 {
 namespace core
 {
-    std::vector<u64> CliqueIterator::next_clique()
+    namespace py = pybind11;
+    // get the next clique from the search, return false if there are none left
+    // (called without the GIL, the parallel search has its own locks)
+    bool CliqueIterator::fetch(std::vector<u64>& clique)
     {
-        u64 v;
-        while (true)
+        if (pen) return pen->next(clique);
+        std::lock_guard<std::mutex> guard(*pg.search_lock);
+        u64 v = en->process_graph(*(pg.G));
+        if (v > pg.nvert) return false;
+        clique = pg.G->get_max_clique(v);
+        return true;
+    }
+
+    // (as above, but the clique is decoded with the vmap of the graph searched)
+    bool CorrespondenceIterator::fetch(
+        std::pair<std::vector<u64>, std::vector<u64>>& corr)
+    {
+        std::vector<u64> clique;
+        if (pen)
         {
-            v = en->process_graph(*(pg.G));
-            if (v > pg.nvert) break;
-            return pg.G->get_max_clique(v);
+            if (!pen->next(clique)) return false;
+            corr = pygraph::get_correspondence2(len1, len2, clique, vmap);
+            return true;
         }
+        std::lock_guard<std::mutex> guard(*pg.search_lock);
+        u64 v = en->process_graph(*(pg.G));
+        if (v > pg.nvert) return false;
+        corr =
+            pygraph::get_correspondence2(len1, len2, pg.G->get_max_clique(v), pg.vmap);
+        return true;
+    }
+
+    std::vector<u64> CliqueIterator::next_clique()
+    {
+        std::vector<u64> clique;
+        if (this->fetch(clique)) return clique;
         throw pybind11::stop_iteration();
     }
 
-    std::pair<std::vector<u64>, std::vector<u64>> CorrespondenceIterator::next_clique()
+    ndarray<u64> CliqueIterator::next_batch(u64 batch_size)
     {
-        u64 v;
-        while (true)
+        if (batch_size == 0) throw CM_ERROR("batch_size should be positive\n");
+        ndarray<u64> block1(batch_size * clique_size);
+        block1.resize({batch_size, clique_size});
+        auto block = block1.mutable_unchecked<2>();
+        std::vector<u64> clique;
+        u64 i, j;
         {
-            v = en->process_graph(*(pg.G));
-            if (v > pg.nvert) break;
-            return pg.get_correspondence2(len1, len2, pg.G->get_max_clique(v));
+            py::gil_scoped_release release;
+            for (i = 0; i < batch_size && this->fetch(clique); i++)
+                for (j = 0; j < clique_size; j++) block(i, j) = clique[j];
         }
+        // fewer rows than requested means the search is over
+        if (i < batch_size) block1.resize({i, clique_size});
+        return block1;
+    }
+
+    std::pair<std::vector<u64>, std::vector<u64>> CorrespondenceIterator::next_clique()
+    {
+        std::pair<std::vector<u64>, std::vector<u64>> corr;
+        if (this->fetch(corr)) return corr;
         throw pybind11::stop_iteration();
     }
 
+    std::pair<ndarray<u64>, ndarray<u64>> CorrespondenceIterator::next_batch(
+        u64 batch_size)
+    {
+        if (batch_size == 0) throw CM_ERROR("batch_size should be positive\n");
+        ndarray<u64> block1(batch_size * clique_size);
+        ndarray<u64> block2(batch_size * clique_size);
+        block1.resize({batch_size, clique_size});
+        block2.resize({batch_size, clique_size});
+        auto b1 = block1.mutable_unchecked<2>();
+        auto b2 = block2.mutable_unchecked<2>();
+        std::pair<std::vector<u64>, std::vector<u64>> corr;
+        u64 i, j;
+        {
+            py::gil_scoped_release release;
+            for (i = 0; i < batch_size && this->fetch(corr); i++)
+            {
+                for (j = 0; j < clique_size; j++)
+                {
+                    b1(i, j) = corr.first[j];
+                    b2(i, j) = corr.second[j];
+                }
+            }
+        }
+        if (i < batch_size)
+        {
+            block1.resize({i, clique_size});
+            block2.resize({i, clique_size});
+        }
+        return std::make_pair(block1, block2);
+    }
+
     std::vector<u64> NWCliqueIterator::next_clique()
     {
+        std::lock_guard<std::mutex> guard(*pg.search_lock);
         u64 v;
         while (true)
         {
@@ -41,9 +113,69 @@ namespace core
         throw pybind11::stop_iteration();
     }
 
+    // copy a vector into a new 1-D array
+    static ndarray<u64> to_ndarray(const std::vector<u64>& vec)
+    {
+        ndarray<u64> arr1(vec.size());
+        auto arr = arr1.mutable_unchecked<1>();
+        for (u64 i = 0; i < vec.size(); i++) arr(i) = vec[i];
+        return arr1;
+    }
+
+    std::pair<ndarray<u64>, ndarray<u64>> NWCliqueIterator::next_batch(
+        u64 batch_size)
+    {
+        if (batch_size == 0) throw CM_ERROR("batch_size should be positive\n");
+        std::vector<u64> verts, offsets(1, 0), clique;
+        u64 v;
+        {
+            py::gil_scoped_release release;
+            std::lock_guard<std::mutex> guard(*pg.search_lock);
+            while (offsets.size() <= batch_size)
+            {
+                v = en->process_graph(*(pg.G));
+                if (v > pg.nvert) break;
+                clique = pg.G->get_max_clique(v);
+                verts.insert(verts.end(), clique.begin(), clique.end());
+                offsets.push_back(verts.size());
+            }
+        }
+        return std::make_pair(to_ndarray(verts), to_ndarray(offsets));
+    }
+
+    std::vector<u64> MaximalCliqueIterator::next_clique()
+    {
+        std::lock_guard<std::mutex> guard(*pg.search_lock);
+        u64 v = en->process_graph(*(pg.G));
+        if (v > pg.nvert) throw pybind11::stop_iteration();
+        return pg.G->get_max_clique(v);
+    }
+
+    std::pair<ndarray<u64>, ndarray<u64>> MaximalCliqueIterator::next_batch(
+        u64 batch_size)
+    {
+        if (batch_size == 0) throw CM_ERROR("batch_size should be positive\n");
+        std::vector<u64> verts, offsets(1, 0), clique;
+        u64 v;
+        {
+            py::gil_scoped_release release;
+            std::lock_guard<std::mutex> guard(*pg.search_lock);
+            while (offsets.size() <= batch_size)
+            {
+                v = en->process_graph(*(pg.G));
+                if (v > pg.nvert) break;
+                clique = pg.G->get_max_clique(v);
+                verts.insert(verts.end(), clique.begin(), clique.end());
+                offsets.push_back(verts.size());
+            }
+        }
+        return std::make_pair(to_ndarray(verts), to_ndarray(offsets));
+    }
+
     std::pair<std::vector<u64>, std::vector<u64>>
     NWCorrespondenceIterator::next_clique()
     {
+        std::lock_guard<std::mutex> guard(*pg.search_lock);
         u64 v;
         while (true)
         {
@@ -53,6 +185,29 @@ namespace core
         }
         throw pybind11::stop_iteration();
     }
+
+    std::tuple<ndarray<u64>, ndarray<u64>, ndarray<u64>>
+    NWCorrespondenceIterator::next_batch(u64 batch_size)
+    {
+        if (batch_size == 0) throw CM_ERROR("batch_size should be positive\n");
+        std::vector<u64> ind1, ind2, offsets(1, 0);
+        std::pair<std::vector<u64>, std::vector<u64>> corr;
+        u64 v;
+        {
+            py::gil_scoped_release release;
+            std::lock_guard<std::mutex> guard(*pg.search_lock);
+            while (offsets.size() <= batch_size)
+            {
+                v = en->process_graph(*(pg.G));
+                if (v > pg.nvert) break;
+                corr = pg.get_correspondence2(len1, len2, pg.G->get_max_clique(v));
+                ind1.insert(ind1.end(), corr.first.begin(), corr.first.end());
+                ind2.insert(ind2.end(), corr.second.begin(), corr.second.end());
+                offsets.push_back(ind1.size());
+            }
+        }
+        return std::make_tuple(to_ndarray(ind1), to_ndarray(ind2), to_ndarray(offsets));
+    }
 }  // namespace core
 
 void init_iterators(pybind11::module& m)
@@ -61,15 +216,31 @@ void init_iterators(pybind11::module& m)
     namespace py = pybind11;
     class_<core::CliqueIterator>(m, "CliqueIterator")
         .def("__iter__", [](core::CliqueIterator& it) { return it; })
-        .def("__next__", &core::CliqueIterator::next_clique);
+        .def("__next__", &core::CliqueIterator::next_clique,
+             call_guard<gil_scoped_release>())
+        .def("next_batch", &core::CliqueIterator::next_batch, arg("batch_size"));
     class_<core::CorrespondenceIterator>(m, "CorrespondenceIterator")
         .def("__iter__", [](core::CorrespondenceIterator& it) { return it; })
-        .def("__next__", &core::CorrespondenceIterator::next_clique);
+        .def("__next__", &core::CorrespondenceIterator::next_clique,
+             call_guard<gil_scoped_release>())
+        .def("next_batch", &core::CorrespondenceIterator::next_batch,
+             arg("batch_size"));
+    class_<core::MaximalCliqueIterator>(m, "MaximalCliqueIterator")
+        .def("__iter__", [](core::MaximalCliqueIterator& it) { return it; })
+        .def("__next__", &core::MaximalCliqueIterator::next_clique,
+             call_guard<gil_scoped_release>())
+        .def("next_batch", &core::MaximalCliqueIterator::next_batch,
+             arg("batch_size"));
     class_<core::NWCliqueIterator>(m, "NWCliqueIterator")
         .def("__iter__", [](core::NWCliqueIterator& it) { return it; })
-        .def("__next__", &core::NWCliqueIterator::next_clique);
+        .def("__next__", &core::NWCliqueIterator::next_clique,
+             call_guard<gil_scoped_release>())
+        .def("next_batch", &core::NWCliqueIterator::next_batch, arg("batch_size"));
     class_<core::NWCorrespondenceIterator>(m, "NWCorrespondenceIterator")
         .def("__iter__", [](core::NWCorrespondenceIterator& it) { return it; })
-        .def("__next__", &core::NWCorrespondenceIterator::next_clique);
+        .def("__next__", &core::NWCorrespondenceIterator::next_clique,
+             call_guard<gil_scoped_release>())
+        .def("next_batch", &core::NWCorrespondenceIterator::next_batch,
+             arg("batch_size"));
 }
 }  // namespace cliquematch
@@ -5,6 +5,7 @@
 #include <core/pynwgraph.h>
 #include <detail/graph/dfs.h>
 #include <detail/nwgraph/nwclique.h>
+#include <tuple>
 
 namespace cliquematch
 {
@@ -16,15 +17,35 @@ namespace core
         pygraph& pg;
         pybind11::object rf;
         std::shared_ptr<detail::CliqueEnumerator> en;
+        // with n_threads != 1, the cliques come from pen instead of en, and G
+        // keeps the graph alive while the threads search it
+        std::shared_ptr<detail::graph> G;
+        std::shared_ptr<detail::ParallelEnumerator> pen;
+        u64 clique_size;
+        bool fetch(std::vector<u64>& clique);
 
        public:
-        CliqueIterator(pygraph& p, pybind11::object rf, u64 clique_size)
-            : pg(p), rf(rf), en(new detail::CliqueEnumerator(clique_size))
+        CliqueIterator(pygraph& p, pybind11::object rf, u64 clique_size,
+                       bool use_bitmatrix = false, u64 n_threads = 1)
+            : pg(p), rf(rf),
+              en(new detail::CliqueEnumerator(clique_size, use_bitmatrix)),
+              clique_size(clique_size)
         {
             if (pg.G.get() == nullptr || pg.nvert == 0)
                 throw CM_ERROR("trying to create iterator on uninitialized Graph");
+            if (n_threads != 1)
+            {
+                // the enumerator copies the search bounds of G when it starts
+                pybind11::gil_scoped_release release;
+                std::lock_guard<std::mutex> guard(*pg.search_lock);
+                G = pg.G;
+                pen = std::make_shared<detail::ParallelEnumerator>(
+                    *G, clique_size, n_threads, use_bitmatrix);
+            }
         };
         std::vector<u64> next_clique();
+        // up to batch_size cliques as the rows of an array, zero rows when done
+        ndarray<u64> next_batch(u64 batch_size);
     };
 
     class CorrespondenceIterator
@@ -33,18 +54,54 @@ namespace core
         pygraph& pg;
         pybind11::object rf;
         std::shared_ptr<detail::CliqueEnumerator> en;
-        u64 len1, len2;
+        std::shared_ptr<detail::graph> G;  // (see CliqueIterator)
+        std::vector<u64> vmap;             // pg.vmap for G
+        std::shared_ptr<detail::ParallelEnumerator> pen;
+        u64 len1, len2, clique_size;
+        bool fetch(std::pair<std::vector<u64>, std::vector<u64>>& corr);
 
        public:
         CorrespondenceIterator(pygraph& p, pybind11::object rf, u64 len1, u64 len2,
-                               u64 clique_size)
-            : pg(p), rf(rf), en(new detail::CliqueEnumerator(clique_size)), len1(len1),
-              len2(len2)
+                               u64 clique_size, bool use_bitmatrix = false,
+                               u64 n_threads = 1)
+            : pg(p), rf(rf),
+              en(new detail::CliqueEnumerator(clique_size, use_bitmatrix)),
+              len1(len1), len2(len2), clique_size(clique_size)
         {
             if (pg.G.get() == nullptr || pg.nvert == 0)
                 throw CM_ERROR("trying to create iterator on uninitialized Graph");
+            if (n_threads != 1)
+            {
+                // (see CliqueIterator)
+                pybind11::gil_scoped_release release;
+                std::lock_guard<std::mutex> guard(*pg.search_lock);
+                G = pg.G;
+                vmap = pg.vmap;
+                pen = std::make_shared<detail::ParallelEnumerator>(
+                    *G, clique_size, n_threads, use_bitmatrix);
+            }
         };
         std::pair<std::vector<u64>, std::vector<u64>> next_clique();
+        std::pair<ndarray<u64>, ndarray<u64>> next_batch(u64 batch_size);
+    };
+
+    class MaximalCliqueIterator
+    {
+       private:
+        pygraph& pg;
+        pybind11::object rf;
+        std::shared_ptr<detail::MaximalEnumerator> en;
+
+       public:
+        MaximalCliqueIterator(pygraph& p, pybind11::object rf, u64 min_size)
+            : pg(p), rf(rf), en(new detail::MaximalEnumerator(min_size))
+        {
+            if (pg.G.get() == nullptr || pg.nvert == 0)
+                throw CM_ERROR("trying to create iterator on uninitialized Graph");
+        };
+        std::vector<u64> next_clique();
+        // maximal cliques differ in size (see NWCliqueIterator::next_batch)
+        std::pair<ndarray<u64>, ndarray<u64>> next_batch(u64 batch_size);
     };
 
     class NWCliqueIterator
@@ -62,6 +119,9 @@ namespace core
                 throw CM_ERROR("trying to create iterator on uninitialized Graph");
         };
         std::vector<u64> next_clique();
+        // weighted cliques differ in size, so the batch is returned flattened,
+        // with row i in [offsets[i], offsets[i+1])
+        std::pair<ndarray<u64>, ndarray<u64>> next_batch(u64 batch_size);
     };
 
     class NWCorrespondenceIterator
@@ -82,6 +142,8 @@ namespace core
                 throw CM_ERROR("trying to create iterator on uninitialized Graph");
         };
         std::pair<std::vector<u64>, std::vector<u64>> next_clique();
+        std::tuple<ndarray<u64>, ndarray<u64>, ndarray<u64>> next_batch(
+            u64 batch_size);
     };
 
 }  // namespace core
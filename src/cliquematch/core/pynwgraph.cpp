@@ -11,21 +11,24 @@ namespace core
     namespace py = pybind11;
     // Initialization and Destruction
 
-    pynwgraph::pynwgraph()
+    pynwgraph::pynwgraph() : search_lock(std::make_shared<std::mutex>())
     {
         nvert = 0;
         nedges = 0;
         current_vertex = 0;
         finished_all = false;
     }
-    void pynwgraph::load_graph(u64 n_vertices, u64 n_edges,
-                               std::pair<std::vector<u64>, std::vector<u64>>&& edges,
+    void pynwgraph::load_graph(detail::csrBuilder&& edges,
                                std::vector<double>&& weights)
     {
-        this->nvert = n_vertices;
-        this->nedges = n_edges;
-        this->G = std::make_shared<detail::nwgraph>(
-            this->nvert, this->nedges, std::move(edges), std::move(weights));
+        // the graph is constructed before taking the lock
+        auto g =
+            std::make_shared<detail::nwgraph>(std::move(edges), std::move(weights));
+        std::lock_guard<std::mutex> guard(*search_lock);
+        this->G = std::move(g);
+        // subtract 1 because 0 is a sentinel vertex for nwgraph
+        this->nvert = this->G->n_vert - 1;
+        this->nedges = this->G->n_edges();
     }
     void pynwgraph::check_loaded() const
     {
@@ -36,23 +39,37 @@ namespace core
     // Computation
     void pynwgraph::reset_search()
     {
+        std::lock_guard<std::mutex> guard(*search_lock);
         this->G->CUR_MAX_CLIQUE_SIZE = 0;
         this->finished_all = false;
         this->current_vertex = 0;
     }
 
     std::vector<u64> pynwgraph::get_max_clique(double lower_bound, double upper_bound,
-                                               bool use_heuristic, bool use_dfs)
+                                               bool use_heuristic, bool use_dfs,
+                                               bool use_bitmatrix, u64 n_threads,
+                                               double time_limit, bool continue_search)
     {
-        current_vertex = 0;
+        std::lock_guard<std::mutex> guard(*search_lock);
+        if (!continue_search)
+            current_vertex = 0;
+        else if (current_vertex != 0)
+            use_heuristic = false;
+
         check_loaded();
         this->G->CUR_MAX_CLIQUE_SIZE = lower_bound > this->G->CUR_MAX_CLIQUE_SIZE
                                            ? lower_bound
                                            : this->G->CUR_MAX_CLIQUE_SIZE;
         this->G->CLIQUE_LIMIT =
             upper_bound < this->G->CLIQUE_LIMIT ? upper_bound : this->G->CLIQUE_LIMIT;
-        this->G->find_max_cliques(current_vertex, use_heuristic, use_dfs);
-        finished_all = (current_vertex >= nvert);
+        // Ctrl-C pauses the search like the time limit (see pygraph)
+        auto signals = std::make_shared<SignalCheck>();
+        this->G->interrupt = [signals]() { return (*signals)(); };
+        this->G->find_max_cliques(current_vertex, use_heuristic, use_dfs,
+                                  use_bitmatrix, n_threads, time_limit);
+        this->G->interrupt = nullptr;
+        finished_all = (current_vertex >= this->G->n_vert);
+        signals->rethrow();
 
         auto ans = this->G->get_max_clique();
         if (lower_bound > this->G->get_clique_weight(ans))
@@ -85,11 +102,14 @@ namespace core
 
     std::pair<std::vector<u64>, std::vector<u64>> pynwgraph::get_correspondence(
         u64 len1, u64 len2, double lower_bound, double upper_bound, bool use_heuristic,
-        bool use_dfs)
+        bool use_dfs, bool use_bitmatrix, u64 n_threads, double time_limit,
+        bool continue_search)
     {
         return this->get_correspondence2(
             len1, len2,
-            this->get_max_clique(lower_bound, upper_bound, use_heuristic, use_dfs));
+            this->get_max_clique(lower_bound, upper_bound, use_heuristic, use_dfs,
+                                 use_bitmatrix, n_threads, time_limit,
+                                 continue_search));
     }
     // IO
 
@@ -107,15 +127,13 @@ namespace core
                                ndarray<double> weights1)
     {
         //	std::cout<<"Constructing graph from the list of edges (Nx2 matrix)\n";
-        u64 no_of_edges = 0;
         u64 v1, v2;
         auto edge_list = edge_list1.unchecked<2>();
         auto weights = weights1.unchecked<1>();
+        py::gil_scoped_release release;  // (the arrays keep the data alive)
 
-        std::pair<std::vector<u64>, std::vector<u64>> edges;
+        detail::csrBuilder edges(no_of_vertices);
         std::vector<double> wts;
-        edges.first.resize(no_of_vertices + 1);
-        edges.second.resize(no_of_vertices + 1);
         wts.resize(no_of_vertices + 1);
 
         pynwgraph pg;
@@ -126,11 +144,7 @@ namespace core
         wts[0] = 0;
         for (u64 i = 0; i < no_of_vertices; i++) wts[i + 1] = weights(i);
 
-        for (u64 i = 0; i < edges.first.size(); i++)
-        {
-            edges.first[i] = i;
-            edges.second[i] = i;
-        }
+        // the edges are read twice: once to count, and once to fill
         for (auto i = 0; i < edge_list.shape(0); i++)
         {
             v1 = edge_list(i, 0);
@@ -143,16 +157,13 @@ namespace core
                 throw CM_ERROR(
                     "Vertex numbers must begin at 1, 0 is used as a sentinel value\n");
             }
-            no_of_edges++;
-            edges.first.push_back(v1);
-            edges.second.push_back(v2);
-            edges.first.push_back(v2);
-            edges.second.push_back(v1);
+            edges.count(v1, v2);
         }
+        edges.start_fill();
+        for (auto i = 0; i < edge_list.shape(0); i++)
+            edges.add(edge_list(i, 0), edge_list(i, 1));
 
-        if (edges.first.size() == 0 || edges.second.size() == 0)
-            throw CM_ERROR("Could not extract edges!!\n");
-        pg.load_graph(no_of_vertices, no_of_edges, std::move(edges), std::move(wts));
+        pg.load_graph(std::move(edges), std::move(wts));
         return pg;
     }
 
@@ -167,38 +178,35 @@ namespace core
             throw CM_ERROR("weights array not as long as matrix rows!!\n");
         else
         {
+            py::gil_scoped_release release;  // (the arrays keep the data alive)
             u64 no_of_vertices = adjmat.shape(0);
-            u64 no_of_edges = 0;
             pynwgraph pg;
 
-            std::pair<std::vector<u64>, std::vector<u64>> edges;
+            detail::csrBuilder edges(no_of_vertices);
             std::vector<double> wts;
 
             wts.push_back(0);
             for (u64 i = 0; i < no_of_vertices; i++) wts.push_back(weights(i));
 
-            edges.first.push_back(0);
-            edges.second.push_back(0);
+            // the matrix is read twice: once to count, and once to fill
+            // (i, j) is an edge if either adjmat(i, j) or adjmat(j, i) is set
             for (u64 i = 0; i < no_of_vertices; i++)
             {
-                for (u64 j = 0; j < no_of_vertices; j++)
+                for (u64 j = i + 1; j < no_of_vertices; j++)
                 {
-                    if (adjmat(i, j) || i == j)
-                    {
-                        edges.first.push_back(i + 1);
-                        edges.second.push_back(j + 1);
-                        edges.first.push_back(j + 1);
-                        edges.second.push_back(i + 1);
-                        no_of_edges += (i != j);
-                    }
+                    if (adjmat(i, j) || adjmat(j, i)) edges.count(i + 1, j + 1);
+                }
+            }
+            edges.start_fill();
+            for (u64 i = 0; i < no_of_vertices; i++)
+            {
+                for (u64 j = i + 1; j < no_of_vertices; j++)
+                {
+                    if (adjmat(i, j) || adjmat(j, i)) edges.add(i + 1, j + 1);
                 }
             }
 
-            no_of_edges /= 2;
-            if (edges.first.size() == 0 || edges.second.size() == 0)
-                throw CM_ERROR("Could not extract edges!!\n");
-            pg.load_graph(no_of_vertices, no_of_edges, std::move(edges),
-                          std::move(wts));
+            pg.load_graph(std::move(edges), std::move(wts));
             return pg;
         }
     }
@@ -212,25 +220,32 @@ namespace core
         if (n_vertices + 1 != edges.size() || n_vertices != weights.size())
             throw CM_ERROR("Number of vertices don't match!\n");
 
-        std::pair<std::vector<u64>, std::vector<u64>> edges2;
+        // each edge (i, j) is in both edges[i] and edges[j], so use only i < j
+        detail::csrBuilder edges2(n_vertices);
         pynwgraph pg;
         for (u64 i = 0; i < edges.size(); i++)
         {
-            edges2.first.push_back(i);
-            edges2.second.push_back(i);
             for (auto& j : edges[i])
             {
                 if (j == 0 || j > n_vertices || j == i ||
                     edges[j].find(i) == edges[j].end())
                     throw CM_ERROR("Invalid edge in adjacency list!\n");
-
-                edges2.first.push_back(i);
-                edges2.second.push_back(j);
+                if (i < j) edges2.count(i, j);
                 e++;
             }
         }
         if (e / 2 != n_edges) throw CM_ERROR("Number of edges don't match!\n");
-        pg.load_graph(n_vertices, n_edges, std::move(edges2), std::move(weights));
+        // the weights are indexed by vertex, and 0 is the sentinel vertex
+        weights.insert(weights.begin(), 0);
+        edges2.start_fill();
+        for (u64 i = 0; i < edges.size(); i++)
+        {
+            for (auto& j : edges[i])
+            {
+                if (i < j) edges2.add(i, j);
+            }
+        }
+        pg.load_graph(std::move(edges2), std::move(weights));
         return pg;
     }
 
@@ -241,14 +256,19 @@ namespace core
         elist1.resize({this->nedges, static_cast<u64>(2)});
         auto elist = elist1.mutable_unchecked<2>();
         u64 k = 0, N = this->nedges;
-        this->G->send_data(
-            [&elist, &k, &N](u64 i, u64 j)
-            {
-                // I could use N for checking bounds
-                elist(k, 0) = i;
-                elist(k, 1) = j;
-                k++;
-            });
+        {
+            // the array is allocated with the GIL, and filled without it
+            py::gil_scoped_release release;
+            std::lock_guard<std::mutex> guard(*search_lock);
+            this->G->send_data(
+                [&elist, &k, &N](u64 i, u64 j)
+                {
+                    // I could use N for checking bounds
+                    elist(k, 0) = i;
+                    elist(k, 1) = j;
+                    k++;
+                });
+        }
         return elist1;
     }
 
@@ -258,25 +278,30 @@ namespace core
         ndarray<bool> adjmat1(this->nvert * this->nvert);
         adjmat1.resize({this->nvert, this->nvert});
         auto adjmat = adjmat1.mutable_unchecked<2>();
-        // zero out while initializing ??
-        for (u64 i = 0; i < this->nvert; i++)
-            for (u64 j = 0; j < this->nvert; ++j) { adjmat(i, j) = false; }
+        {
+            py::gil_scoped_release release;
+            std::lock_guard<std::mutex> guard(*search_lock);
+            // zero out while initializing ??
+            for (u64 i = 0; i < this->nvert; i++)
+                for (u64 j = 0; j < this->nvert; ++j) { adjmat(i, j) = false; }
 
-        // internals are 1-indexed , so subtract by one
-        // out of bounds can only happen if either is zero,
-        // which means there is already an error elsewhere
-        this->G->send_data(
-            [&adjmat](u64 i, u64 j)
-            {
-                adjmat(i - 1, j - 1) = true;
-                adjmat(j - 1, i - 1) = true;
-            });
+            // internals are 1-indexed , so subtract by one
+            // out of bounds can only happen if either is zero,
+            // which means there is already an error elsewhere
+            this->G->send_data(
+                [&adjmat](u64 i, u64 j)
+                {
+                    adjmat(i - 1, j - 1) = true;
+                    adjmat(j - 1, i - 1) = true;
+                });
+        }
         return adjmat1;
     }
 
     std::vector<std::set<u64>> pynwgraph::to_adj_list() const
     {
         check_loaded();
+        std::lock_guard<std::mutex> guard(*search_lock);
         std::vector<std::set<u64>> edges(this->nvert + 1);
         this->G->send_data(
             [&edges](u64 i, u64 j)
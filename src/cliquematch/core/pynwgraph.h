@@ -3,6 +3,7 @@
 
 #include <detail/nwgraph/nwgraph.h>
 #include <core/core.h>
+#include <mutex>
 
 namespace cliquematch
 {
@@ -16,23 +17,29 @@ namespace core
         std::shared_ptr<detail::nwgraph> G;
 
        public:
+        // the long-running methods are called without the GIL, so this is held
+        // (with the GIL released) whenever G is searched or replaced
+        std::shared_ptr<std::mutex> search_lock;
         u64 nvert, nedges;
         u64 current_vertex;
         bool finished_all;
 
         pynwgraph();
-        void load_graph(u64, u64, std::pair<std::vector<u64>, std::vector<u64>>&&,
-                        std::vector<double>&&);
+        void load_graph(detail::csrBuilder&&, std::vector<double>&&);
         void check_loaded() const;
 
         void reset_search();
         std::vector<u64> get_max_clique(double lower_bound = 1,
                                         double upper_bound = 0xFFFF,
-                                        bool use_heuristic = true, bool use_dfs = true);
+                                        bool use_heuristic = true, bool use_dfs = true,
+                                        bool use_bitmatrix = false, u64 n_threads = 1,
+                                        double time_limit = -1,
+                                        bool continue_search = false);
 
         std::pair<std::vector<u64>, std::vector<u64>> get_correspondence(
             u64 len1, u64 len2, double lower_bound = 1, double upper_bound = 0xFFFF,
-            bool use_heuristic = true, bool use_dfs = true);
+            bool use_heuristic = true, bool use_dfs = true, bool use_bitmatrix = false,
+            u64 n_threads = 1, double time_limit = -1, bool continue_search = false);
         std::pair<std::vector<u64>, std::vector<u64>> get_correspondence2(
             u64 len1, u64 len2, std::vector<u64> clique);
 
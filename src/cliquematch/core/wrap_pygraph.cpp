@@ -13,6 +13,9 @@ void init_pygraph(pybind11::module& m)
     using namespace pybind11;
     using cliquematch::core::pygraph;
     using cliquematch::core::pynwgraph;
+    // the searches and the conversions only use C++ objects, so they are run
+    // without the GIL (see search_lock in pygraph.h)
+    using release_gil = call_guard<gil_scoped_release>;
 
     class_<pygraph>(m, "Graph")
         .def(py::init<>())
@@ -27,28 +30,48 @@ void init_pygraph(pybind11::module& m)
         .def("get_max_clique", &pygraph::get_max_clique,
              "Find a maximum clique in graph within the given bounds",
              "lower_bound"_a = 1, "upper_bound"_a = 0xFFFF, "time_limit"_a = 0.0,
-             "use_heuristic"_a = true, "use_dfs"_a = true, "continue_search"_a = false)
+             "use_heuristic"_a = true, "use_dfs"_a = true, "continue_search"_a = false,
+             "n_threads"_a = 1, "use_coloring"_a = false, "use_bitmatrix"_a = false,
+             release_gil())
         .def("reset_search", &pygraph::reset_search,
-             "Reset the clique search to try with different parameters")
+             "Reset the clique search to try with different parameters", release_gil())
         .def("_get_correspondence", &pygraph::get_correspondence, "len1"_a, "len2"_a,
              "lower_bound"_a = 1, "upper_bound"_a = 0xFFFF, "time_limit"_a = 0.0,
-             "use_heuristic"_a = true, "use_dfs"_a = true, "continue_search"_a = false)
+             "use_heuristic"_a = true, "use_dfs"_a = true, "continue_search"_a = false,
+             "n_threads"_a = 1, "use_coloring"_a = false, "use_bitmatrix"_a = false,
+             release_gil())
         .def(
             "all_cliques",
-            [](py::object s, u64 clique_size)
-            { return cm_core::CliqueIterator(s.cast<pygraph&>(), s, clique_size); },
-            "size"_a)
+            [](py::object s, u64 clique_size, bool use_bitmatrix, u64 n_threads)
+            {
+                return cm_core::CliqueIterator(s.cast<pygraph&>(), s, clique_size,
+                                               use_bitmatrix, n_threads);
+            },
+            "size"_a, "use_bitmatrix"_a = false, "n_threads"_a = 1)
+        .def(
+            "all_maximal_cliques",
+            [](py::object s, u64 min_size)
+            {
+                return cm_core::MaximalCliqueIterator(s.cast<pygraph&>(), s, min_size);
+            },
+            "min_size"_a = 1)
         .def(
             "_all_correspondences",
-            [](py::object s, u64 len1, u64 len2, u64 clique_size)
+            [](py::object s, u64 len1, u64 len2, u64 clique_size, bool use_bitmatrix,
+               u64 n_threads)
             {
                 return cm_core::CorrespondenceIterator(s.cast<pygraph&>(), s, len1,
-                                                       len2, clique_size);
+                                                       len2, clique_size,
+                                                       use_bitmatrix, n_threads);
             },
-            "len1"_a, "len2"_a, "size"_a)
+            "len1"_a, "len2"_a, "size"_a, "use_bitmatrix"_a = false,
+            "n_threads"_a = 1)
         .def_static("from_file", &cm_core::from_file,
                     "Constructs `Graph` instance from reading a Matrix Market file",
-                    arg("filename"), py::return_value_policy::move)
+                    arg("filename"), py::return_value_policy::move, release_gil())
+        .def_static("from_binary", &cm_core::from_binary,
+                    "Constructs `Graph` instance from a file written by `to_binary`",
+                    arg("filename"), py::return_value_policy::move, release_gil())
         .def_static("from_edgelist", &cm_core::from_edgelist,
                     "Constructs `Graph` instance from the given edge list",
                     arg("edgelist"), arg("num_vertices"), py::return_value_policy::move)
@@ -58,15 +81,19 @@ void init_pygraph(pybind11::module& m)
         .def_static("from_adjlist", &cm_core::from_adj_list,
                     "Constructs `Graph` instance from the given adjacency list",
                     arg("num_vertices"), arg("num_edges"), arg("edges"),
-                    py::return_value_policy::move)
+                    py::return_value_policy::move, release_gil())
         .def("to_file", &pygraph::to_file,
-             "Exports `Graph` instance to a Matrix Market file", arg("filename"))
+             "Exports `Graph` instance to a Matrix Market file", arg("filename"),
+             release_gil())
+        .def("to_binary", &pygraph::to_binary,
+             "Exports `Graph` instance to a binary file for fast loading",
+             arg("filename"), release_gil())
         .def("to_edgelist", &pygraph::to_edgelist,
              "Exports `Graph` instance to an edge list")
         .def("to_matrix", &pygraph::to_adj_matrix,
              "Exports `Graph` instance to a boolean matrix")
         .def("to_adjlist", &pygraph::to_adj_list,
-             "Exports `Graph` instance to an adjacency list")
+             "Exports `Graph` instance to an adjacency list", release_gil())
         .def("__repr__", &pygraph::showdata)
         .def("__str__", &pygraph::showdata);
 
@@ -81,18 +108,20 @@ void init_pygraph(pybind11::module& m)
         .def("get_max_clique", &pynwgraph::get_max_clique,
              "Find a maximum clique in graph within the given bounds",
              "lower_bound"_a = 1, "upper_bound"_a = 0xFFFF, "use_heuristic"_a = true,
-             "use_dfs"_a = true)
+             "use_dfs"_a = true, "use_bitmatrix"_a = false, "n_threads"_a = 1,
+             "time_limit"_a = -1.0, "continue_search"_a = false, release_gil())
         .def("get_clique_weight", &pynwgraph::get_clique_weight,
              "calculate the weight of the given clique in this graph", "clique"_a)
         .def("reset_search", &pynwgraph::reset_search,
-             "Reset the clique search to try with different parameters")
+             "Reset the clique search to try with different parameters", release_gil())
         .def("_get_vertex_weights", &pynwgraph::get_all_weights,
              "return the weights of all the vertices")
         .def("_vertex_neighbors", &pynwgraph::get_vertex_data,
              "Return the neighbors of the given vertex", "v"_a)
         .def("_get_correspondence", &pynwgraph::get_correspondence, "len1"_a, "len2"_a,
              "lower_bound"_a = 1, "upper_bound"_a = 0xFFFF, "use_heuristic"_a = true,
-             "use_dfs"_a = true)
+             "use_dfs"_a = true, "use_bitmatrix"_a = false, "n_threads"_a = 1,
+             "time_limit"_a = -1.0, "continue_search"_a = false, release_gil())
         .def(
             "all_cliques",
             [](py::object s, double clique_size)
@@ -119,13 +148,13 @@ void init_pygraph(pybind11::module& m)
                     "Constructs `NWGraph` instance from the given adjacency list and "
                     "vertex weights",
                     arg("num_vertices"), arg("num_edges"), arg("edges"), arg("weights"),
-                    py::return_value_policy::move)
+                    py::return_value_policy::move, release_gil())
         .def("to_edgelist", &pynwgraph::to_edgelist,
              "Exports `NWGraph` instance to an edge list")
         .def("to_matrix", &pynwgraph::to_adj_matrix,
              "Exports `NWGraph` instance to a boolean matrix")
         .def("to_adjlist", &pynwgraph::to_adj_list,
-             "Exports `NWGraph` instance to an adjacency list")
+             "Exports `NWGraph` instance to an adjacency list", release_gil())
         .def("__repr__", &pynwgraph::showdata)
         .def("__str__", &pynwgraph::showdata);
 }
@@ -0,0 +1,102 @@
+#ifndef ADJMAT_H
+#define ADJMAT_H
+
+/* adjmat.h
+ *
+ * The adjMatrix class stores the adjacency between the neighbors of a single
+ * vertex (the root of a subtree in the clique search) as a bitmatrix: row j is
+ * a graphBits over the neighbors of the root, with bit k set if neighbor j and
+ * neighbor k are adjacent. The clique search can then update a candidate set
+ * with a single word-parallel cand &= row(j), instead of calling binary_find
+ * on the edge list for every candidate.
+ *
+ * Only the rows of the given candidates are filled, because the search never
+ * needs the other rows. The memory is owned by the adjMatrix and reused for
+ * every root vertex, because it is quadratic in the degree of the root;
+ * load() refuses roots whose bitmatrix is larger than MAX_WORDS, and the
+ * search falls back to binary_find for those.
+ *
+ * load() is a template because the graph and nwgraph classes have different
+ * vertex types, but the same layout of the edge list. The merge in load_rows
+ * is also a template over the width of the edge list (u32 or u64), so that
+ * load() selects the width once instead of on every access.
+ */
+
+#include <detail/gbits.h>
+#include <detail/edgelist.h>
+
+namespace cliquematch
+{
+namespace detail
+{
+    class adjMatrix
+    {
+       private:
+        std::vector<u64> data;
+        u64 N;             // number of neighbors of the root (i.e. rows, columns)
+        u64 request_size;  // number of u64s in each row
+
+       public:
+        // 2^24 u64s = 128MB, i.e. roots with up to ~32000 neighbors
+        static constexpr u64 MAX_WORDS = 1ULL << 24;
+        adjMatrix() : N(0), request_size(0){};
+
+        graphBits row(const u64 j)
+        {
+            return graphBits(&(this->data[j * this->request_size]), this->N);
+        }
+        bool adjacent(const u64 j, const u64 k) const
+        {
+            return (this->data[j * this->request_size + (k >> 6)] &
+                    (MSB_64 >> (k & 0x3fu))) != 0;
+        }
+
+        // fill the rows of the candidates of cur; return false if too large
+        template <typename Vertex>
+        bool load(const edgeList& edge_list, const std::vector<Vertex>& vertices,
+                  const u64 cur, graphBits& cand)
+        {
+            this->N = vertices[cur].N;
+            this->request_size = (N % BITS_PER_U64 != 0) + N / BITS_PER_U64;
+            if (N * request_size > MAX_WORDS) return false;
+            if (this->data.size() < N * request_size)
+                this->data.resize(N * request_size);
+
+            if (edge_list.is_narrow())
+                load_rows(edge_list.data32(), vertices, cur, cand);
+            else
+                load_rows(edge_list.data64(), vertices, cur, cand);
+            return true;
+        }
+
+       private:
+        template <typename T, typename Vertex>
+        void load_rows(const T* edge_list, const std::vector<Vertex>& vertices,
+                       const u64 cur, graphBits& cand)
+        {
+            const Vertex& root = vertices[cur];
+            u64 j, k, start, vert;
+            // both edge lists are sorted, so row j is a merge of the
+            // edge lists of cur and vert (the neighbor at position j)
+            for (j = cand.next(0); j < N; j = cand.next(j + 1))
+            {
+                graphBits r(&(this->data[j * request_size]), N, true);
+                vert = edge_list[root.elo + j];
+                start = 0;
+                for (k = 0; k < N && start < vertices[vert].N; k++)
+                {
+                    while (start < vertices[vert].N &&
+                           edge_list[vertices[vert].elo + start] <
+                               edge_list[root.elo + k])
+                        start++;
+                    if (start < vertices[vert].N &&
+                        edge_list[vertices[vert].elo + start] ==
+                            edge_list[root.elo + k])
+                        r.set(k);
+                }
+            }
+        }
+    };
+}  // namespace detail
+}  // namespace cliquematch
+#endif /* ADJMAT_H */
@@ -0,0 +1,361 @@
+/* bitops.cpp
+ *
+ * Scalar and vectorized kernels for the "set"-like operations of graphBits,
+ * and the runtime selection of the kernels for the CPU (see bitops.h).
+ *
+ * All the kernels of a table must give identical results; compare with the
+ * scalar kernels when changing the implementation.
+ */
+
+#include <detail/bitops.h>
+
+// x86-64 only: the 64-bit lane intrinsics (_mm_cvtsi128_si64 and friends)
+// are not declared for 32-bit x86
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__x86_64__)
+#define CM_BITOPS_X86 1
+#include <immintrin.h>
+#endif
+
+#if defined(__aarch64__) && !defined(_MSC_VER)
+#define CM_BITOPS_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace cliquematch
+{
+namespace detail
+{
+    /* scalar kernels, work everywhere */
+    static u64 count_scalar(const u64* a, const u64 N)
+    {
+        u64 sum = 0;
+        for (u64 i = 0; i < N; i++) sum += bitcount(a[i]);
+        return sum;
+    }
+
+    static u64 and_count_scalar(const u64* a, const u64* b, const u64 N)
+    {
+        u64 sum = 0;
+        for (u64 i = 0; i < N; i++) sum += bitcount(a[i] & b[i]);
+        return sum;
+    }
+
+    static bool and_empty_scalar(const u64* a, const u64* b, const u64 N)
+    {
+        for (u64 i = 0; i < N; i++)
+            if (a[i] & b[i]) return false;
+        return true;
+    }
+
+    static void and_with_scalar(u64* a, const u64* b, const u64 N)
+    {
+        for (u64 i = 0; i < N; i++) a[i] &= b[i];
+    }
+
+    static void or_with_scalar(u64* a, const u64* b, const u64 N)
+    {
+        for (u64 i = 0; i < N; i++) a[i] |= b[i];
+    }
+
+    static void xor_with_scalar(u64* a, const u64* b, const u64 N)
+    {
+        for (u64 i = 0; i < N; i++) a[i] ^= b[i];
+    }
+
+    static void andnot_with_scalar(u64* a, const u64* b, const u64 N)
+    {
+        for (u64 i = 0; i < N; i++) a[i] &= ~b[i];
+    }
+
+    static const bitOps SCALAR_OPS = {
+        "scalar",        count_scalar,   and_count_scalar, and_empty_scalar,
+        and_with_scalar, or_with_scalar, xor_with_scalar,  andnot_with_scalar};
+
+#ifdef CM_BITOPS_X86
+/* AVX2 kernels, 4 words at a time. AVX2 has no popcount instruction, so the
+ * bits are counted with a lookup table of nibbles via vpshufb (Mula et al.),
+ * and the byte counts summed into 64-bit lanes with vpsadbw. */
+#define CM_AVX2 __attribute__((target("avx2,popcnt")))
+
+    CM_AVX2 static inline __m256i popcount_avx2(const __m256i v)
+    {
+        const __m256i lookup =
+            _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4, 0, 1, 1,
+                             2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+        const __m256i low_mask = _mm256_set1_epi8(0x0f);
+        const __m256i lo = _mm256_and_si256(v, low_mask);
+        const __m256i hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), low_mask);
+        const __m256i cnt = _mm256_add_epi8(_mm256_shuffle_epi8(lookup, lo),
+                                            _mm256_shuffle_epi8(lookup, hi));
+        return _mm256_sad_epu8(cnt, _mm256_setzero_si256());
+    }
+
+    CM_AVX2 static inline __m256i load_avx2(const u64* p)
+    {
+        return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    }
+
+    CM_AVX2 static inline u64 hsum_avx2(const __m256i v)
+    {
+        const __m128i s = _mm_add_epi64(_mm256_castsi256_si128(v),
+                                        _mm256_extracti128_si256(v, 1));
+        return static_cast<u64>(_mm_cvtsi128_si64(s)) +
+               static_cast<u64>(_mm_extract_epi64(s, 1));
+    }
+
+    CM_AVX2 static u64 count_avx2(const u64* a, const u64 N)
+    {
+        __m256i acc = _mm256_setzero_si256();
+        u64 i = 0;
+        for (; i + 4 <= N; i += 4)
+        {
+            const __m256i va = load_avx2(a + i);
+            acc = _mm256_add_epi64(acc, popcount_avx2(va));
+        }
+        u64 sum = hsum_avx2(acc);
+        for (; i < N; i++) sum += __builtin_popcountll(a[i]);
+        return sum;
+    }
+
+    CM_AVX2 static u64 and_count_avx2(const u64* a, const u64* b, const u64 N)
+    {
+        __m256i acc = _mm256_setzero_si256();
+        u64 i = 0;
+        for (; i + 4 <= N; i += 4)
+        {
+            const __m256i va = load_avx2(a + i);
+            const __m256i vb = load_avx2(b + i);
+            acc = _mm256_add_epi64(acc, popcount_avx2(_mm256_and_si256(va, vb)));
+        }
+        u64 sum = hsum_avx2(acc);
+        for (; i < N; i++) sum += __builtin_popcountll(a[i] & b[i]);
+        return sum;
+    }
+
+    CM_AVX2 static bool and_empty_avx2(const u64* a, const u64* b, const u64 N)
+    {
+        u64 i = 0;
+        for (; i + 4 <= N; i += 4)
+        {
+            const __m256i va = load_avx2(a + i);
+            const __m256i vb = load_avx2(b + i);
+            if (!_mm256_testz_si256(va, vb)) return false;
+        }
+        for (; i < N; i++)
+            if (a[i] & b[i]) return false;
+        return true;
+    }
+
+#define CM_AVX2_INPLACE(NAME, VOP, SOP)                                             \
+    CM_AVX2 static void NAME(u64* a, const u64* b, const u64 N)                    \
+    {                                                                              \
+        u64 i = 0;                                                                 \
+        for (; i + 4 <= N; i += 4)                                                 \
+        {                                                                          \
+            const __m256i va = load_avx2(a + i);                                   \
+            const __m256i vb = load_avx2(b + i);                                   \
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(a + i), VOP);           \
+        }                                                                          \
+        for (; i < N; i++) a[i] = SOP;                                             \
+    }
+
+    CM_AVX2_INPLACE(and_with_avx2, _mm256_and_si256(va, vb), a[i] & b[i])
+    CM_AVX2_INPLACE(or_with_avx2, _mm256_or_si256(va, vb), a[i] | b[i])
+    CM_AVX2_INPLACE(xor_with_avx2, _mm256_xor_si256(va, vb), a[i] ^ b[i])
+    // _mm256_andnot_si256(x, y) is ~x & y
+    CM_AVX2_INPLACE(andnot_with_avx2, _mm256_andnot_si256(vb, va), a[i] & ~b[i])
+
+    static const bitOps AVX2_OPS = {
+        "avx2",        count_avx2,   and_count_avx2, and_empty_avx2,
+        and_with_avx2, or_with_avx2, xor_with_avx2,  andnot_with_avx2};
+
+/* AVX-512 kernels, 8 words at a time. VPOPCNTDQ counts the bits of each
+ * 64-bit lane directly, and the last partial vector is handled with a mask
+ * instead of a scalar loop. */
+#define CM_AVX512 __attribute__((target("avx512f,avx512vpopcntdq")))
+
+    CM_AVX512 static inline __mmask8 tail_mask(const u64 n) { return (1u << n) - 1; }
+
+    // not _mm512_reduce_add_epi64 or _mm512_andnot_si512, because GCC 12
+    // warns about the uninitialized vectors used inside them
+    CM_AVX512 static inline u64 hsum_avx512(const __m512i v)
+    {
+        u64 lanes[8];
+        _mm512_storeu_si512(lanes, v);
+        return lanes[0] + lanes[1] + lanes[2] + lanes[3] + lanes[4] + lanes[5] +
+               lanes[6] + lanes[7];
+    }
+
+    CM_AVX512 static u64 count_avx512(const u64* a, const u64 N)
+    {
+        __m512i acc = _mm512_setzero_si512();
+        u64 i = 0;
+        for (; i + 8 <= N; i += 8)
+            acc = _mm512_add_epi64(acc, _mm512_popcnt_epi64(_mm512_loadu_si512(a + i)));
+        if (i < N)
+        {
+            const __m512i va = _mm512_maskz_loadu_epi64(tail_mask(N - i), a + i);
+            acc = _mm512_add_epi64(acc, _mm512_popcnt_epi64(va));
+        }
+        return hsum_avx512(acc);
+    }
+
+    CM_AVX512 static u64 and_count_avx512(const u64* a, const u64* b, const u64 N)
+    {
+        __m512i acc = _mm512_setzero_si512();
+        u64 i = 0;
+        for (; i + 8 <= N; i += 8)
+        {
+            const __m512i v =
+                _mm512_and_si512(_mm512_loadu_si512(a + i), _mm512_loadu_si512(b + i));
+            acc = _mm512_add_epi64(acc, _mm512_popcnt_epi64(v));
+        }
+        if (i < N)
+        {
+            const __mmask8 m = tail_mask(N - i);
+            const __m512i v = _mm512_and_si512(_mm512_maskz_loadu_epi64(m, a + i),
+                                               _mm512_maskz_loadu_epi64(m, b + i));
+            acc = _mm512_add_epi64(acc, _mm512_popcnt_epi64(v));
+        }
+        return hsum_avx512(acc);
+    }
+
+    CM_AVX512 static bool and_empty_avx512(const u64* a, const u64* b, const u64 N)
+    {
+        u64 i = 0;
+        for (; i + 8 <= N; i += 8)
+        {
+            if (_mm512_test_epi64_mask(_mm512_loadu_si512(a + i),
+                                       _mm512_loadu_si512(b + i)))
+                return false;
+        }
+        if (i < N)
+        {
+            const __mmask8 m = tail_mask(N - i);
+            return _mm512_mask_test_epi64_mask(m, _mm512_maskz_loadu_epi64(m, a + i),
+                                               _mm512_maskz_loadu_epi64(m, b + i)) == 0;
+        }
+        return true;
+    }
+
+#define CM_AVX512_INPLACE(NAME, VOP)                                                \
+    CM_AVX512 static void NAME(u64* a, const u64* b, const u64 N)                  \
+    {                                                                              \
+        u64 i = 0;                                                                 \
+        for (; i + 8 <= N; i += 8)                                                 \
+        {                                                                          \
+            const __m512i va = _mm512_loadu_si512(a + i);                          \
+            const __m512i vb = _mm512_loadu_si512(b + i);                          \
+            _mm512_storeu_si512(a + i, VOP);                                       \
+        }                                                                          \
+        if (i < N)                                                                 \
+        {                                                                          \
+            const __mmask8 m = tail_mask(N - i);                                   \
+            const __m512i va = _mm512_maskz_loadu_epi64(m, a + i);                 \
+            const __m512i vb = _mm512_maskz_loadu_epi64(m, b + i);                 \
+            _mm512_mask_storeu_epi64(a + i, m, VOP);                               \
+        }                                                                          \
+    }
+
+    CM_AVX512_INPLACE(and_with_avx512, _mm512_and_si512(va, vb))
+    CM_AVX512_INPLACE(or_with_avx512, _mm512_or_si512(va, vb))
+    CM_AVX512_INPLACE(xor_with_avx512, _mm512_xor_si512(va, vb))
+    CM_AVX512_INPLACE(andnot_with_avx512,
+                      _mm512_and_si512(va, _mm512_xor_si512(vb, _mm512_set1_epi64(-1))))
+
+    static const bitOps AVX512_OPS = {
+        "avx512",        count_avx512,   and_count_avx512, and_empty_avx512,
+        and_with_avx512, or_with_avx512, xor_with_avx512,  andnot_with_avx512};
+
+    static bool has_avx2()
+    {
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt");
+    }
+
+    static bool has_avx512()
+    {
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx512f") &&
+               __builtin_cpu_supports("avx512vpopcntdq");
+    }
+#endif /* CM_BITOPS_X86 */
+
+#ifdef CM_BITOPS_NEON
+    /* NEON kernels, 2 words at a time. NEON is part of ARMv8, so these do not
+     * need a runtime check. vcntq_u8 counts the bits of each byte, and the 16
+     * byte counts (at most 128 in total) are summed with vaddlvq_u8. */
+    static u64 count_neon(const u64* a, const u64 N)
+    {
+        u64 sum = 0, i = 0;
+        for (; i + 2 <= N; i += 2)
+            sum += vaddlvq_u8(vcntq_u8(vreinterpretq_u8_u64(vld1q_u64(a + i))));
+        for (; i < N; i++) sum += bitcount(a[i]);
+        return sum;
+    }
+
+    static u64 and_count_neon(const u64* a, const u64* b, const u64 N)
+    {
+        u64 sum = 0, i = 0;
+        for (; i + 2 <= N; i += 2)
+        {
+            const uint64x2_t v = vandq_u64(vld1q_u64(a + i), vld1q_u64(b + i));
+            sum += vaddlvq_u8(vcntq_u8(vreinterpretq_u8_u64(v)));
+        }
+        for (; i < N; i++) sum += bitcount(a[i] & b[i]);
+        return sum;
+    }
+
+    static bool and_empty_neon(const u64* a, const u64* b, const u64 N)
+    {
+        u64 i = 0;
+        for (; i + 2 <= N; i += 2)
+        {
+            const uint64x2_t v = vandq_u64(vld1q_u64(a + i), vld1q_u64(b + i));
+            if (vmaxvq_u32(vreinterpretq_u32_u64(v))) return false;
+        }
+        for (; i < N; i++)
+            if (a[i] & b[i]) return false;
+        return true;
+    }
+
+#define CM_NEON_INPLACE(NAME, VOP, SOP)                                        \
+    static void NAME(u64* a, const u64* b, const u64 N)                       \
+    {                                                                         \
+        u64 i = 0;                                                            \
+        for (; i + 2 <= N; i += 2)                                            \
+        {                                                                     \
+            const uint64x2_t va = vld1q_u64(a + i);                           \
+            const uint64x2_t vb = vld1q_u64(b + i);                           \
+            vst1q_u64(a + i, VOP);                                            \
+        }                                                                     \
+        for (; i < N; i++) a[i] = SOP;                                        \
+    }
+
+    CM_NEON_INPLACE(and_with_neon, vandq_u64(va, vb), a[i] & b[i])
+    CM_NEON_INPLACE(or_with_neon, vorrq_u64(va, vb), a[i] | b[i])
+    CM_NEON_INPLACE(xor_with_neon, veorq_u64(va, vb), a[i] ^ b[i])
+    // vbicq_u64(x, y) is x & ~y
+    CM_NEON_INPLACE(andnot_with_neon, vbicq_u64(va, vb), a[i] & ~b[i])
+
+    static const bitOps NEON_OPS = {
+        "neon",        count_neon,   and_count_neon, and_empty_neon,
+        and_with_neon, or_with_neon, xor_with_neon,  andnot_with_neon};
+#endif /* CM_BITOPS_NEON */
+
+    // the fastest kernels supported by the CPU
+    static bitOps pick_bit_ops()
+    {
+#ifdef CM_BITOPS_X86
+        if (has_avx512()) return AVX512_OPS;
+        if (has_avx2()) return AVX2_OPS;
+#endif
+#ifdef CM_BITOPS_NEON
+        return NEON_OPS;
+#endif
+        return SCALAR_OPS;
+    }
+
+    bitOps BIT_OPS = pick_bit_ops();
+}  // namespace detail
+}  // namespace cliquematch
@@ -0,0 +1,59 @@
+#ifndef BITOPS_H
+#define BITOPS_H
+
+/* bitops.h
+ *
+ * Kernels for the "set"-like operations of graphBits, on arrays of 64-bit
+ * values. The clique search calls these millions of times on large
+ * neighborhoods, so there are vectorized versions (AVX2 and AVX-512 on x86-64
+ * with GCC/Clang, NEON on ARM64) along with the portable scalar version.
+ *
+ * The kernels are held in a bitOps table of function pointers, and the table
+ * for the CPU is picked once at startup. The x86 versions are compiled with
+ * function-level target attributes, so the library does not need -mavx2 and
+ * still runs on older CPUs; NEON is always available on ARM64.
+ *
+ * The kernels operate on all N words: the CALLER (graphBits) is responsible
+ * for the padding bits in the last word.
+ */
+
+#include <detail/utils.h>
+
+namespace cliquematch
+{
+namespace detail
+{
+    // returns the number of bits on in n
+    inline u64 bitcount(u64 n)
+    {
+        n = n - ((n >> 1) & 0x5555555555555555);
+        n = (n & 0x3333333333333333) + ((n >> 2) & 0x3333333333333333);
+        n = (n + (n >> 4)) & 0x0f0f0f0f0f0f0f0f;
+        n = n + (n >> 8);
+        n = n + (n >> 16);
+        n = n + (n >> 32);
+        return (n & 0x7f);
+    }
+
+    struct bitOps
+    {
+        const char* name;
+        u64 (*count)(const u64* a, const u64 N);                   // |a|
+        u64 (*and_count)(const u64* a, const u64* b, const u64 N);  // |a & b|
+        bool (*and_empty)(const u64* a, const u64* b, const u64 N);  // a & b == 0
+        void (*and_with)(u64* a, const u64* b, const u64 N);        // a &= b
+        void (*or_with)(u64* a, const u64* b, const u64 N);         // a |= b
+        void (*xor_with)(u64* a, const u64* b, const u64 N);        // a ^= b
+        void (*andnot_with)(u64* a, const u64* b, const u64 N);     // a &= ~b
+    };
+
+    // the kernels used by graphBits, picked for the CPU at startup
+    extern bitOps BIT_OPS;
+
+    // arrays shorter than this are faster with the scalar loop than the
+    // vectorized kernel, because of the function call through BIT_OPS
+    constexpr u64 BIT_OPS_MIN_WORDS = 8;
+}  // namespace detail
+}  // namespace cliquematch
+
+#endif /* BITOPS_H */
@@ -0,0 +1,152 @@
+#include <detail/csrbuilder.h>
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+namespace cliquematch
+{
+namespace detail
+{
+    static std::runtime_error builder_error(const std::string& msg, int line)
+    {
+        return std::runtime_error(msg + "\n" + std::string(__FILE__) + "  " +
+                                  std::to_string(line) + "\n");
+    }
+
+    csrBuilder::csrBuilder(const u64 n_vert)
+    {
+        this->n_vert = n_vert + 1;
+        this->filling = false;
+        this->narrow = (this->n_vert - 1 <= UINT32_MAX);
+        cursor.reset(new std::atomic<u64>[this->n_vert]);
+        for (u64 i = 0; i < this->n_vert; i++)
+            cursor[i].store(0, std::memory_order_relaxed);
+    }
+
+    void csrBuilder::start_fill(u64 n_threads)
+    {
+        if (filling) throw builder_error("csrBuilder is already filled", __LINE__);
+        filling = true;
+
+        /* offsets is a prefix sum of the degrees (plus one extra space in each
+         * list for the vertex itself), computed in blocks of vertices: first
+         * the sum of each block, then the offsets within each block, starting
+         * after the sum of the blocks before it
+         */
+        n_threads = resolve_threads(n_threads, n_vert);
+        const u64 n_blocks = (n_threads == 1) ? 1 : 8 * n_threads;
+        std::vector<u64> block_start(n_blocks + 1, 0);
+        parallel_for(n_threads, n_blocks,
+                     [this, &block_start, n_blocks](u64 b)
+                     {
+                         u64 v = b * n_vert / n_blocks, sum = 0;
+                         const u64 v_end = (b + 1) * n_vert / n_blocks;
+                         for (; v < v_end; v++)
+                             sum += 1 + cursor[v].load(std::memory_order_relaxed);
+                         block_start[b + 1] = sum;
+                     });
+        for (u64 b = 0; b < n_blocks; b++) block_start[b + 1] += block_start[b];
+
+        const u64 total = block_start[n_blocks];
+        offsets.resize(n_vert + 1);
+        offsets[n_vert] = total;
+        if (narrow)
+            neighbors32.resize(total);
+        else
+            neighbors.resize(total);
+
+        parallel_for(n_threads, n_blocks,
+                     [this, &block_start, n_blocks](u64 b)
+                     {
+                         u64 v = b * n_vert / n_blocks, pos = block_start[b];
+                         const u64 v_end = (b + 1) * n_vert / n_blocks;
+                         for (; v < v_end; v++)
+                         {
+                             offsets[v] = pos;
+                             set_entry(pos, v);
+                             pos += 1 + cursor[v].load(std::memory_order_relaxed);
+                             cursor[v].store(pos, std::memory_order_relaxed);
+                         }
+                     });
+    }
+
+    template <typename T>
+    void csrBuilder::finish_lists(std::vector<T>& lists, u64 n_threads)
+    {
+        /* sort the lists in blocks of vertices, and store the length of each
+         * list without duplicates in cursor. The blocks have about the same
+         * number of edges, instead of the same number of vertices, and a list
+         * longer than a block (i.e. a vertex with a very high degree) is left
+         * out of the blocks and sorted on all the threads afterwards
+         */
+        T* base = lists.data();
+        const u64 total = lists.size();
+        n_threads = resolve_threads(n_threads, total);
+        const u64 n_blocks = (n_threads == 1) ? 1 : 8 * n_threads;
+        const u64 max_len =
+            (n_threads == 1) ? total : std::max(PARALLEL_MIN_LEN, total / n_blocks);
+
+        std::vector<u64> block_start(n_blocks + 1, n_vert);
+        for (u64 b = 0; b < n_blocks; b++)
+        {
+            block_start[b] = std::lower_bound(offsets.begin(), offsets.begin() + n_vert,
+                                              b * total / n_blocks) -
+                             offsets.begin();
+        }
+        parallel_for(n_threads, n_blocks,
+                     [this, base, max_len, &block_start](u64 b)
+                     {
+                         for (u64 v = block_start[b]; v < block_start[b + 1]; v++)
+                         {
+                             T* beg = base + offsets[v];
+                             T* end = base + offsets[v + 1];
+                             if (static_cast<u64>(end - beg) > max_len) continue;
+                             std::sort(beg, end);
+                             end = std::unique(beg, end);
+                             cursor[v].store(end - beg, std::memory_order_relaxed);
+                         }
+                     });
+
+        u64 v, len, pos = 0;
+        for (v = 0; v < n_vert && n_threads > 1; v++)
+        {
+            T* beg = base + offsets[v];
+            T* end = base + offsets[v + 1];
+            if (static_cast<u64>(end - beg) <= max_len) continue;
+            parallel_sort(beg, end, n_threads);
+            end = std::unique(beg, end);
+            cursor[v].store(end - beg, std::memory_order_relaxed);
+        }
+
+        // move the lists together, removing the gaps left by duplicates
+        for (v = 0; v < n_vert; v++)
+        {
+            len = cursor[v].load(std::memory_order_relaxed);
+            if (pos != offsets[v])
+                std::copy(base + offsets[v], base + offsets[v] + len, base + pos);
+            offsets[v] = pos;
+            pos += len;
+        }
+        offsets[n_vert] = pos;
+        lists.resize(pos);
+    }
+
+    void csrBuilder::finish(u64 n_threads)
+    {
+        u64 i;
+        if (!filling) throw builder_error("csrBuilder was not filled", __LINE__);
+        // every list is full only if the same edges were counted and added
+        for (i = 0; i < n_vert; i++)
+        {
+            if (cursor[i].load(std::memory_order_relaxed) != offsets[i] + 1)
+                throw builder_error("Edges added do not match edges counted", __LINE__);
+        }
+
+        if (narrow)
+            finish_lists(neighbors32, n_threads);
+        else
+            finish_lists(neighbors, n_threads);
+        cursor.reset();
+    }
+}  // namespace detail
+}  // namespace cliquematch
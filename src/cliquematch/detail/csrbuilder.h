@@ -0,0 +1,103 @@
+#ifndef CSRBUILDER_H
+#define CSRBUILDER_H
+
+/* csrbuilder.h
+ *
+ * csrBuilder constructs the lists of neighbors of a graph directly in their
+ * final (compressed sparse row) layout, in two passes over the edges:
+ *
+ * 1) count: count(v1, v2) for each edge increases the degrees of v1 and v2
+ * 2) fill: start_fill() allocates the exact space for each list, and then
+ * add(v1, v2) for each edge places v1 and v2 in each other's list.
+ *
+ * The graph constructors then sort and deduplicate each list (finish). Both
+ * passes must be given the same edges (in any order), so a CALLER either
+ * generates its edges twice, or uses count_neighbors if it knows the degrees
+ * beforehand. An edge given only in the fill pass is ignored, and one given
+ * only in the count pass leaves a hole, which finish reports as an error.
+ *
+ * The builder stores each edge twice in one vector (16 bytes per edge),
+ * allocated once, and the graph uses that vector as its edge_list. If all
+ * vertex IDs fit in a u32, the vector holds u32s (8 bytes per edge), and the
+ * graph keeps them as u32s as well (see edgelist.h).
+ *
+ * Vertex 0 is a sentinel, and each vertex is its own neighbor; loops, and
+ * edges containing a vertex > n_vert, are ignored.
+ * count/count_neighbors/add update the degrees and positions atomically, so
+ * they can be called from multiple threads (but not during start_fill).
+ */
+
+#include <detail/utils.h>
+#include <atomic>
+#include <memory>
+
+namespace cliquematch
+{
+namespace detail
+{
+    class csrBuilder
+    {
+       private:
+        u64 n_vert;                   // number of vertices, including 0
+        std::vector<u64> offsets;     // vertex i has neighbors[offsets[i]:offsets[i+1]]
+        std::vector<u64> neighbors;   // the lists of neighbors, one after the other
+        std::vector<u32> neighbors32;  // (used instead of neighbors if narrow)
+        std::unique_ptr<std::atomic<u64>[]> cursor;  // degree, then fill position
+        bool filling;
+        bool narrow;  // true if the vertex IDs fit in a u32
+
+        void set_entry(const u64 pos, const u64 nb)
+        {
+            if (narrow)
+                neighbors32[pos] = static_cast<u32>(nb);
+            else
+                neighbors[pos] = nb;
+        }
+        // the lists are filled from the back; the front holds the vertex itself
+        void place(const u64 v, const u64 nb)
+        {
+            const u64 pos = cursor[v].fetch_sub(1, std::memory_order_relaxed) - 1;
+            if (pos > offsets[v] && pos < offsets[v + 1]) set_entry(pos, nb);
+        }
+        // sort each list, remove duplicates, and move the lists together;
+        // throws error if the edges added do not match the edges counted
+        void finish(u64 n_threads = 0);
+        template <typename T>
+        void finish_lists(std::vector<T>& lists, u64 n_threads);
+
+       public:
+        // vertices are numbered from 1 to n_vert
+        explicit csrBuilder(const u64 n_vert);
+
+        // pass 1: returns false if the edge is invalid (and so ignored)
+        bool count(const u64 v1, const u64 v2)
+        {
+            if (v1 >= n_vert || v2 >= n_vert || v1 == 0 || v2 == 0 || v1 == v2)
+                return false;
+            cursor[v1].fetch_add(1, std::memory_order_relaxed);
+            cursor[v2].fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+        // pass 1: add n neighbors (not counting v itself) to the degree of v
+        void count_neighbors(const u64 v, const u64 n)
+        {
+            cursor[v].fetch_add(n, std::memory_order_relaxed);
+        }
+        // allocate the lists after counting (n_threads = 0 uses all cores)
+        void start_fill(u64 n_threads = 0);
+        // pass 2
+        void add(const u64 v1, const u64 v2)
+        {
+            if (v1 >= n_vert || v2 >= n_vert || v1 == 0 || v2 == 0 || v1 == v2)
+                return;
+            place(v1, v2);
+            place(v2, v1);
+        }
+
+        friend class graph;
+        friend class nwgraph;
+    };
+}  // namespace detail
+}  // namespace cliquematch
+
+#endif /* CSRBUILDER_H */
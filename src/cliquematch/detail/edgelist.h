@@ -0,0 +1,62 @@
+#ifndef EDGELIST_H
+#define EDGELIST_H
+
+/* edgelist.h
+ *
+ * edgeList is a read-only view of the lists of neighbors of a graph, i.e. the
+ * raw edge data that each vertex refers to with its elo and N. The vertex IDs
+ * are stored as u32 if every ID of the graph fits in a u32, and as u64
+ * otherwise. u32s halve the memory used by the edges, and twice as many
+ * neighbors fit in a cache line during the binary_find in the clique search.
+ *
+ * The width is chosen once, when the graph is constructed (see csrbuilder.h),
+ * so the branch in operator[] and find() always goes the same way and is
+ * predicted correctly. The vertex data (N, elo, ebo, ...) remain u64, because
+ * the number of edges can exceed the number of vertices by far.
+ *
+ * edgeList does not manage any memory; the graph owns the lists (or maps them
+ * from a file) and has to keep them alive as long as the view is used.
+ */
+
+#include <detail/utils.h>
+
+namespace cliquematch
+{
+namespace detail
+{
+    class edgeList
+    {
+       private:
+        const u64* wide;
+        const u32* narrow;
+
+       public:
+        edgeList() : wide(nullptr), narrow(nullptr){};
+        explicit edgeList(const u64* wide) : wide(wide), narrow(nullptr){};
+        explicit edgeList(const u32* narrow) : wide(nullptr), narrow(narrow){};
+
+        bool is_narrow() const { return narrow != nullptr; }
+        // number of bytes used to store each vertex ID
+        u64 width() const { return narrow ? sizeof(u32) : sizeof(u64); }
+        const void* data() const
+        {
+            return narrow ? static_cast<const void*>(narrow)
+                          : static_cast<const void*>(wide);
+        }
+        // (for loops that select the width once, outside the loop)
+        const u32* data32() const { return narrow; }
+        const u64* data64() const { return wide; }
+
+        u64 operator[](const u64 k) const { return narrow ? narrow[k] : wide[k]; }
+
+        // binary_find on the N entries starting at offset
+        BFResult find(const u64 offset, const u64 N, const u64 val, u64& loc) const
+        {
+            return narrow ? binary_find(narrow + offset, N, val, loc)
+                          : binary_find(wide + offset, N, val, loc);
+        }
+    };
+}  // namespace detail
+}  // namespace cliquematch
+
+#endif /* EDGELIST_H */
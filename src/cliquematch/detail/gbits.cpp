@@ -1,42 +1,65 @@
 /* gbits.cpp
  *
  * Implementation of all the "set"-like operations in the graphBits class,
- * along with functions to display/return the set being represented.
+ * along with functions to display/return the set being represented. Sets of
+ * BIT_OPS_MIN_WORDS or more blocks use the kernels in bitops.h, smaller ones
+ * the plain loops here.
  */
 
 #include <detail/gbits.h>
+#include <detail/bitops.h>
 #include <iostream>
 
 namespace cliquematch
 {
 namespace detail
 {
-    // returns the number of bits on in n
-    static inline u64 bitcount(u64 n)
+    u64 graphBits::count() const
     {
-        n = n - ((n >> 1) & 0x5555555555555555);
-        n = (n & 0x3333333333333333) + ((n >> 2) & 0x3333333333333333);
-        n = (n + (n >> 4)) & 0x0f0f0f0f0f0f0f0f;
-        n = n + (n >> 8);
-        n = n + (n >> 16);
-        n = n + (n >> 32);
-        return (n & 0x7f);
+        u64 dlen = ((this->valid_len & 0x3fu) != 0) + (this->valid_len >> 6);
+        this->data[dlen - 1] &= this->pad_cover;
+        if (dlen >= BIT_OPS_MIN_WORDS) return BIT_OPS.count(this->data, dlen);
+        u64 sum = 0;
+        for (u64 i = 0; i < dlen; i++) sum += bitcount(this->data[i]);
+        return sum;
     }
 
-    u64 graphBits::count() const
+    // returns the number of bits on in (this & other), without modifying either
+    u64 graphBits::and_count(const graphBits& other) const
     {
         u64 sum = 0;
         u64 dlen = ((this->valid_len & 0x3fu) != 0) + (this->valid_len >> 6);
-        this->data[dlen - 1] &= this->pad_cover;
-        for (u64 i = 0; i < dlen; i++) sum += bitcount(this->data[i]);
+        if (dlen >= BIT_OPS_MIN_WORDS)
+            sum = BIT_OPS.and_count(this->data, other.data, dlen - 1);
+        else
+        {
+            for (u64 i = 0; i + 1 < dlen; i++)
+                sum += bitcount(this->data[i] & other.data[i]);
+        }
+        sum += bitcount(this->data[dlen - 1] & other.data[dlen - 1] & this->pad_cover);
         return sum;
     }
 
+    // returns true if (this & other) has no bits on, without modifying either
+    bool graphBits::and_empty(const graphBits& other) const
+    {
+        u64 dlen = ((this->valid_len & 0x3fu) != 0) + (this->valid_len >> 6);
+        if (this->data[dlen - 1] & other.data[dlen - 1] & this->pad_cover) return false;
+        if (dlen >= BIT_OPS_MIN_WORDS)
+            return BIT_OPS.and_empty(this->data, other.data, dlen - 1);
+        for (u64 i = 0; i + 1 < dlen; i++)
+            if (this->data[i] & other.data[i]) return false;
+        return true;
+    }
+
     graphBits& graphBits::operator&=(const graphBits& other)
     {
         // assert(this->valid_len == other.valid_len);
         u64 dlen = ((this->valid_len & 0x3fu) != 0) + (this->valid_len >> 6);
-        for (u64 i = 0; i < dlen; i++) { this->data[i] &= other.data[i]; }
+        if (dlen >= BIT_OPS_MIN_WORDS)
+            BIT_OPS.and_with(this->data, other.data, dlen);
+        else
+            for (u64 i = 0; i < dlen; i++) { this->data[i] &= other.data[i]; }
         this->data[dlen - 1] &= this->pad_cover;
         return *this;
     }
@@ -45,7 +68,10 @@ namespace detail
     {
         // assert(this->valid_len == other.valid_len);
         u64 dlen = ((this->valid_len & 0x3fu) != 0) + (this->valid_len >> 6);
-        for (u64 i = 0; i < dlen; i++) { this->data[i] |= other.data[i]; }
+        if (dlen >= BIT_OPS_MIN_WORDS)
+            BIT_OPS.or_with(this->data, other.data, dlen);
+        else
+            for (u64 i = 0; i < dlen; i++) { this->data[i] |= other.data[i]; }
         this->data[dlen - 1] &= this->pad_cover;
         return *this;
     }
@@ -54,7 +80,10 @@ namespace detail
     {
         // assert(this->valid_len == other.valid_len);
         u64 dlen = ((this->valid_len & 0x3fu) != 0) + (this->valid_len >> 6);
-        for (u64 i = 0; i < dlen; i++) { this->data[i] ^= other.data[i]; }
+        if (dlen >= BIT_OPS_MIN_WORDS)
+            BIT_OPS.xor_with(this->data, other.data, dlen);
+        else
+            for (u64 i = 0; i < dlen; i++) { this->data[i] ^= other.data[i]; }
         this->data[dlen - 1] &= this->pad_cover;
         return *this;
     }
@@ -63,7 +92,10 @@ namespace detail
     {
         // assert(this->valid_len == other.valid_len);
         u64 dlen = ((this->valid_len & 0x3fu) != 0) + (this->valid_len >> 6);
-        for (u64 i = 0; i < dlen; i++) { this->data[i] &= ~(other.data[i]); }
+        if (dlen >= BIT_OPS_MIN_WORDS)
+            BIT_OPS.andnot_with(this->data, other.data, dlen);
+        else
+            for (u64 i = 0; i < dlen; i++) { this->data[i] &= ~(other.data[i]); }
         this->data[dlen - 1] &= this->pad_cover;
         return *this;
     }
@@ -8,7 +8,8 @@
  * bitset. All the single-bit/frequently-called operations are kept in the
  * header, and all the "set"-like operations are in the implementation. Think
  * of it as a slim runtime-version of std::bitset crossed with std::span from
- * C++20.
+ * C++20. The "set"-like operations on large sets use the vectorized kernels
+ * in bitops.h.
  *
  * graphBits instances DO NOT check bounds while operating on the data.
  * Wherever possible, they use their dlen attribute (i.e. ceil(number of bits
@@ -101,7 +102,9 @@ namespace detail
             this->data = ext_data;  // CALLER gives me the data,
             // they should have initialized it and checked bounds
             this->valid_len = n_bits;
-            this->pad_cover = ALL_ONES << (64 - (n_bits & 0x3fu));
+            // if n_bits is a multiple of 64, all bits of the last block are used
+            this->pad_cover =
+                (n_bits & 0x3fu) ? ALL_ONES << (64 - (n_bits & 0x3fu)) : ALL_ONES;
             if (cleanout) this->clear();
         }
         void clear(const u64 N = 0)
@@ -155,6 +158,8 @@ namespace detail
 
         // u64 len() const { return this->valid_len; };
         u64 count() const;
+        u64 and_count(const graphBits& other) const;
+        bool and_empty(const graphBits& other) const;
         graphBits& operator&=(const graphBits& other);
         graphBits& operator|=(const graphBits& other);
         graphBits& operator^=(const graphBits& other);
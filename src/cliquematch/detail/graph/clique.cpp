@@ -2,7 +2,10 @@
  *
  * Contains graph member functions that compute/return cliques.
  * find_max_cliques() is just a wrapper over the preferred order of calling the
- * clique search operations.
+ * clique search operations. use_coloring and use_bitmatrix take priority over
+ * n_threads, as they only search on a single thread. With a time limit it
+ * uses StackDFS (or ColoringDFS), which keeps its stack when it runs out of
+ * time.
  */
 #include <detail/graph/graph.h>
 #include <detail/graph/dfs.h>
@@ -13,22 +16,61 @@ namespace cliquematch
 namespace detail
 {
     double graph::find_max_cliques(u64& start_vert, bool use_heur, bool use_dfs,
-                                   double time_limit)
+                                   double time_limit, u64 n_threads, bool use_coloring,
+                                   bool use_bitmatrix)
     {
         DegreeHeuristic heur;
+        // a paused search can only be continued by the next call
+        std::shared_ptr<StackDFS> paused = std::move(this->paused_dfs);
+        std::shared_ptr<ColoringDFS> paused_col = std::move(this->paused_coloring);
 
         this->start_time = std::chrono::steady_clock::now();
         if (use_heur) heur.process_graph((*this));
-        if (time_limit <= 0)
+        if (use_coloring && use_dfs)
         {
-            StackDFS dfs;
+            // continue the paused search as in the StackDFS case below
+            std::shared_ptr<ColoringDFS> dfs;
+            if (paused_col && start_vert != 0 && start_vert == paused_at)
+            {
+                dfs = std::move(paused_col);
+                dfs->resume(time_limit);
+            }
+            else
+                dfs = std::make_shared<ColoringDFS>(start_vert, time_limit);
+
+            this->start_time = std::chrono::steady_clock::now();
+            start_vert = dfs->process_graph((*this));
+            if (start_vert < this->n_vert)
+            {
+                paused_coloring = std::move(dfs);
+                paused_at = start_vert;
+            }
+        }
+        else if (time_limit <= 0 && n_threads != 1 && !use_bitmatrix)
+        {
+            ParallelDFS dfs(n_threads);
             if (use_dfs) start_vert = dfs.process_graph((*this));
         }
-        else
+        else if (use_dfs)
         {
-            RecursionDFS dfs(start_vert, time_limit);
+            // continue the paused search if it stopped at start_vert, otherwise
+            // start a new one from start_vert (a paused search is dropped)
+            std::shared_ptr<StackDFS> dfs;
+            if (paused && start_vert != 0 && start_vert == paused_at)
+            {
+                dfs = std::move(paused);
+                dfs->resume(time_limit);
+            }
+            else
+                dfs = std::make_shared<StackDFS>(start_vert, time_limit, use_bitmatrix);
+
             this->start_time = std::chrono::steady_clock::now();
-            if (use_dfs) start_vert = dfs.process_graph((*this));
+            start_vert = dfs->process_graph((*this));
+            if (start_vert < this->n_vert)
+            {
+                paused_dfs = std::move(dfs);
+                paused_at = start_vert;
+            }
         }
         return this->elapsed_time();
     }
@@ -39,7 +81,7 @@ namespace detail
     }
     std::vector<u64> graph::get_max_clique(u64 i) const
     {
-        return this->vertices[i].give_clique(this->edge_list.data());
+        return this->vertices[i].give_clique(this->edge_list);
     }
 }  // namespace detail
 }  // namespace cliquematch
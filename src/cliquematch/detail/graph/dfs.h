@@ -6,19 +6,48 @@
  * Contains the classes that perform depth-first search on a graph.
  *
  * StackDFS and RecursionDFS find only one maximum clique: both implement the
- * same algorithm.  StackDFS is faster: it doesn't check time, and is an
- * explicit version of the search using addtional memory to avoid steps.
+ * same algorithm.  StackDFS is faster: it is an explicit version of the
+ * search using addtional memory to avoid steps, and it checks the time only
+ * every CHECK_INTERVAL nodes. When it runs out of time, its stack is kept as
+ * is, so the search can be continued from the same node.
+ *
+ * ParallelDFS is StackDFS spread over multiple threads: each thread takes
+ * root vertices from a shared queue and searches them with its own stack and
+ * its own scratch memory. The size of the current maximum clique is shared
+ * between the threads, so every thread can prune with the best known clique.
+ * Once the queue is empty, idle threads steal unexplored subtrees from the
+ * bottom of the other threads' stacks.
+ *
+ * ColoringDFS also finds one maximum clique, but with a much tighter bound
+ * than the number of candidates: a greedy coloring of the candidates (as in
+ * the MCS/BBMC algorithms), computed on an adjacency bitmatrix of the root
+ * vertex's neighborhood. Coloring each node costs more, but prunes far more
+ * nodes on dense graphs. Like StackDFS, it keeps its stack when it runs out
+ * of time.
  *
  * CliqueEnumerator finds all cliques of a given size. It is similar to
  * StackDFS but the search can be resumed to find the next clique.
+ * ParallelEnumerator finds the same cliques on multiple threads, which put
+ * them in a bounded queue for the CALLER to take one at a time.
+ *
+ * MaximalEnumerator finds only the maximal cliques (optionally above a given
+ * size), with Bron-Kerbosch and Tomita-style pivoting. It can be resumed
+ * like CliqueEnumerator.
 
  * RecursionDFS is easiest to understand. Bugs/updates for the algorithm are
  * first tested with RecursionDFS.
  *
  */
 
+#include <detail/adjmat.h>
 #include <detail/graph/clique.h>
 #include <detail/graph/searchstate.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
 
 namespace cliquematch
 {
@@ -29,18 +58,116 @@ namespace detail
        private:
         std::vector<SearchState> states;  // used like a stack with push_back/pop_back
         std::vector<u64> to_remove;       // vertices to remove from a candidate
+        // the stack has to outlive a pause, so the memory is owned by the
+        // search instead of being taken from the graph (see ColoringDFS)
+        std::vector<u64> memory;
+        u64 mem_cur;
 
         // the below variables have equivalent declared locally
         // in the member functions of RecursionDFS.
         u64 candidates_left, clique_size, clique_potential;
-        u64 i, j, k, vert, start, ans;
+        u64 i, j, k, vert, start, ans, cur;
+
+        double TIME_LIMIT;  // <= 0 means no time limit
+        u64 n_nodes;        // nodes searched since the time was last checked
+
+        const bool use_bitmatrix;  // try to use adj for every root vertex
+        bool with_adj;             // adj is loaded for the current root vertex
+        adjMatrix adj;
+
+        u64* load_memory(const u64 N)
+        {
+            u64* loc = &(memory[mem_cur]);
+            mem_cur += N;
+            return loc;
+        }
+        void clear_memory(const u64 N)
+        {
+            mem_cur -= N;
+            for (u64 t = 0; t < N; t++) memory[mem_cur + t] = 0;
+        }
+        bool out_of_time(const graph& G)
+        {
+            if (++n_nodes < CHECK_INTERVAL) return false;
+            n_nodes = 0;
+            return (this->TIME_LIMIT > 0 && G.elapsed_time() > this->TIME_LIMIT) ||
+                   (G.interrupt && G.interrupt());
+        }
 
        public:
-        void process_vertex(graph&, u64);
+        bool load_vertex(graph&, u64);
+        bool search_vertex(graph&);
         u64 process_graph(graph&);
+        // true if the search was paused in the middle of a subtree
+        bool paused() const { return !states.empty(); }
+        // continue a paused search, with a new time limit
+        void resume(double t)
+        {
+            TIME_LIMIT = t;
+            n_nodes = 0;
+        }
+        // (the search starts from vertex v, or is a new search if v is 0)
+        StackDFS(u64 v = 0, double t = -1, bool use_bitmatrix = false)
+            : mem_cur(0), i(v), cur(0), TIME_LIMIT(t), n_nodes(0),
+              use_bitmatrix(use_bitmatrix), with_adj(false){};
         ~StackDFS() = default;
     };
 
+    class ParallelDFS : public CliqueOperator
+    {
+       private:
+        // everything a thread needs to run its own StackDFS:
+        // the memory is owned by the worker instead of being
+        // taken from the graph via load_memory/clear_memory
+        struct Worker
+        {
+            std::vector<SearchState> states;
+            std::vector<u64> to_remove;
+            std::vector<u64> memory;
+            u64 mem_cur;
+            u64 root;               // the vertex whose subtree is on the stack
+            std::mutex stack_lock;  // held when states is changed, or stolen from
+
+            Worker() : mem_cur(0), root(0){};
+            void reserve_memory(const u64 N);
+            u64* load_memory(const u64 N)
+            {
+                u64* loc = &(memory[mem_cur]);
+                mem_cur += N;
+                return loc;
+            }
+            void clear_memory(const u64 N)
+            {
+                mem_cur -= N;
+                for (u64 i = 0; i < N; i++) memory[mem_cur + i] = 0;
+            }
+        };
+
+        const u64 n_threads;
+        std::vector<std::unique_ptr<Worker>> workers;
+        u64 first_root;                    // G.CUR_MAX_CLIQUE_LOCATION at the start
+        std::atomic<u64> next_root;        // the shared queue of root vertices
+        std::atomic<u64> max_clique_size;  // shared copy of G.CUR_MAX_CLIQUE_SIZE
+        std::atomic<u64> n_busy;           // number of workers with a nonempty stack
+        std::mutex found_lock;             // held when G's clique data is changed
+
+        u64 current_max() const
+        {
+            return max_clique_size.load(std::memory_order_relaxed);
+        }
+        bool next_vertex(graph&, u64&);
+        bool steal_state(graph&, u64, u64&);
+        void save_clique(graph&, u64, const graphBits&, u64);
+        void run_worker(graph&, u64);
+        bool load_vertex(graph&, Worker&, u64);
+        void process_stack(graph&, Worker&, u64);
+
+       public:
+        u64 process_graph(graph&);
+        ParallelDFS(u64 n_threads);
+        ~ParallelDFS() = default;
+    };
+
     class RecursionDFS : public CliqueOperator
     {
        private:
@@ -55,6 +182,80 @@ namespace detail
         ~RecursionDFS() = default;
     };
 
+    class ColoringDFS : public CliqueOperator
+    {
+       private:
+        // one level of the search, i.e. one call of the recursive version:
+        // the candidates are colored when the level is first visited, and
+        // order[base:next] are the vertices still to be branched on
+        struct Level
+        {
+            graphBits cand;         // candidates at this level
+            graphBits future_cand;  // candidates of the level above
+            u64 clique_size;
+            u64 base, next;
+            u64 vert;  // the vertex in res while the level above is searched
+            bool colored;
+
+            Level(graphBits& c, u64 size, u64 N)
+                : clique_size(size), base(0), next(0), vert(N), colored(false)
+            {
+                cand.refer_from(c);
+            }
+        };
+
+        std::vector<Level> levels;  // used like a stack with push_back/pop_back
+        graphBits res;              // the clique, shared by all levels
+        u64 i, cur;
+
+        double TIME_LIMIT;  // <= 0 means no time limit
+        u64 n_nodes;        // nodes searched since the time was last checked
+
+        adjMatrix adj;            // adjacency bitmatrix of the root's neighborhood
+        std::vector<u64> memory;  // candidate sets for each level of the search
+        std::vector<u64> order;   // colored candidates for each level of the search
+        std::vector<u64> colors;  // color of each vertex in order
+        u64 mem_cur;
+
+        // roots whose bitmatrix is too large are searched without coloring
+        bool use_fallback;
+        StackDFS fallback;
+
+        u64* load_memory(const u64 N)
+        {
+            u64* loc = &(memory[mem_cur]);
+            mem_cur += N;
+            return loc;
+        }
+        void clear_memory(const u64 N) { mem_cur -= N; }
+        // (as in StackDFS)
+        bool out_of_time(const graph& G)
+        {
+            if (++n_nodes < CHECK_INTERVAL) return false;
+            n_nodes = 0;
+            return (this->TIME_LIMIT > 0 && G.elapsed_time() > this->TIME_LIMIT) ||
+                   (G.interrupt && G.interrupt());
+        }
+
+       public:
+        bool load_vertex(graph&, u64);
+        bool search_vertex(graph&);
+        void color_candidates(graph&, u64, const graphBits&, u64);
+        u64 process_graph(graph&);
+        // continue a paused search, with a new time limit
+        void resume(double t)
+        {
+            TIME_LIMIT = t;
+            n_nodes = 0;
+            fallback.resume(t);
+        }
+        // (the search starts from vertex v, or is a new search if v is 0)
+        ColoringDFS(u64 v = 0, double t = -1)
+            : i(v), cur(0), TIME_LIMIT(t), n_nodes(0), mem_cur(0), use_fallback(false),
+              fallback(0, t){};
+        ~ColoringDFS() = default;
+    };
+
     class CliqueEnumerator : public CliqueOperator
     {
        private:
@@ -64,15 +265,118 @@ namespace detail
         u64 j, k, vert, start, ans, cur;
         const u64 REQUIRED_SIZE;
 
+        const bool use_bitmatrix;  // try to use adj for every root vertex
+        bool with_adj;             // adj is loaded for the current root vertex
+        adjMatrix adj;
+
        public:
         u64 process_graph(graph&);
         void process_vertex(graph&);
         bool load_vertex(graph&);
-        CliqueEnumerator(u64 size) : cur(1), REQUIRED_SIZE(size){};
+        CliqueEnumerator(u64 size, bool use_bitmatrix = false)
+            : cur(0), REQUIRED_SIZE(size), use_bitmatrix(use_bitmatrix),
+              with_adj(false){};
         CliqueEnumerator() = delete;
         ~CliqueEnumerator() = default;
     };
 
+    class MaximalEnumerator : public CliqueOperator
+    {
+       private:
+        std::vector<PivotState> states;
+        std::vector<u64> memory;  // cand, excl, todo for each level of the search
+        u64 mem_cur, clique_size, j, cur;
+        const u64 MIN_SIZE;
+
+        bool with_adj;   // adj is loaded for the current root vertex
+        adjMatrix adj;   // (needed to choose the pivot, so always tried)
+        graphBits nbrs;  // scratch row, when adj could not be loaded
+
+        u64* load_memory(const u64 N)
+        {
+            u64* loc = &(memory[mem_cur]);
+            mem_cur += N;
+            return loc;
+        }
+        void clear_memory(const u64 N) { mem_cur -= N; }
+        graphBits neighbors(graph&, u64, graphBits&, graphBits&);
+        void choose_pivot(graph&, PivotState&);
+
+       public:
+        u64 process_graph(graph&);
+        void process_vertex(graph&);
+        bool load_vertex(graph&);
+        MaximalEnumerator(u64 min_size)
+            : mem_cur(0), clique_size(0), cur(0), MIN_SIZE(min_size), with_adj(false){};
+        MaximalEnumerator() = delete;
+        ~MaximalEnumerator() = default;
+    };
+
+    class ParallelEnumerator
+    {
+       private:
+        // everything a thread needs to run its own CliqueEnumerator
+        // (see ParallelDFS::Worker)
+        struct Worker
+        {
+            std::vector<SearchState> states;
+            std::vector<u64> to_remove;
+            std::vector<u64> memory;
+            u64 mem_cur;
+            bool with_adj;  // adj is loaded for the current root vertex
+            adjMatrix adj;
+
+            Worker() : mem_cur(0), with_adj(false){};
+            void reserve_memory(const u64 N);
+            u64* load_memory(const u64 N)
+            {
+                u64* loc = &(memory[mem_cur]);
+                mem_cur += N;
+                return loc;
+            }
+            void clear_memory(const u64 N)
+            {
+                mem_cur -= N;
+                for (u64 i = 0; i < N; i++) memory[mem_cur + i] = 0;
+            }
+        };
+
+        graph& G;  // the CALLER keeps G alive until the enumerator is destroyed
+        const u64 REQUIRED_SIZE;
+        const bool use_bitmatrix;
+        const u64 capacity;                   // maximum number of cliques in found
+        // copied from G by the constructor, because a search on G changes them
+        // while the threads are running
+        u64 clique_limit;                     // G.CLIQUE_LIMIT
+        std::vector<u64> roots;               // vertices with G.vertices[v].mcs >= size
+        std::atomic<u64> next_root;           // the shared queue (index into roots)
+        std::atomic<bool> stopped;            // set when the enumerator is destroyed
+        u64 n_running;                        // workers still searching
+        std::deque<std::vector<u64>> found;   // cliques not yet taken by next
+        std::mutex found_lock;                // held when found or n_running change
+        std::condition_variable not_empty, not_full;
+        std::vector<std::thread> threads;
+
+        bool push(std::vector<u64>&&);
+        void run_worker();
+        bool load_vertex(Worker&, u64);
+        void search_vertex(Worker&, u64);
+
+       public:
+        // starts the search on n_threads threads (0 uses all available cores);
+        // the CALLER must not search G while the constructor runs, after that
+        // the threads only read the edges of G
+        ParallelEnumerator(graph& G, u64 size, u64 n_threads,
+                           bool use_bitmatrix = false, u64 capacity = 1024);
+        ParallelEnumerator(const ParallelEnumerator&) = delete;
+        ParallelEnumerator& operator=(const ParallelEnumerator&) = delete;
+        // stops the search, and waits for the threads to finish
+        ~ParallelEnumerator();
+        // wait for the next clique (the vertex IDs, sorted);
+        // returns false when all the cliques have been taken
+        bool next(std::vector<u64>& clique);
+    };
+
 }  // namespace detail
 }  // namespace cliquematch
 #endif /* DFS_CLIQUE_H */
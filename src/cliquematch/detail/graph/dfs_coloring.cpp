@@ -0,0 +1,261 @@
+/* dfs_coloring.cpp
+ *
+ * clique search with a coloring bound, similar to the MCS/BBMC algorithms.
+ * The search is split into subtrees by root vertex exactly as in StackDFS,
+ * but the pruning is different:
+ *
+ * 1) before searching the subtree of cur, the adjacency between cur's
+ * neighbors is stored as a bitmatrix (see adjmat.h). Each step of the search
+ * is then a word-parallel cand &= row, instead of a binary_find for every
+ * candidate. If the bitmatrix is too large, the subtree is searched by
+ * a StackDFS instead.
+ *
+ * 2) at each node of the search the candidates are greedily colored (vertices
+ * of the same color are not adjacent). A clique has at most one vertex of
+ * each color, so clique_size + number of colors is an upper bound on the
+ * clique size, which is much tighter than clique_size + candidates_left on
+ * dense graphs. The candidates are then branched on in decreasing order of
+ * color, and the search stops when the bound cannot beat the maximum.
+ *
+ * The search keeps an explicit stack of levels, so that it can be paused
+ * like StackDFS: the time limit (and G.interrupt) is checked every
+ * CHECK_INTERVAL nodes, and when the time runs out the stack is kept and
+ * process_graph returns the root vertex being searched. A level is only
+ * colored when it is first visited, so a paused level is never half-colored.
+ *
+ * The candidate sets of each level of the search are taken from the
+ * ColoringDFS object instead of the graph, because coloring needs additional
+ * scratch space and the stack has to stay valid between calls; every load
+ * must have a matching clear.
+ *
+ * Compare with RecursionDFS when changing the implementation.
+ */
+
+#include <detail/graph/dfs.h>
+#include <algorithm>
+
+namespace cliquematch
+{
+namespace detail
+{
+    u64 ColoringDFS::process_graph(graph& G)
+    {
+        if (!levels.empty() || (use_fallback && fallback.paused()))
+        {
+            // a paused search first finishes the subtree on its stack
+            if (!this->search_vertex(G)) return i;
+            if (cur == i) i++;
+        }
+        else if (i == 0)
+        {
+            // a new search first tries the vertex with the current maximum
+            // (vertex 0 is the sentinel, so a paused search never returns 0)
+            i = 1;
+            if (this->load_vertex(G, G.CUR_MAX_CLIQUE_LOCATION) &&
+                !this->search_vertex(G))
+                return i;
+        }
+
+        for (; i < G.n_vert; i++)
+        {
+            if (G.vertices[i].mcs <= G.CUR_MAX_CLIQUE_SIZE ||
+                G.CUR_MAX_CLIQUE_SIZE >= G.CLIQUE_LIMIT)
+                continue;
+            if (this->out_of_time(G)) break;
+            // if the search is paused in the subtree of i, the stack is kept
+            if (this->load_vertex(G, i) && !this->search_vertex(G)) break;
+        }
+        // If paused midway due to time limits, I want to know where we stopped
+        return i;
+    }
+
+    // load the root level of the subtree of v onto the stack
+    // return false if v cannot possibly build a clique larger than the maximum
+    bool ColoringDFS::load_vertex(graph& G, u64 v)
+    {
+        this->cur = v;
+        const u64 N = G.vertices[cur].N;
+        request_size = (N % BITS_PER_U64 != 0) + N / BITS_PER_U64;
+        const u64 max_depth = std::min(N, G.CLIQUE_LIMIT);
+        u64 j, vert;
+
+        // each level of the search needs one candidate set, with
+        // two more for coloring and two for cand, res at the root
+        // (only resized when the stack is empty, so resizing is safe)
+        memory.resize((max_depth + 4) * request_size);
+        levels.reserve(max_depth + 1);
+        mem_cur = 0;
+
+        // "memory" allocations for cand, res at root of subtree
+        res.refer_from(load_memory(request_size), N, true);
+        graphBits cand(load_memory(request_size), N, true);
+        res.set(G.vertices[cur].spos);
+        u64 clique_potential = 1;
+
+        // only search thru neighbors with greater degrees (see StackDFS)
+        for (j = 0; j < G.vertices[cur].spos; j++)
+        {
+            vert = G.edge_list[G.vertices[cur].elo + j];
+            if (G.vertices[vert].N <= G.vertices[cur].N) continue;
+            cand.set(j);
+            clique_potential++;
+        }
+        for (j = G.vertices[cur].spos + 1; j < N; j++)
+        {
+            vert = G.edge_list[G.vertices[cur].elo + j];
+            if (G.vertices[vert].N < G.vertices[cur].N) continue;
+            cand.set(j);
+            clique_potential++;
+        }
+
+        use_fallback = false;
+        if (clique_potential <= G.CUR_MAX_CLIQUE_SIZE)
+        {
+            clear_memory(2 * request_size);  // releasing memory of cand, res
+            return false;
+        }
+        if (!adj.load(G.edge_list, G.vertices, cur, cand))
+        {
+            // the bitmatrix is too large, so search without coloring
+            clear_memory(2 * request_size);
+            use_fallback = true;
+            return fallback.load_vertex(G, cur);
+        }
+
+        levels.emplace_back(cand, 1, N);
+        return true;
+    }
+
+    // color the candidates greedily, and add those that can beat the maximum
+    // to the end of order (in increasing order of color)
+    void ColoringDFS::color_candidates(graph& G, u64 cur, const graphBits& cand,
+                                       u64 clique_size)
+    {
+        const u64 N = G.vertices[cur].N;
+        // a vertex of color c can only lead to a clique of size clique_size + c
+        const u64 min_color = G.CUR_MAX_CLIQUE_SIZE >= clique_size
+                                  ? G.CUR_MAX_CLIQUE_SIZE - clique_size + 1
+                                  : 1;
+        u64 v, color = 0;
+
+        // "memory" allocations for the uncolored vertices,
+        // and the vertices that can take the current color
+        graphBits uncolored, colorable;
+        uncolored.copy_from(cand, load_memory(request_size));
+        colorable.copy_from(cand, load_memory(request_size));
+
+        while (uncolored.next(0) < N)
+        {
+            color++;
+            colorable.copy_data(uncolored);
+            for (v = colorable.next(0); v < N; v = colorable.next(v + 1))
+            {
+                // no neighbor of v can have the same color as v
+                colorable -= adj.row(v);
+                uncolored.reset(v);
+                if (color >= min_color)
+                {
+                    order.push_back(v);
+                    colors.push_back(color);
+                }
+            }
+        }
+        clear_memory(2 * request_size);  // releasing memory of uncolored, colorable
+    }
+
+    // search the subtree on the stack until it is done (return true), or until
+    // the time runs out (return false, the stack is kept for the next call)
+    bool ColoringDFS::search_vertex(graph& G)
+    {
+        if (use_fallback) return fallback.search_vertex(G);
+
+        const u64 N = G.vertices[cur].N;
+        u64 j;
+        bool branched;
+        while (!levels.empty())
+        {
+            Level& x = levels.back();
+            if (x.vert < N)
+            {
+                // all potential cliques that can contain (cur, vert) have been
+                // searched (vert has been removed from cand, so it is not
+                // considered again)
+                res.reset(x.vert);
+                x.vert = N;
+            }
+            else if (!x.colored)
+            {
+                // reached required upper bound, no need to search
+                if (G.CUR_MAX_CLIQUE_SIZE >= G.CLIQUE_LIMIT) break;
+                // out of time, the level is colored when the search continues
+                if (this->out_of_time(G)) return false;
+
+                // order and colors are shared by all levels of the search,
+                // this level uses the positions after base
+                x.base = order.size();
+                this->color_candidates(G, cur, x.cand, x.clique_size);
+                x.next = order.size();
+                // "memory" allocation for future_cand, remember to release
+                x.future_cand.copy_from(x.cand, load_memory(request_size));
+                x.colored = true;
+            }
+
+            branched = false;
+            for (; x.next > x.base; x.next--)
+            {
+                // expanding with any of the remaining vertices will not beat the
+                // maximum
+                if (x.clique_size + colors[x.next - 1] <= G.CUR_MAX_CLIQUE_SIZE) break;
+
+                // assume vert is part of the clique
+                j = order[x.next - 1];
+                res.set(j);
+                x.cand.reset(j);
+
+                // no candidates left => clique cannot grow
+                // and this clique has beaten the existing maximum
+                // (tested without building future_cand, most leaves end here)
+                if (x.cand.and_empty(adj.row(j)))
+                {
+                    if (x.clique_size + 1 > G.CUR_MAX_CLIQUE_SIZE)
+                    {
+                        G.vertices[cur].bits.copy_data(res);
+                        G.vertices[cur].mcs = x.clique_size + 1;
+                        G.CUR_MAX_CLIQUE_SIZE = x.clique_size + 1;
+                        G.CUR_MAX_CLIQUE_LOCATION = cur;
+                    }
+                    res.reset(j);
+                }
+                else
+                {
+                    x.future_cand.copy_data(x.cand);
+                    x.future_cand &= adj.row(j);
+                    x.vert = j;
+                    x.next--;
+                    branched = true;
+                    break;
+                }
+            }
+
+            if (branched)
+            {
+                // x is not valid after the push
+                levels.emplace_back(x.future_cand, x.clique_size + 1, N);
+                continue;
+            }
+
+            order.resize(x.base);
+            colors.resize(x.base);
+            clear_memory(request_size);  // releasing memory of future_cand
+            levels.pop_back();
+        }
+
+        // search complete (or terminated due to CLIQUE_LIMIT)
+        levels.clear();
+        order.clear();
+        colors.clear();
+        mem_cur = 0;  // releasing memory of all levels, and cand, res
+        return true;
+    }
+}  // namespace detail
+}  // namespace cliquematch
@@ -0,0 +1,353 @@
+/* dfs_parallel.cpp
+ *
+ * multi-threaded version of the clique search in dfs_stack.cpp. The search
+ * from each root vertex is exactly as in StackDFS; only the bookkeeping
+ * around it is different:
+ *
+ * 1) root vertices are taken from a shared queue (an atomic counter over the
+ * vertex IDs, with G.CUR_MAX_CLIQUE_LOCATION placed at the front), so the
+ * threads balance the load between themselves.
+ *
+ * 2) each thread (a ParallelDFS::Worker) has its own states/to_remove stacks
+ * and its own scratch memory, instead of using G.load_memory/G.clear_memory.
+ * The worker memory is resized only when its stack is empty, i.e. when there
+ * are no graphBits referring to it.
+ *
+ * 3) the size of the maximum clique is read from an atomic, so a larger
+ * clique found by one thread is immediately used for pruning by the others.
+ * Updates to G.CUR_MAX_CLIQUE_SIZE/LOCATION and the clique bits of a vertex
+ * happen under a lock, which is rare compared to the rest of the search.
+ *
+ * 4) once the queue is empty, a worker without work steals from the others.
+ * Root-level parallelism is not enough when a single vertex (usually the
+ * first one, G.CUR_MAX_CLIQUE_LOCATION) holds most of the search. A
+ * SearchState below the top of a stack has unexplored candidates that the
+ * owner will only get to after finishing everything above it, so the thief
+ * takes the bottom-most such SearchState: it copies the cand into its own
+ * memory, rebuilds the res from the ids of the SearchStates below it, and
+ * marks the SearchState as finished for the owner. The owner changes only the
+ * top of its stack without the lock, and takes the lock only to push/pop,
+ * so the SearchStates below the top are safe to copy while holding the lock.
+ *
+ * Compare with StackDFS when changing the implementation.
+ */
+#include <detail/graph/dfs.h>
+#include <thread>
+
+namespace cliquematch
+{
+namespace detail
+{
+    ParallelDFS::ParallelDFS(u64 n_threads)
+        : n_threads(n_threads), first_root(0), next_root(0), max_clique_size(0),
+          n_busy(0)
+    {
+    }
+
+    void ParallelDFS::Worker::reserve_memory(const u64 N)
+    {
+        // only called when the stack is empty, so resizing is safe
+        if (mem_cur + N > memory.size()) memory.resize(mem_cur + N, 0);
+    }
+
+    u64 ParallelDFS::process_graph(graph& G)
+    {
+        u64 i, n_workers = n_threads;
+        if (n_workers == 0) n_workers = std::thread::hardware_concurrency();
+        if (n_workers == 0) n_workers = 1;
+
+        first_root = G.CUR_MAX_CLIQUE_LOCATION;
+        next_root.store(0);
+        max_clique_size.store(G.CUR_MAX_CLIQUE_SIZE);
+        // every worker is busy until the queue of root vertices is empty
+        n_busy.store(n_workers);
+
+        // the upper bound on clique size is the maximum depth on the stack;
+        // reserve before starting the threads, because stacks can be stolen from
+        workers.clear();
+        for (i = 0; i < n_workers; i++)
+        {
+            workers.emplace_back(new Worker());
+            workers[i]->states.reserve(G.CLIQUE_LIMIT);
+            workers[i]->to_remove.reserve(G.CLIQUE_LIMIT);
+        }
+
+        std::vector<std::thread> threads;
+        threads.reserve(n_workers - 1);
+        for (i = 1; i < n_workers; i++)
+            threads.emplace_back(&ParallelDFS::run_worker, this, std::ref(G), i);
+        // the calling thread is also a worker
+        this->run_worker(G, 0);
+        for (auto& t : threads) t.join();
+        workers.clear();
+
+        // Dummy return. i = G.n_vert, because the search cannot be interrupted
+        return G.n_vert;
+    }
+
+    // pop the next root vertex from the shared queue: position 0 is
+    // first_root (the location of the maximum clique before the search
+    // started), and position i + 1 is vertex i
+    bool ParallelDFS::next_vertex(graph& G, u64& cur)
+    {
+        u64 pos;
+        while ((pos = next_root.fetch_add(1)) <= G.n_vert)
+        {
+            if (current_max() >= G.CLIQUE_LIMIT) return false;
+            cur = (pos == 0) ? first_root : pos - 1;
+            if (pos != 0 && cur == first_root) continue;
+            if (G.vertices[cur].mcs <= current_max()) continue;
+            return true;
+        }
+        return false;
+    }
+
+    // res (with the vertex at position j already set) is a clique of size
+    // clique_size in the neighborhood of cur; save it if it is still a maximum
+    void ParallelDFS::save_clique(graph& G, u64 cur, const graphBits& res,
+                                  u64 clique_size)
+    {
+        std::lock_guard<std::mutex> guard(found_lock);
+        if (clique_size <= G.CUR_MAX_CLIQUE_SIZE) return;
+        G.vertices[cur].bits.copy_data(res);
+        G.vertices[cur].mcs = clique_size;
+        G.CUR_MAX_CLIQUE_SIZE = clique_size;
+        G.CUR_MAX_CLIQUE_LOCATION = cur;
+        max_clique_size.store(clique_size);
+    }
+
+    void ParallelDFS::run_worker(graph& G, u64 id)
+    {
+        Worker& w = *(workers[id]);
+        u64 cur = 0, clique_size = 0;
+        while (this->next_vertex(G, cur))
+        {
+            if (this->load_vertex(G, w, cur)) this->process_stack(G, w, 1);
+        }
+        n_busy.fetch_sub(1);
+
+        // no more root vertices, so help the workers that are still busy.
+        // a successful steal marks this worker as busy before the victim's
+        // lock is released, so n_busy == 0 only when there is nothing left
+        while (current_max() < G.CLIQUE_LIMIT)
+        {
+            if (this->steal_state(G, id, clique_size))
+            {
+                this->process_stack(G, w, clique_size);
+                n_busy.fetch_sub(1);
+            }
+            else if (n_busy.load() == 0)
+                break;
+            else
+                std::this_thread::yield();
+        }
+    }
+
+    // load the SearchState at the root of the subtree of cur onto the stack
+    // return false if the subtree cannot beat the maximum
+    bool ParallelDFS::load_vertex(graph& G, Worker& w, u64 cur)
+    {
+        const u64 request_size =
+            (G.vertices[cur].N % BITS_PER_U64 != 0) + G.vertices[cur].N / BITS_PER_U64;
+        u64 j, vert, clique_potential = 1;
+
+        // count the candidates first, to know how much memory the worker needs:
+        // only search thru neighbors with greater degrees (see StackDFS)
+        for (j = 0; j < G.vertices[cur].spos; j++)
+        {
+            vert = G.edge_list[G.vertices[cur].elo + j];
+            clique_potential += (G.vertices[vert].N > G.vertices[cur].N);
+        }
+        for (j = G.vertices[cur].spos + 1; j < G.vertices[cur].N; j++)
+        {
+            vert = G.edge_list[G.vertices[cur].elo + j];
+            clique_potential += (G.vertices[vert].N >= G.vertices[cur].N);
+        }
+        if (clique_potential <= current_max()) return false;
+
+        // the stack can hold at most clique_potential states, and each state
+        // needs memory for one cand; the base also needs memory for res
+        w.reserve_memory((clique_potential + 1) * request_size);
+
+        // "memory" allocations for cand, res at root of subtree
+        SearchState x(G.vertices[cur], w.load_memory(request_size),
+                      w.load_memory(request_size));
+        for (j = 0; j < G.vertices[cur].spos; j++)
+        {
+            vert = G.edge_list[G.vertices[cur].elo + j];
+            if (G.vertices[vert].N > G.vertices[cur].N) x.cand.set(j);
+        }
+        for (j = G.vertices[cur].spos + 1; j < G.vertices[cur].N; j++)
+        {
+            vert = G.edge_list[G.vertices[cur].elo + j];
+            if (G.vertices[vert].N >= G.vertices[cur].N) x.cand.set(j);
+        }
+
+        // always use std::move when pushing on to stack
+        std::lock_guard<std::mutex> guard(w.stack_lock);
+        w.root = cur;
+        w.states.push_back(std::move(x));
+        return true;
+    }
+
+    // take the bottom-most unfinished SearchState (other than the top) from
+    // another worker's stack, and make it the base of this worker's stack.
+    // clique_size is set to the size of the clique at the stolen SearchState
+    bool ParallelDFS::steal_state(graph& G, u64 id, u64& clique_size)
+    {
+        Worker& w = *(workers[id]);
+        u64 i, d, cur, remaining, request_size;
+
+        for (i = 1; i < workers.size(); i++)
+        {
+            Worker& v = *(workers[(id + i) % workers.size()]);
+            std::unique_lock<std::mutex> guard(v.stack_lock);
+            cur = v.root;
+
+            for (d = 0; d + 1 < v.states.size(); d++)
+            {
+                // the SearchState at depth d has a clique of size d + 1,
+                // and is worth stealing only if it can still beat the maximum
+                remaining = v.states[d].cand.count();
+                if (remaining >= 2 && d + 1 + remaining > current_max()) break;
+            }
+            if (d + 1 >= v.states.size()) continue;
+
+            SearchState& victim = v.states[d];
+            request_size = (G.vertices[cur].N % BITS_PER_U64 != 0) +
+                           G.vertices[cur].N / BITS_PER_U64;
+            // the stolen SearchState is the base of this worker's stack
+            w.reserve_memory((remaining + 2) * request_size);
+
+            SearchState x(victim.id);
+            x.start_at = victim.start_at;
+            // "memory" allocations for res, cand at the base of the stack
+            x.res.refer_from(w.load_memory(request_size), G.vertices[cur].N);
+            x.cand.copy_from(victim.cand, w.load_memory(request_size));
+            for (u64 k = 0; k <= d; k++) x.res.set(v.states[k].id);
+
+            // the victim will pop this SearchState when it returns to it,
+            // and it cannot be stolen again
+            victim.cand.clear();
+            victim.start_at = G.vertices[cur].N;
+
+            // this worker is busy before the victim can become idle
+            n_busy.fetch_add(1);
+            guard.unlock();
+
+            std::lock_guard<std::mutex> own_guard(w.stack_lock);
+            w.root = cur;
+            w.states.push_back(std::move(x));
+            clique_size = d + 1;
+            return true;
+        }
+        return false;
+    }
+
+    // run the StackDFS search on the worker's stack until it is empty,
+    // clique_size is the size of the clique at the base of the stack
+    void ParallelDFS::process_stack(graph& G, Worker& w, u64 clique_size)
+    {
+        const u64 cur = w.root;
+        const u64 request_size =
+            (G.vertices[cur].N % BITS_PER_U64 != 0) + G.vertices[cur].N / BITS_PER_U64;
+        u64 candidates_left, clique_potential;
+        u64 j, k, vert, start, ans;
+
+        while (!w.states.empty())
+        {
+            if (current_max() >= G.CLIQUE_LIMIT) break;
+            // strong assumption (weakened by other threads changing the maximum):
+            // the top of the stack leads to a clique larger than the current max
+            SearchState& cur_state = w.states.back();
+            candidates_left = cur_state.cand.count();
+            cur_state.start_at = cur_state.cand.next(cur_state.start_at);
+
+            for (j = cur_state.start_at; j < G.vertices[cur].N; j = cur_state.start_at)
+            {
+                cur_state.cand.reset(j);
+                cur_state.start_at = cur_state.cand.next(j + 1);
+                candidates_left--;
+                clique_potential = candidates_left + 1 + clique_size;
+
+                // ensure only the vertices found in the below loop are removed later
+                w.to_remove.clear();
+
+                vert = G.edge_list[G.vertices[cur].elo + j];
+                start = G.vertices[vert].spos;
+
+                for (k = cur_state.start_at;
+                     k < G.vertices[cur].N && clique_potential > current_max();
+                     k = cur_state.cand.next(k + 1))
+                {
+                    if (G.edge_list.find(G.vertices[vert].elo + start,
+                                         G.vertices[vert].N - start,
+                                         G.edge_list[G.vertices[cur].elo + k],
+                                         ans) != FOUND)
+                        w.to_remove.push_back(k);
+
+                    start += ans;
+                    clique_potential =
+                        (candidates_left - w.to_remove.size()) + clique_size + 1;
+                }
+
+                // is the current maximum beatable?
+                if (clique_potential > current_max())
+                {
+                    if (candidates_left == 0)
+                    {
+                        // include vert as part of the clique and copy
+                        cur_state.res.set(j);
+                        this->save_clique(G, cur, cur_state.res, clique_potential);
+                        // search can now continue without vert
+                        cur_state.res.reset(j);
+                    }
+
+                    else  // clique may still grow to beat the maximum
+                    {
+                        SearchState future_state(j);
+                        future_state.refer_from(w.load_memory(request_size),
+                                                cur_state.cand, cur_state.res);
+
+                        // remove invalid members from the candidate set
+                        for (auto k : w.to_remove) future_state.cand.reset(k);
+
+                        // cur_state is no longer the top of the stack after this,
+                        // so it can be stolen
+                        std::lock_guard<std::mutex> guard(w.stack_lock);
+                        w.states.push_back(std::move(future_state));
+                        clique_size++;
+                        // the top of the stack has changed,
+                        // prevent any further operations on cur_state
+                        break;
+                    }
+                }
+            }
+
+            // all verts with id > cur_state.id have been checked
+            if (j == G.vertices[cur].N)
+            {
+                const u64 id = cur_state.id;
+                std::lock_guard<std::mutex> guard(w.stack_lock);
+                w.states.pop_back();
+                w.clear_memory(request_size);
+                // res is shared by the whole stack, the base of which is not popped
+                if (!w.states.empty()) w.states.back().res.reset(id);
+                clique_size--;
+            }
+        }
+
+        std::lock_guard<std::mutex> guard(w.stack_lock);
+        if (!w.states.empty())  // the search was terminated due to CLIQUE_LIMIT
+        {
+            // release memory of all candidates on the stack
+            w.clear_memory(request_size * w.states.size());
+            w.states.clear();
+        }
+
+        w.clear_memory(request_size);
+        // release memory of x.res i.e. the space for
+        // the clique allocated at the base of the stack
+    }
+}  // namespace detail
+}  // namespace cliquematch
@@ -130,9 +130,10 @@ namespace detail
             for (k = j + 1; k < G.vertices[cur].N; k++)
             {
                 if (!future_cand[k]) continue;
-                if (binary_find(&(G.edge_list[G.vertices[vert].elo + start]),
-                                G.vertices[vert].N - start,
-                                G.edge_list[G.vertices[cur].elo + k], ans) != FOUND)
+                if (G.edge_list.find(G.vertices[vert].elo + start,
+                                     G.vertices[vert].N - start,
+                                     G.edge_list[G.vertices[cur].elo + k],
+                                     ans) != FOUND)
                 {
                     future_cand.reset(k);
                 }
@@ -4,15 +4,24 @@
  * implements the SAME algorithm, but with recursion.  The difference is that
  * StackDFS uses data members to avoid some computations (it computes them
  * incrementally) and StackDFS checks the clique potential before making the
- * recursive call (i.e. pushing on to the stack). StackDFS does not have a time
- * limit.
+ * recursive call (i.e. pushing on to the stack).
  *
- * Two heap allocations are made: when process_graph is called,
+ * The time limit (and G.interrupt) is checked every CHECK_INTERVAL nodes,
+ * instead of at every node as in RecursionDFS. When the time runs out, the
+ * search stops without clearing the stack, and process_graph returns the root
+ * vertex being searched; calling process_graph again continues from the top
+ * of the stack (see graph::find_max_cliques).
+ *
+ * Three heap allocations are made: when the first root vertex is loaded,
  * StackDFS::to_remove and StackDFS::states reserve space equal to the upper
- * bound on the clique size. All other variables are on the stack. Heap memory
- * from the graph object is re-used in the load_memory/clear_memory calls,
- * which are explicitly pointed out; every load must have a matching clear or
- * there will be memory corruption.
+ * bound on the clique size, and StackDFS::memory grows to the largest amount
+ * needed by a root vertex. The stack has to stay valid between calls, so the
+ * memory is not taken from the graph; every load_memory must still have a
+ * matching clear_memory or there will be memory corruption.
+ *
+ * If use_bitmatrix is set, the adjacency between the neighbors of each root
+ * vertex is stored in an adjMatrix before searching its subtree, and the
+ * binary_find loop is replaced by a word-parallel AND with a row.
  *
  * Compare with RecursionDFS when changing the implementation.
  */
@@ -24,30 +33,50 @@ namespace detail
 {
     u64 StackDFS::process_graph(graph& G)
     {
-        // the upper bound on clique size is the maximum depth on the stack
-        this->states.reserve(G.CLIQUE_LIMIT);
-        this->to_remove.reserve(G.CLIQUE_LIMIT);
-        this->process_vertex(G, G.CUR_MAX_CLIQUE_LOCATION);
-        for (i = 0; i < G.n_vert; i++)
+        if (!states.empty())
+        {
+            // a paused search first finishes the subtree on its stack
+            if (!this->search_vertex(G)) return i;
+            if (cur == i) i++;
+        }
+        else if (i == 0)
+        {
+            // a new search first tries the vertex with the current maximum
+            // (vertex 0 is the sentinel, so a paused search never returns 0)
+            i = 1;
+            if (this->load_vertex(G, G.CUR_MAX_CLIQUE_LOCATION) &&
+                !this->search_vertex(G))
+                return i;
+        }
+
+        for (; i < G.n_vert; i++)
         {
             if (G.vertices[i].mcs <= G.CUR_MAX_CLIQUE_SIZE ||
                 G.CUR_MAX_CLIQUE_SIZE >= G.CLIQUE_LIMIT)
                 continue;
-            process_vertex(G, i);
+            if (this->out_of_time(G)) break;
+            // if the search is paused in the subtree of i, the stack is kept
+            if (this->load_vertex(G, i) && !this->search_vertex(G)) break;
         }
-        // Dummy return. i = G.n_vert, because the search cannot be interrupted
+        // If paused midway due to time limits, I want to know where we stopped
         return i;
     }
 
-    void StackDFS::process_vertex(graph& G, u64 cur)
+    // load the SearchState at the root of the subtree of v onto the stack
+    // return false if v cannot possibly build a clique larger than the maximum
+    bool StackDFS::load_vertex(graph& G, u64 v)
     {
+        // the upper bound on clique size is the maximum depth on the stack
+        // (only the first call allocates)
+        this->states.reserve(G.CLIQUE_LIMIT);
+        this->to_remove.reserve(G.CLIQUE_LIMIT);
+
+        this->cur = v;
         request_size =
             (G.vertices[cur].N % BITS_PER_U64 != 0) + G.vertices[cur].N / BITS_PER_U64;
-        // "memory" allocations for cand, res at root of subtree
-        SearchState x(G.vertices[cur], G.load_memory(request_size),
-                      G.load_memory(request_size));
         this->clique_potential = 1;
 
+        // count the candidates first, to know how much memory is needed:
         // only search thru neighbors with greater degrees
         // (this amortizes the search cost because
         // vertices with really low degree have fewer neighbors
@@ -56,9 +85,7 @@ namespace detail
         for (j = 0; j < G.vertices[cur].spos; j++)
         {
             vert = G.edge_list[G.vertices[cur].elo + j];
-            if (G.vertices[vert].N <= G.vertices[cur].N) continue;
-            x.cand.set(j);
-            this->clique_potential++;
+            this->clique_potential += (G.vertices[vert].N > G.vertices[cur].N);
         }
 
         // vertices with a greater label haven't been the root of a search tree
@@ -67,25 +94,49 @@ namespace detail
         for (j = G.vertices[cur].spos + 1; j < G.vertices[cur].N; j++)
         {
             vert = G.edge_list[G.vertices[cur].elo + j];
-            if (G.vertices[vert].N < G.vertices[cur].N) continue;
-            x.cand.set(j);
-            this->clique_potential++;
+            this->clique_potential += (G.vertices[vert].N >= G.vertices[cur].N);
         }
 
-        if (this->clique_potential <= G.CUR_MAX_CLIQUE_SIZE)
+        if (this->clique_potential <= G.CUR_MAX_CLIQUE_SIZE) return false;
+
+        // the stack can hold at most clique_potential states, and each state
+        // needs memory for one cand; the base also needs memory for res
+        // (only resized when the stack is empty, so resizing is safe)
+        if (memory.size() < (clique_potential + 1) * request_size)
+            memory.resize((clique_potential + 1) * request_size, 0);
+
+        // "memory" allocations for cand, res at root of subtree
+        SearchState x(G.vertices[cur], load_memory(request_size),
+                      load_memory(request_size));
+        for (j = 0; j < G.vertices[cur].spos; j++)
+        {
+            vert = G.edge_list[G.vertices[cur].elo + j];
+            if (G.vertices[vert].N > G.vertices[cur].N) x.cand.set(j);
+        }
+        for (j = G.vertices[cur].spos + 1; j < G.vertices[cur].N; j++)
         {
-            G.clear_memory(2 * request_size);  // clear x.cand, x.res
-            return;
+            vert = G.edge_list[G.vertices[cur].elo + j];
+            if (G.vertices[vert].N >= G.vertices[cur].N) x.cand.set(j);
         }
 
+        // rows are needed only for the candidates at the root of the subtree
+        with_adj =
+            this->use_bitmatrix && adj.load(G.edge_list, G.vertices, cur, x.cand);
+
         // always use std::move when pushing on to stack
         states.push_back(std::move(x));
         clique_size = 1;
+        return true;
+    }
 
-        u64 start = 0;
+    // search the subtree on the stack until it is done (return true), or until
+    // the time runs out (return false, the stack is kept for the next call)
+    bool StackDFS::search_vertex(graph& G)
+    {
         while (!states.empty())
         {
             if (G.CUR_MAX_CLIQUE_SIZE >= G.CLIQUE_LIMIT) break;
+            if (this->out_of_time(G)) return false;
             // strong assumption:
             // the top of the stack always leads to a clique larger than the current max
             // (checking is done before pushing on to the stack)
@@ -115,18 +166,29 @@ namespace detail
                 vert = G.edge_list[G.vertices[cur].elo + j];
                 start = G.vertices[vert].spos;
 
-                for (k = cur_state.start_at;
-                     k < G.vertices[cur].N && clique_potential > G.CUR_MAX_CLIQUE_SIZE;
-                     k = cur_state.cand.next(k + 1))
+                if (with_adj)
                 {
-                    if (binary_find(&(G.edge_list[G.vertices[vert].elo + start]),
-                                    G.vertices[vert].N - start,
-                                    G.edge_list[G.vertices[cur].elo + k], ans) != FOUND)
-                        to_remove.push_back(k);
-
-                    start += ans;
+                    // the remaining candidates adjacent to vert are in row j
                     clique_potential =
-                        (candidates_left - to_remove.size()) + clique_size + 1;
+                        cur_state.cand.and_count(adj.row(j)) + clique_size + 1;
+                }
+                else
+                {
+                    for (k = cur_state.start_at;
+                         k < G.vertices[cur].N &&
+                         clique_potential > G.CUR_MAX_CLIQUE_SIZE;
+                         k = cur_state.cand.next(k + 1))
+                    {
+                        if (G.edge_list.find(G.vertices[vert].elo + start,
+                                             G.vertices[vert].N - start,
+                                             G.edge_list[G.vertices[cur].elo + k],
+                                             ans) != FOUND)
+                            to_remove.push_back(k);
+
+                        start += ans;
+                        clique_potential =
+                            (candidates_left - to_remove.size()) + clique_size + 1;
+                    }
                 }
 
                 // is the current maximum beatable?
@@ -156,11 +218,14 @@ namespace detail
                         // no need to allocate memory for res, refer_from passes the
                         // reference of the cur_state.res much like res is passed in
                         // RecursionDFS
-                        future_state.refer_from(G.load_memory(request_size),
+                        future_state.refer_from(load_memory(request_size),
                                                 cur_state.cand, cur_state.res);
 
                         // remove invalid members from the candidate set
-                        for (auto k : to_remove) future_state.cand.reset(k);
+                        if (with_adj)
+                            future_state.cand &= adj.row(j);
+                        else
+                            for (auto k : to_remove) future_state.cand.reset(k);
 
                         // clique_potential check has happened before pushing on to the
                         // stack; strong assumption is therefore valid
@@ -183,12 +248,14 @@ namespace detail
             {
                 // all potential cliques that can contain (cur, v) have been searched
                 // where v is at position cur_state.id in list of cur's neighbors
+                const u64 id = cur_state.id;
                 states.pop_back();
-                G.clear_memory(request_size);
+                clear_memory(request_size);
 
                 // remove v from clique consideration because the future
                 // candidates will not have it as part of the clique
-                cur_state.res.reset(cur_state.id);
+                // (res is shared by the whole stack)
+                if (!states.empty()) states.back().res.reset(id);
                 clique_size--;
             }
         }
@@ -196,13 +263,14 @@ namespace detail
         if (!states.empty())  // the search was terminated due to CLIQUE_LIMIT
         {
             // release memory of all candidates on the stack
-            G.clear_memory(request_size * states.size());
+            clear_memory(request_size * states.size());
             states.clear();
         }
 
-        G.clear_memory(request_size);
+        clear_memory(request_size);
         // release memory of x.res i.e. the space for
         // the clique allocated at the base of the stack
+        return true;
     }
 }  // namespace detail
 }  // namespace cliquematch
@@ -17,6 +17,10 @@
  * returned may or may not be maximal: if a graph G has a maximum clique S of
  * size 25, then CliqueEnumerator will enumerate at least 25 cliques of size 24
  * (the sub-cliques of S).
+ *
+ * If use_bitmatrix is set, the candidates are updated with a row of an
+ * adjMatrix instead of binary_find (see dfs_stack.cpp). The adjMatrix is
+ * loaded with the root vertex, so it is also saved when the function returns.
  */
 #include <detail/graph/dfs.h>
 
@@ -27,6 +31,7 @@ namespace detail
     void CliqueEnumerator::process_vertex(graph& G)
     {
         // continue until vertex this->cur can possibly build a clique of REQUIRED_SIZE
+        // (cur starts at the sentinel vertex 0, so vertex 1 is also a root)
         for (cur++; cur < G.vertices.size(); cur++)
         {
             if (G.vertices[cur].mcs < this->REQUIRED_SIZE) continue;
@@ -76,6 +81,10 @@ namespace detail
             return false;
         }
 
+        // rows are needed only for the candidates at the root of the subtree
+        with_adj =
+            this->use_bitmatrix && adj.load(G.edge_list, G.vertices, cur, x.cand);
+
         // always use std::move when pushing on to stack
         states.push_back(std::move(x));
         clique_size = 1;
@@ -94,6 +103,7 @@ namespace detail
         }
         else if (this->REQUIRED_SIZE == 1 && cur < G.n_vert)
         {  // every vertex is a clique of size 1, dummy case
+            if (cur == 0) cur++;  // (0 is the sentinel vertex)
             G.vertices[cur].bits.clear();
             G.vertices[cur].bits.set(G.vertices[cur].spos);
             return cur++;
@@ -143,19 +153,29 @@ namespace detail
                 vert = G.edge_list[G.vertices[cur].elo + j];
                 start = G.vertices[vert].spos + 1;
 
-                for (k = j + 1;
-                     k < G.vertices[cur].N && clique_potential >= this->REQUIRED_SIZE;
-                     k++)
+                if (with_adj)
                 {
-                    if (!cur_state.cand[k]) continue;
-                    if (binary_find(&(G.edge_list[G.vertices[vert].elo + start]),
-                                    G.vertices[vert].N - start,
-                                    G.edge_list[G.vertices[cur].elo + k], ans) != FOUND)
-                        to_remove.push_back(k);
-
+                    // the remaining candidates adjacent to vert are in row j
                     clique_potential =
-                        (candidates_left - to_remove.size()) + clique_size + 1;
-                    start += ans;
+                        cur_state.cand.and_count(adj.row(j)) + clique_size + 1;
+                }
+                else
+                {
+                    for (k = j + 1; k < G.vertices[cur].N &&
+                                    clique_potential >= this->REQUIRED_SIZE;
+                         k++)
+                    {
+                        if (!cur_state.cand[k]) continue;
+                        if (G.edge_list.find(G.vertices[vert].elo + start,
+                                             G.vertices[vert].N - start,
+                                             G.edge_list[G.vertices[cur].elo + k],
+                                             ans) != FOUND)
+                            to_remove.push_back(k);
+
+                        clique_potential =
+                            (candidates_left - to_remove.size()) + clique_size + 1;
+                        start += ans;
+                    }
                 }
 
                 // is it possible to produce a clique of REQUIRED_SIZE?
@@ -189,7 +209,10 @@ namespace detail
                                                 cur_state.cand, cur_state.res);
 
                         // remove invalid members from the candidate set
-                        for (auto k : to_remove) future_state.cand.reset(k);
+                        if (with_adj)
+                            future_state.cand &= adj.row(j);
+                        else
+                            for (auto k : to_remove) future_state.cand.reset(k);
 
                         // clique_potential has been checked before pushing on to the
                         // stack; strong assumption is therefore valid
@@ -0,0 +1,268 @@
+/* enumerate_maximal.cpp
+ *
+ * stack-based implementation of the Bron-Kerbosch algorithm with pivoting,
+ * which returns every time a maximal clique of at least MIN_SIZE is found.
+ * Like CliqueEnumerator, it returns the vertex that was the root of the
+ * subtree that found the clique, the CALLER can call G.get_max_clique to get
+ * the clique, and the search is complete if the returned vertex has an ID >
+ * the number of vertices in the provided graph.
+ *
+ * The roots are ordered as in CliqueEnumerator (by degree, then by ID). The
+ * search at a root vertex only considers its neighbors: the ones after it in
+ * the order are the candidates (P), and the ones before it are excluded (X),
+ * because the cliques containing them have already been found. Each state on
+ * the stack then branches on the candidates that are not neighbors of a pivot
+ * vertex (Tomita et al. 2006), chosen from P and X to have the most neighbors
+ * in P. A clique is maximal when both P and X are empty.
+ *
+ * Choosing the pivot needs the adjacency of every vertex in P and X, so the
+ * rows of an adjMatrix are always loaded for the root vertex. If the root has
+ * too many neighbors for an adjMatrix, the rows are found with binary_find
+ * when needed, and the first candidate is used as the pivot.
+ *
+ * The stack needs three bitsets for each state (cand, excl, todo), which are
+ * more than the graph can provide via load_memory, so the memory is owned by
+ * the enumerator, as in ColoringDFS.
+ */
+#include <detail/graph/dfs.h>
+
+namespace cliquematch
+{
+namespace detail
+{
+    void MaximalEnumerator::process_vertex(graph& G)
+    {
+        // continue until vertex this->cur can possibly build a maximal clique
+        // (cur starts at the sentinel vertex 0, so vertex 1 is also a root)
+        for (cur++; cur < G.vertices.size(); cur++)
+        {
+            if (load_vertex(G)) break;
+        }
+    }
+
+    // return true if the vertex this->cur can possibly build a maximal clique
+    // of MIN_SIZE; if cur is a maximal clique by itself, the stack is empty
+    bool MaximalEnumerator::load_vertex(graph& G)
+    {
+        const vertex& root = G.vertices[cur];
+        request_size = (root.N % BITS_PER_U64 != 0) + root.N / BITS_PER_U64;
+        u64 vert, n_cand = 0, n_excl = 0;
+
+        // only search thru neighbors with greater degrees (or equal degrees
+        // and greater labels), as in CliqueEnumerator
+        auto is_later = [&G, &root](u64 v, u64 pos)
+        {
+            return G.vertices[v].N > root.N ||
+                   (G.vertices[v].N == root.N && pos > root.spos);
+        };
+        for (j = 0; j < root.N; j++)
+        {
+            if (j == root.spos) continue;
+            vert = G.edge_list[root.elo + j];
+            if (is_later(vert, j))
+                n_cand++;
+            else
+                n_excl++;
+        }
+
+        if (n_cand + 1 < this->MIN_SIZE) return false;
+        if (n_cand == 0)
+        {
+            // a single vertex is maximal only if it has no neighbors
+            if (n_excl != 0) return false;
+            G.vertices[cur].bits.clear();
+            G.vertices[cur].bits.set(root.spos);
+            return true;
+        }
+
+        // the stack can hold at most n_cand + 1 states, the base also needs
+        // memory for res, and there is one scratch row for neighbors()
+        // (only resized when the stack is empty, so resizing is safe)
+        if (memory.size() < (3 * (n_cand + 1) + 2) * request_size)
+            memory.resize((3 * (n_cand + 1) + 2) * request_size);
+        mem_cur = 0;
+        nbrs.refer_from(load_memory(request_size), root.N, true);
+
+        PivotState x(root.spos);
+        x.res.refer_from(load_memory(request_size), root.N, true);
+        x.cand.refer_from(load_memory(request_size), root.N, true);
+        x.excl.refer_from(load_memory(request_size), root.N, true);
+        x.todo.refer_from(load_memory(request_size), root.N, true);
+        x.res.set(root.spos);
+        for (j = 0; j < root.N; j++)
+        {
+            if (j == root.spos) continue;
+            vert = G.edge_list[root.elo + j];
+            if (is_later(vert, j))
+                x.cand.set(j);
+            else
+                x.excl.set(j);
+        }
+
+        // rows are needed for every vertex in P and X
+        x.todo |= x.cand;
+        x.todo |= x.excl;
+        with_adj = adj.load(G.edge_list, G.vertices, cur, x.todo);
+
+        choose_pivot(G, x);
+        // always use std::move when pushing on to stack
+        states.push_back(std::move(x));
+        clique_size = 1;
+        return true;
+    }
+
+    // neighbors of the vertex at position k among cand and excl of the state
+    // (the row also contains k itself)
+    graphBits MaximalEnumerator::neighbors(graph& G, u64 k, graphBits& cand,
+                                           graphBits& excl)
+    {
+        if (with_adj) return adj.row(k);
+
+        const vertex& root = G.vertices[cur];
+        const u64 vert = G.edge_list[root.elo + k];
+        u64 i, ans;
+        nbrs.clear();
+        for (i = cand.next(0); i < root.N; i = cand.next(i + 1))
+            if (G.edge_list.find(G.vertices[vert].elo, G.vertices[vert].N,
+                                 G.edge_list[root.elo + i], ans) == FOUND)
+                nbrs.set(i);
+        for (i = excl.next(0); i < root.N; i = excl.next(i + 1))
+            if (G.edge_list.find(G.vertices[vert].elo, G.vertices[vert].N,
+                                 G.edge_list[root.elo + i], ans) == FOUND)
+                nbrs.set(i);
+        nbrs.set(k);
+
+        graphBits row;
+        row.refer_from(nbrs);
+        return row;
+    }
+
+    // fill x.todo with the candidates that are not neighbors of the pivot
+    void MaximalEnumerator::choose_pivot(graph& G, PivotState& x)
+    {
+        const u64 N = G.vertices[cur].N;
+        u64 k, score, pivot = x.cand.next(0), best = 0;
+
+        if (with_adj)
+        {
+            // the pivot has the most neighbors in cand, so todo is smallest
+            for (k = x.cand.next(0); k < N; k = x.cand.next(k + 1))
+            {
+                score = x.cand.and_count(adj.row(k)) - 1;  // (k is in its own row)
+                if (score > best)
+                {
+                    best = score;
+                    pivot = k;
+                }
+            }
+            for (k = x.excl.next(0); k < N; k = x.excl.next(k + 1))
+            {
+                score = x.cand.and_count(adj.row(k));
+                if (score > best)
+                {
+                    best = score;
+                    pivot = k;
+                }
+            }
+        }
+
+        graphBits row = neighbors(G, pivot, x.cand, x.excl);
+        x.todo.copy_data(x.cand);
+        x.todo -= row;
+        // a candidate pivot is not its own neighbor, so it has to be searched
+        if (x.cand[pivot]) x.todo.set(pivot);
+        x.start_at = 0;
+    }
+
+    // return id of the vertex where a maximal clique of MIN_SIZE was found
+    // CALLER checks if returned value > G.n_vert => search is complete
+    u64 MaximalEnumerator::process_graph(graph& G)
+    {
+        u64 p_count;
+        while (cur < G.n_vert)  // go through all vertices of the graph
+        {
+            if (states.empty())
+            {
+                this->process_vertex(G);
+                // the stack is empty if cur has no neighbors (or there are no
+                // more vertices left)
+                if (states.empty() && cur < G.n_vert) return cur;
+                continue;  // check if cur < G.n_vert
+            }
+
+            PivotState& cur_state = states.back();
+            const u64 N = G.vertices[cur].N;
+
+            for (j = cur_state.todo.next(cur_state.start_at); j < N;
+                 j = cur_state.todo.next(j + 1))
+            {
+                cur_state.start_at = j + 1;
+                cur_state.cand.reset(j);
+                graphBits row = neighbors(G, j, cur_state.cand, cur_state.excl);
+                p_count = cur_state.cand.and_count(row);
+
+                if (p_count == 0)
+                {
+                    // the clique with vert cannot grow, it is maximal if it
+                    // cannot grow with the excluded vertices either
+                    bool maximal = cur_state.excl.and_empty(row);
+                    cur_state.excl.set(j);
+                    if (maximal && clique_size + 1 >= this->MIN_SIZE)
+                    {
+                        cur_state.res.set(j);
+                        G.vertices[cur].bits.copy_data(cur_state.res);
+                        // search can now continue without vert
+                        cur_state.res.reset(j);
+
+                        // now the caller can call G.get_max_clique(cur)
+                        return cur;
+                    }
+                }
+                else if (clique_size + 1 + p_count < this->MIN_SIZE)
+                {
+                    // every maximal clique with vert is too small
+                    cur_state.excl.set(j);
+                }
+                else
+                {
+                    PivotState future_state(j);
+                    future_state.res.refer_from(cur_state.res);
+                    future_state.res.set(j);
+                    future_state.cand.copy_from(cur_state.cand,
+                                                load_memory(request_size));
+                    future_state.cand &= row;
+                    future_state.excl.copy_from(cur_state.excl,
+                                                load_memory(request_size));
+                    future_state.excl &= row;
+                    future_state.todo.refer_from(load_memory(request_size), N);
+                    // (row is not used after this, so the scratch can be reused)
+                    choose_pivot(G, future_state);
+
+                    // the cliques with vert are searched in future_state
+                    cur_state.excl.set(j);
+                    states.push_back(std::move(future_state));
+                    clique_size++;
+                    // the top of the stack has changed,
+                    // prevent any further operations on cur_state
+                    break;
+                }
+            }
+
+            // all verts in cur_state.todo have been checked
+            if (j >= N)
+            {
+                const u64 id = cur_state.id;
+                states.pop_back();
+                if (states.empty()) continue;  // root is done, memory is reset
+                clear_memory(3 * request_size);
+                states.back().res.reset(id);
+                clique_size--;
+            }
+        }
+
+        // now cur = G.n_vert, there are no more cliques to be found
+        return cur;
+    }
+
+}  // namespace detail
+}  // namespace cliquematch
@@ -0,0 +1,285 @@
+/* enumerate_parallel.cpp
+ *
+ * multi-threaded version of the enumeration in enumerate.cpp. The search
+ * from each root vertex is exactly as in CliqueEnumerator, but it runs to the
+ * end of the subtree instead of returning at every clique:
+ *
+ * 1) root vertices are taken from a shared queue (an atomic counter over the
+ * roots, as in ParallelDFS), and each thread has its own stack, scratch
+ * memory and adjMatrix. The roots are filtered by G.vertices[v].mcs in the
+ * constructor, and G.CLIQUE_LIMIT is copied there as well: a search on G
+ * updates both, so the threads do not read them.
+ *
+ * 2) every clique of REQUIRED_SIZE is copied out of the thread's stack as a
+ * list of vertex IDs, and put in a bounded queue (found). A thread waits
+ * while the queue is full, so the memory used does not depend on the number
+ * of cliques, and the threads do not run far ahead of the CALLER.
+ *
+ * 3) next() takes the cliques from the queue in the order they were found,
+ * which is not the order of CliqueEnumerator, and returns false once the
+ * queue is empty and every thread has finished. The destructor stops the
+ * threads, so the CALLER can stop iterating at any time.
+ *
+ * Compare with CliqueEnumerator when changing the implementation.
+ */
+#include <detail/graph/dfs.h>
+
+namespace cliquematch
+{
+namespace detail
+{
+    void ParallelEnumerator::Worker::reserve_memory(const u64 N)
+    {
+        // only called when the stack is empty, so resizing is safe
+        if (mem_cur + N > memory.size()) memory.resize(mem_cur + N, 0);
+    }
+
+    ParallelEnumerator::ParallelEnumerator(graph& G, u64 size, u64 n_threads,
+                                           bool use_bitmatrix, u64 capacity)
+        : G(G), REQUIRED_SIZE(size), use_bitmatrix(use_bitmatrix),
+          capacity(capacity == 0 ? 1 : capacity), clique_limit(G.CLIQUE_LIMIT),
+          next_root(0), stopped(false), n_running(0)
+    {
+        // 0 cliques of size 0, dummy case
+        if (REQUIRED_SIZE == 0) return;
+        for (u64 v = 1; v < G.n_vert; v++)
+        {
+            // every vertex is a clique of size 1, dummy case
+            if (REQUIRED_SIZE == 1 || G.vertices[v].mcs >= REQUIRED_SIZE)
+                roots.push_back(v);
+        }
+        if (n_threads == 0) n_threads = std::thread::hardware_concurrency();
+        if (n_threads == 0) n_threads = 1;
+
+        n_running = n_threads;
+        threads.reserve(n_threads);
+        for (u64 i = 0; i < n_threads; i++)
+            threads.emplace_back(&ParallelEnumerator::run_worker, this);
+    }
+
+    ParallelEnumerator::~ParallelEnumerator()
+    {
+        {
+            std::lock_guard<std::mutex> guard(found_lock);
+            stopped.store(true);
+        }
+        not_full.notify_all();
+        for (auto& t : threads) t.join();
+    }
+
+    bool ParallelEnumerator::next(std::vector<u64>& clique)
+    {
+        std::unique_lock<std::mutex> guard(found_lock);
+        not_empty.wait(guard, [this]() { return !found.empty() || n_running == 0; });
+        if (found.empty()) return false;
+        clique = std::move(found.front());
+        found.pop_front();
+        not_full.notify_one();
+        return true;
+    }
+
+    // wait for space in the queue; return false if the search was stopped
+    bool ParallelEnumerator::push(std::vector<u64>&& clique)
+    {
+        std::unique_lock<std::mutex> guard(found_lock);
+        not_full.wait(guard,
+                      [this]() { return stopped.load() || found.size() < capacity; });
+        if (stopped.load()) return false;
+        found.push_back(std::move(clique));
+        not_empty.notify_one();
+        return true;
+    }
+
+    void ParallelEnumerator::run_worker()
+    {
+        Worker w;
+        // the upper bound on clique size is the maximum depth on the stack
+        w.states.reserve(clique_limit);
+        w.to_remove.reserve(clique_limit);
+
+        u64 i, cur;
+        while (!stopped.load(std::memory_order_relaxed) &&
+               (i = next_root.fetch_add(1)) < roots.size())
+        {
+            cur = roots[i];
+            if (REQUIRED_SIZE == 1)
+            {  // every vertex is a clique of size 1, dummy case
+                if (!push(std::vector<u64>(1, cur))) break;
+                continue;
+            }
+            if (this->load_vertex(w, cur)) this->search_vertex(w, cur);
+        }
+
+        std::lock_guard<std::mutex> guard(found_lock);
+        n_running--;
+        if (n_running == 0) not_empty.notify_all();
+    }
+
+    // load the SearchState at the root of the subtree of cur onto the stack
+    // return false if cur cannot possibly build a clique of REQUIRED_SIZE
+    bool ParallelEnumerator::load_vertex(Worker& w, u64 cur)
+    {
+        const u64 request_size =
+            (G.vertices[cur].N % BITS_PER_U64 != 0) + G.vertices[cur].N / BITS_PER_U64;
+        u64 j, vert, clique_potential = 1;
+
+        // count the candidates first, to know how much memory the worker needs:
+        // only search thru neighbors with greater degrees (see CliqueEnumerator)
+        for (j = 0; j < G.vertices[cur].spos; j++)
+        {
+            vert = G.edge_list[G.vertices[cur].elo + j];
+            clique_potential += (G.vertices[vert].N > G.vertices[cur].N);
+        }
+        for (j = G.vertices[cur].spos + 1; j < G.vertices[cur].N; j++)
+        {
+            vert = G.edge_list[G.vertices[cur].elo + j];
+            clique_potential += (G.vertices[vert].N >= G.vertices[cur].N);
+        }
+        if (clique_potential < this->REQUIRED_SIZE) return false;
+
+        // the stack can hold at most clique_potential states, and each state
+        // needs memory for one cand; the base also needs memory for res
+        w.reserve_memory((clique_potential + 1) * request_size);
+
+        // "memory" allocations for cand, res at root of subtree
+        SearchState x(G.vertices[cur], w.load_memory(request_size),
+                      w.load_memory(request_size));
+        for (j = 0; j < G.vertices[cur].spos; j++)
+        {
+            vert = G.edge_list[G.vertices[cur].elo + j];
+            if (G.vertices[vert].N > G.vertices[cur].N) x.cand.set(j);
+        }
+        for (j = G.vertices[cur].spos + 1; j < G.vertices[cur].N; j++)
+        {
+            vert = G.edge_list[G.vertices[cur].elo + j];
+            if (G.vertices[vert].N >= G.vertices[cur].N) x.cand.set(j);
+        }
+
+        // rows are needed only for the candidates at the root of the subtree
+        w.with_adj =
+            this->use_bitmatrix && w.adj.load(G.edge_list, G.vertices, cur, x.cand);
+
+        // always use std::move when pushing on to stack
+        w.states.push_back(std::move(x));
+        return true;
+    }
+
+    // run the CliqueEnumerator search on the subtree of cur until it is
+    // finished (or the search is stopped)
+    void ParallelEnumerator::search_vertex(Worker& w, u64 cur)
+    {
+        const u64 request_size =
+            (G.vertices[cur].N % BITS_PER_U64 != 0) + G.vertices[cur].N / BITS_PER_U64;
+        u64 candidates_left, clique_potential, clique_size = 1;
+        u64 j, k, vert, start, ans;
+
+        while (!w.states.empty())
+        {
+            if (stopped.load(std::memory_order_relaxed)) break;
+            // strong assumption:
+            // the top of the stack always leads to a clique of REQUIRED_SIZE
+            SearchState& cur_state = w.states.back();
+            candidates_left = cur_state.cand.count();
+
+            for (j = cur_state.start_at; j < G.vertices[cur].N; j++)
+            {
+                if (!cur_state.cand[j]) continue;
+                cur_state.cand.reset(j);
+                cur_state.start_at = j + 1;
+                candidates_left--;
+                clique_potential = candidates_left + 1 + clique_size;
+
+                // ensure only the vertices found in the below loop are removed later
+                w.to_remove.clear();
+
+                vert = G.edge_list[G.vertices[cur].elo + j];
+                start = G.vertices[vert].spos + 1;
+
+                if (w.with_adj)
+                {
+                    // the remaining candidates adjacent to vert are in row j
+                    clique_potential =
+                        cur_state.cand.and_count(w.adj.row(j)) + clique_size + 1;
+                }
+                else
+                {
+                    for (k = j + 1; k < G.vertices[cur].N &&
+                                    clique_potential >= this->REQUIRED_SIZE;
+                         k++)
+                    {
+                        if (!cur_state.cand[k]) continue;
+                        if (G.edge_list.find(G.vertices[vert].elo + start,
+                                             G.vertices[vert].N - start,
+                                             G.edge_list[G.vertices[cur].elo + k],
+                                             ans) != FOUND)
+                            w.to_remove.push_back(k);
+
+                        clique_potential =
+                            (candidates_left - w.to_remove.size()) + clique_size + 1;
+                        start += ans;
+                    }
+                }
+
+                // is it possible to produce a clique of REQUIRED_SIZE?
+                if (clique_potential >= this->REQUIRED_SIZE)
+                {
+                    if (clique_size + 1 >= this->REQUIRED_SIZE)
+                    {
+                        // copy the clique (with vert) out of the stack
+                        std::vector<u64> clique;
+                        clique.reserve(clique_size + 1);
+                        cur_state.res.set(j);
+                        for (k = cur_state.res.next(0); k < G.vertices[cur].N;
+                             k = cur_state.res.next(k + 1))
+                            clique.push_back(G.edge_list[G.vertices[cur].elo + k]);
+                        // search can now continue without vert
+                        cur_state.res.reset(j);
+                        if (!this->push(std::move(clique))) break;
+                    }
+
+                    else  // clique may still grow to REQUIRED_SIZE
+                    {
+                        SearchState future_state(j);
+                        future_state.refer_from(w.load_memory(request_size),
+                                                cur_state.cand, cur_state.res);
+
+                        // remove invalid members from the candidate set
+                        if (w.with_adj)
+                            future_state.cand &= w.adj.row(j);
+                        else
+                            for (auto k : w.to_remove) future_state.cand.reset(k);
+
+                        w.states.push_back(std::move(future_state));
+                        clique_size++;
+                        // the top of the stack has changed,
+                        // prevent any further operations on cur_state
+                        break;
+                    }
+                }
+            }
+
+            // all verts with id > cur_state.id have been checked
+            if (j >= G.vertices[cur].N)
+            {
+                const u64 id = cur_state.id;
+                w.states.pop_back();
+                w.clear_memory(request_size);
+                // res is shared by the whole stack, the base of which is not popped
+                if (!w.states.empty()) w.states.back().res.reset(id);
+                clique_size--;
+            }
+        }
+
+        if (!w.states.empty())  // the search was stopped
+        {
+            // release memory of all candidates on the stack
+            w.clear_memory(request_size * w.states.size());
+            w.states.clear();
+        }
+
+        w.clear_memory(request_size);
+        // release memory of x.res i.e. the space for
+        // the clique allocated at the base of the stack
+    }
+}  // namespace detail
+}  // namespace cliquematch
@@ -2,9 +2,24 @@
  *
  * Provides methods for the constructing a graph instance and exporting its
  * internal data.
+ *
+ * The binary format written by to_binary is a sequence of u64s in the byte
+ * order of the machine:
+ *
+ * header: BINARY_MAGIC (or BINARY_MAGIC32), n_vert, el_size, eb_size, max_degree
+ * vertex data: N, spos, elo, ebo for each of the n_vert vertices
+ * edge data: the el_size values of edge_list
+ *
+ * so the edge data is 8-byte aligned when the file is mapped. The edge data
+ * are u32s instead of u64s if the magic value is BINARY_MAGIC32, i.e. if the
+ * graph stored its edges as u32s. A file written on a machine with a
+ * different byte order is rejected, because the magic value does not match.
  */
 #include <detail/graph/graph.h>
-#include <iostream>
+#include <detail/bitops.h>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
 
 namespace cliquematch
 {
@@ -21,51 +36,120 @@ namespace detail
         CUR_MAX_CLIQUE_LOCATION = 0;
         CUR_MAX_CLIQUE_SIZE = 0;
         CLIQUE_LIMIT = 0xFFFF;
+        paused_at = 0;
     }
 
-    graph::graph(const u64 n_vert, const u64 n_edges,
-                 std::pair<std::vector<u64>, std::vector<u64>>&& edges)
-        : graph()
+    graph::graph(csrBuilder&& edges) : graph()
     {
-        clean_edges(n_vert + 1, edges);
-        this->n_vert = n_vert + 1;
+        edges.finish();
+        this->n_vert = edges.n_vert;
         this->vertices.resize(this->n_vert);
+        this->edge_store.swap(edges.neighbors);
+        this->edge_store32.swap(edges.neighbors32);
+        if (edges.narrow)
+            this->edge_list = edgeList(edge_store32.data());
+        else
+            this->edge_list = edgeList(edge_store.data());
+        this->el_size = edges.offsets[this->n_vert];
 
-        this->edge_list.swap(edges.second);
-        this->edge_bits.swap(edges.first);
-        /* this is why a pair<vector>&& is used instead of pair<vector>& or
-         * vector<pair>&. Instead of allocating yet another large block of
-         * memory and copying the edge info there, I can simply swap the memory
-         * into the vectors owned by the graph. (This necessitated the custom
-         * sort+unique for pair<vector>s instead of std::sort+unique.)
-         *
-         * Note also that edge_bits holds way more memory than required; I can
-         * use the extra memory during the search via load_memory() and
-         * clear_memory() instead of making repeated calls to the heap for
-         * small allocations.
-         *
-         * edge_bits is vector<u64>. no need to reinterpret_cast<u64*> to use this
-         * memory.
-         */
+        u64 i, N, spos;
+        for (i = 0; i < this->n_vert; i++)
+        {
+            N = edges.offsets[i + 1] - edges.offsets[i];
+            edge_list.find(edges.offsets[i], N, i, spos);
+            this->vertices[i].refer_from(N, edges.offsets[i], this->eb_size);
+            this->vertices[i].spos = spos;
+            this->eb_size += (N % BITS_PER_U64 != 0) + N / BITS_PER_U64;
+            if (N > max_degree) max_degree = N;
+        }
+        edges.offsets = std::vector<u64>();
 
-        u64 i, j, spos, el_size_max = edge_list.size();
-        u64* eb_base = edge_bits.data();
+        // edge_bits has no spare memory, so set_bounds allocates exactly what
+        // the search requires
+        this->edge_bits.resize(eb_size + 1);
         for (i = 0; i < this->n_vert; i++)
+            this->vertices[i].set_spos(edge_bits.data(), vertices[i].spos);
+
+        search_start = 1 + eb_size;
+        search_cur = search_start;
+        search_end = edge_bits.size();
+
+        this->set_bounds();
+    }
+
+    // identifies the format and the byte order ("cmgraph1" if big-endian)
+    constexpr u64 BINARY_MAGIC = 0x636d677261706831ULL;
+    // same as above, but with u32 edge data ("cmgraph2" if big-endian)
+    constexpr u64 BINARY_MAGIC32 = 0x636d677261706832ULL;
+    constexpr u64 BINARY_HEADER_LEN = 5;
+    constexpr u64 BINARY_VERTEX_LEN = 4;
+
+    static std::runtime_error binary_error(const std::string& filename,
+                                           const std::string& msg, int line)
+    {
+        return std::runtime_error(msg + " " + filename + "!\n" + std::string(__FILE__) +
+                                  "  " + std::to_string(line) + "\n");
+    }
+
+    graph::graph(const std::string& binary_filename) : graph()
+    {
+        edge_map = std::make_shared<const mappedFile>(binary_filename.c_str());
+        const u64* data = reinterpret_cast<const u64*>(edge_map->data());
+        const u64 n_words = edge_map->size() / sizeof(u64);
+
+        if (n_words < BINARY_HEADER_LEN ||
+            (data[0] != BINARY_MAGIC && data[0] != BINARY_MAGIC32))
+            throw binary_error(binary_filename, "Not a cliquematch binary graph:",
+                               __LINE__);
+        const u64 width = (data[0] == BINARY_MAGIC32) ? sizeof(u32) : sizeof(u64);
+        this->n_vert = data[1];
+        this->el_size = data[2];
+        this->eb_size = data[3];
+        this->max_degree = data[4];
+        // check sizes without overflowing
+        if (n_vert == 0 || n_vert > (n_words - BINARY_HEADER_LEN) / BINARY_VERTEX_LEN)
+            throw binary_error(binary_filename, "Invalid size in binary graph:",
+                               __LINE__);
+        const u64 n_prefix = BINARY_HEADER_LEN + BINARY_VERTEX_LEN * n_vert;
+        const u64 edge_bytes = edge_map->size() - sizeof(u64) * n_prefix;
+        if (edge_bytes % width != 0 || el_size != edge_bytes / width)
+            throw binary_error(binary_filename, "Invalid size in binary graph:",
+                               __LINE__);
+
+        const u64* vdata = data + BINARY_HEADER_LEN;
+        const u64* edata = data + n_prefix;
+        if (width == sizeof(u32))
+            this->edge_list = edgeList(reinterpret_cast<const u32*>(edata));
+        else
+            this->edge_list = edgeList(edata);
+        this->vertices.resize(n_vert);
+        this->edge_bits.resize(eb_size + 1);
+        u64 i, k, N, spos, elo, ebo;
+        for (i = 0; i < n_vert; i++, vdata += BINARY_VERTEX_LEN)
         {
-            spos = 0;
-            for (j = 0; el_size + j < el_size_max && edge_bits[el_size + j] == i; j++)
+            N = vdata[0];
+            spos = vdata[1];
+            elo = vdata[2];
+            ebo = vdata[3];
+            // the search trusts the vertex data and edges completely,
+            // so check everything that to_binary guarantees
+            if (N == 0 || N > max_degree || N > el_size || spos >= N ||
+                elo > el_size - N || ebo > eb_size ||
+                (N % BITS_PER_U64 != 0) + N / BITS_PER_U64 > eb_size - ebo ||
+                edge_list[elo + spos] != i || edge_list[elo + N - 1] >= n_vert)
+                throw binary_error(binary_filename, "Invalid vertex in binary graph:",
+                                   __LINE__);
+            for (k = elo + 1; k < elo + N; k++)
             {
-                edge_bits[el_size + j] = 0;
-                if (edge_list[el_size + j] == i) spos = j;
+                if (edge_list[k - 1] >= edge_list[k])
+                    throw binary_error(binary_filename,
+                                       "Unsorted edges in binary graph:", __LINE__);
             }
-
-            this->vertices[i].refer_from(j, this->el_size, this->eb_size);
-            this->vertices[i].set_spos(eb_base, spos);
-            this->el_size += j;
-            this->eb_size += (j % BITS_PER_U64 != 0) + j / BITS_PER_U64;
-            if (j > max_degree) max_degree = j;
+            this->vertices[i].refer_from(N, elo, ebo);
+            this->vertices[i].set_spos(edge_bits.data(), spos);
         }
 
+        // edge_bits has no spare memory, set_bounds will allocate
         search_start = 1 + eb_size;
         search_cur = search_start;
         search_end = edge_bits.size();
@@ -73,6 +157,45 @@ namespace detail
         this->set_bounds();
     }
 
+    void graph::to_binary(const std::string& filename) const
+    {
+        // write to a temporary file and then rename, because the graph may
+        // have been loaded from (i.e. still be using) the file being replaced
+        const std::string tmpname = filename + ".tmp";
+        std::ofstream f(tmpname, std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!f.is_open())
+            throw binary_error(tmpname, "Unable to open", __LINE__);
+
+        const u64 magic = edge_list.is_narrow() ? BINARY_MAGIC32 : BINARY_MAGIC;
+        std::vector<u64> buf = {magic, n_vert, el_size, eb_size, max_degree};
+        buf.reserve(BINARY_HEADER_LEN + BINARY_VERTEX_LEN * n_vert);
+        for (u64 i = 0; i < n_vert; i++)
+        {
+            buf.push_back(vertices[i].N);
+            buf.push_back(vertices[i].spos);
+            buf.push_back(vertices[i].elo);
+            buf.push_back(vertices[i].ebo);
+        }
+        f.write(reinterpret_cast<const char*>(buf.data()), buf.size() * sizeof(u64));
+        f.write(static_cast<const char*>(edge_list.data()),
+                el_size * edge_list.width());
+        f.close();
+        if (!f)
+        {
+            std::remove(tmpname.c_str());
+            throw binary_error(tmpname, "Unable to write", __LINE__);
+        }
+
+        // rename does not replace an existing file on Windows
+        if (std::rename(tmpname.c_str(), filename.c_str()) != 0 &&
+            (std::remove(filename.c_str()) != 0 ||
+             std::rename(tmpname.c_str(), filename.c_str()) != 0))
+        {
+            std::remove(tmpname.c_str());
+            throw binary_error(filename, "Unable to write", __LINE__);
+        }
+    }
+
     /* call set_spos() for each vertex of the graph, collect rudimentary
      * heuristics like maximum degree and maximum clique size for each vertex,
      * and ensure adequate memory is present for the clique search
@@ -113,35 +236,29 @@ namespace detail
 
         const u64 size_per_step =
             (max_degree % BITS_PER_U64 != 0) + max_degree / BITS_PER_U64;
-        const u64 spread = (search_end - search_start);
+        // (edge_bits may be shorter than search_start for graphs with very few edges)
+        const u64 spread = search_end > search_start ? search_end - search_start : 0;
         const u64 max_space = 2 * (CLIQUE_LIMIT + 1) * (size_per_step);
         /*
-         * Available memory in edge_bits ~= (|V| + 2|E|) - ceil(2|E|/64) max.
-         * degree for a vertex = d_max < |V|
-         * -> max. clique search depth = d_max < |V|
-         * -> max. search space required = d_max x ceil(d_max/64) (dividing by
-         *  64-bit for bitsets to be safe) Claim is that available memory is
-         *  almost always greater than maximum search space required.
-         *
-         *  (assume that search space is reusable)
-         *
-         * the condition in the below line is almost always false, due to
-         * the above calculation (may happen for really small or dense graphs)
+         * The constructors allocate edge_bits only for the vertex bitsets, so
+         * the space for the clique search is added here: the search depth is
+         * at most CLIQUE_LIMIT, and each step uses bitsets of size_per_step.
          */
         if (spread < max_space + 1)
         {
-            std::cerr << "search spread: " << spread
-                      << "; max requirement: " << max_space << "; ratio = "
-                      << (1.0 * (search_end - search_start)) / (max_space) << std::endl;
             edge_bits.resize(eb_size + max_space + 1);
             search_end = edge_bits.size();
+            // the vertex bitsets refer to the old memory
+            for (cur = 0; cur < size; cur++)
+                vertices[cur].bits.refer_from(&edge_bits[vertices[cur].ebo],
+                                              vertices[cur].N);
         }
     }
 
     void graph::disp() const
     {
         for (u64 i = 0; i < this->n_vert; i++)
-            this->vertices[i].disp(i, this->edge_list.data());
+            this->vertices[i].disp(i, this->edge_list);
     }
 
     // pass edges one by one to external function
@@ -157,72 +274,209 @@ namespace detail
     // return all neighbors of a vertex as a set
     std::set<u64> graph::vertex_data(u64 i) const
     {
-        auto ans = std::set<u64>(
-            this->edge_list.begin() + this->vertices[i].elo,
-            this->edge_list.begin() + this->vertices[i].elo + this->vertices[i].N);
+        std::set<u64> ans;
+        for (u64 k = 0; k < this->vertices[i].N; k++)
+            ans.insert(ans.end(), this->edge_list[this->vertices[i].elo + k]);
         ans.erase(ans.find(i));
         return ans;
     }
 
-    std::pair<std::vector<u64>, std::vector<u64>> iso_edges(u64& num_vertices,
-                                                            u64& num_edges,
-                                                            const graph& g1,
-                                                            const graph& g2)
+    /* The edges are added in parallel, one vertex i1 of g1 at a time (the
+     * csrBuilder is atomic, so each thread adds its edges directly). For a
+     * pair (i1, i2), the vertices j2 > j1 joined with j1 are the bits of row
+     * j1 of one of two bitmatrices of g2: upper (all j2 > j1) if i1 and i2 are
+     * neighbors, and apart (j2 > j1 that are not neighbors of j1) otherwise,
+     * so the inner loop picks a word with a mask instead of a branch, and
+     * only visits the j2 that give edges.
+     */
+    csrBuilder iso_edges(const graph& g1, const graph& g2)
     {
         // subtract 1 from each because 0 is a sentinel vertex for graph
-        num_vertices = (g1.n_vert - 1) * (g2.n_vert - 1);
-        num_edges = 0;
-        std::pair<std::vector<u64>, std::vector<u64>> edges;
-        edges.first.resize(num_vertices + 1);
-        edges.second.resize(num_vertices + 1);
+        const u64 n1 = g1.n_vert - 1, n2 = g2.n_vert - 1;
+        csrBuilder edges(n1 * n2);
 
-        u64 i1, i2, j1, j2, v1, v2;
-        u64 k, l;
-        BFResult f1, f2;
+        u64 i1, j1, j2, k, l;
 
-        for (l = 0; l < edges.first.size(); l++)
+        // (i1, j1) and (i2, j2) are neighbors for all i2 != i1 and j2 != j1,
+        // except when i2 is not a neighbor of i1 and j2 is a neighbor of j1,
+        // so the degrees are known without going through the edges
+        for (i1 = 1; i1 <= n1; i1++)
         {
-            edges.first[l] = l;
-            edges.second[l] = l;
+            for (j1 = 1; j1 <= n2; j1++)
+            {
+                l = (n1 - g1.vertices[i1].N) * (g2.vertices[j1].N - 1);
+                edges.count_neighbors((i1 - 1) * n2 + j1, (n1 - 1) * (n2 - 1) - l);
+            }
         }
-        for (i1 = 1; i1 < g1.n_vert; ++i1)
+        edges.start_fill();
+        if (n1 < 2 || n2 < 2) return edges;
+
+        // bit (j2 - 1) of row j1 is at word (j2 - 1) / 64, counting from the
+        // MSB (as in graphBits); rows hold no bits for j2 <= j1 or j2 > n2
+        const u64 W = (n2 + 63) / 64;
+        std::vector<u64> upper(n2 * W, 0), apart(n2 * W, 0);
+        for (j1 = 1; j1 < n2; j1++)
         {
-            // undirected edges, so symmetric
-            for (i2 = i1 + 1; i2 < g1.n_vert; i2++)
+            u64* up = &upper[(j1 - 1) * W];
+            u64* ap = &apart[(j1 - 1) * W];
+            up[j1 >> 6] = ALL_ONES >> (j1 & 63);
+            for (k = (j1 >> 6) + 1; k < W; k++) up[k] = ALL_ONES;
+            if ((n2 & 63) != 0) up[W - 1] &= ALL_ONES << (64 - (n2 & 63));
+            for (k = 0; k < W; k++) ap[k] = up[k];
+            for (k = 0; k < g2.vertices[j1].N; k++)
             {
-                f1 = g1.find_if_neighbors(i1, i2, k);
-                for (j1 = 1; j1 < g2.n_vert; ++j1)
+                j2 = g2.edge_list[g2.vertices[j1].elo + k] - 1;
+                ap[j2 >> 6] &= ~(MSB_64 >> (j2 & 63));
+            }
+        }
+
+        const u64 n_threads = resolve_threads(0, n1 * n1 * n2 * n2);
+        parallel_for(
+            n_threads, n1 - 1,
+            [&g1, &edges, &upper, &apart, n1, n2, W](u64 t)
+            {
+                const u64 i1 = t + 1;
+                u64 i2, j1, j2, w, b, word, pick, v1, v2, pos;
+                for (i2 = i1 + 1; i2 <= n1; i2++)
                 {
-                    // undirected edges, so symmetric
-                    for (j2 = j1 + 1; j2 < g2.n_vert; ++j2)
+                    // g2 is a subgraph of g1, which means
+                    // an edge (j1, j2) in g2 => there exists an edge (i1, i2) in g1,
+                    // so if (i1, i2) is an edge, all j2 are valid
+                    pick = 0 - static_cast<u64>(g1.find_if_neighbors(i1, i2, pos) == 1);
+                    for (j1 = 1; j1 < n2; j1++)
                     {
-                        f2 = g2.find_if_neighbors(j1, j2, l);
-                        // g2 is a subgraph of g1, which means
-                        // an edge (j1, j2) in g2 => there exists an edge (i1, i2) in g1
-                        // (x => y means ~x | y)
-                        if ((f1 != 1) && (f2 == 1)) continue;
-
-                        // encode vertex info as i*M + j
-                        // assume j1 maps to i1, j2 maps to i2
-                        v1 = (i1 - 1) * (g2.n_vert - 1) + (j1 - 1) + 1;
-                        v2 = (i2 - 1) * (g2.n_vert - 1) + (j2 - 1) + 1;
-                        edges.first.push_back(v1);
-                        edges.second.push_back(v2);
-                        edges.first.push_back(v2);
-                        edges.second.push_back(v1);
-
-                        // undirected edges, so j1 may map to i2 also
-                        v1 = (i2 - 1) * (g2.n_vert - 1) + (j1 - 1) + 1;
-                        v2 = (i1 - 1) * (g2.n_vert - 1) + (j2 - 1) + 1;
-                        edges.first.push_back(v1);
-                        edges.second.push_back(v2);
-                        edges.first.push_back(v2);
-                        edges.second.push_back(v1);
-                        num_edges += 2;
+                        const u64* up = &upper[(j1 - 1) * W];
+                        const u64* ap = &apart[(j1 - 1) * W];
+                        for (w = (j1 >> 6); w < W; w++)
+                        {
+                            word = (up[w] & pick) | (ap[w] & ~pick);
+                            while (word != 0)
+                            {
+                                b = clz(word);
+                                word &= ~(MSB_64 >> b);
+                                j2 = (w << 6) + b + 1;
+
+                                // encode vertex info as i*M + j
+                                // assume j1 maps to i1, j2 maps to i2
+                                v1 = (i1 - 1) * n2 + (j1 - 1) + 1;
+                                v2 = (i2 - 1) * n2 + (j2 - 1) + 1;
+                                edges.add(v1, v2);
+
+                                // undirected edges, so j1 may map to i2 also
+                                v1 = (i2 - 1) * n2 + (j1 - 1) + 1;
+                                v2 = (i1 - 1) * n2 + (j2 - 1) + 1;
+                                edges.add(v1, v2);
+                            }
+                        }
                     }
                 }
+            });
+        return edges;
+    }
+
+    /* With a filter, only the compatible pairs (i, j) are vertices: j must
+     * have the same label as i and, if use_degree, no more neighbors than i
+     * (the neighbors of j are mapped to distinct neighbors of i when all of
+     * g2 is found in g1). The pairs kept are numbered in order, and vertex v
+     * is the pair with (i - 1) * n2 + j = vmap[v - 1]. The edges between kept
+     * pairs are those of iso_edges, but the degrees are not known beforehand,
+     * so the edges are generated twice (count, then add).
+     */
+    csrBuilder iso_edges(const graph& g1, const graph& g2, const bool use_degree,
+                         const std::vector<u64>& labels1,
+                         const std::vector<u64>& labels2, std::vector<u64>& vmap)
+    {
+        const u64 n1 = g1.n_vert - 1, n2 = g2.n_vert - 1, W = (n2 + 63) / 64;
+        const bool use_labels = !labels1.empty();
+        u64 i, j, k, w;
+
+        // bit (j - 1) of row i of kept is on if (i, j) is kept (as in iso_edges),
+        // and rank[(i - 1) * W + w] is the number of pairs kept before word w
+        std::vector<u64> kept(n1 * W, 0), rank(n1 * W, 0);
+        vmap.clear();
+        for (i = 1; i <= n1; i++)
+        {
+            for (j = 1; j <= n2; j++)
+            {
+                if (use_labels && labels1[i - 1] != labels2[j - 1]) continue;
+                if (use_degree && g2.vertices[j].N > g1.vertices[i].N) continue;
+                kept[(i - 1) * W + ((j - 1) >> 6)] |= MSB_64 >> ((j - 1) & 63);
+                vmap.push_back((i - 1) * n2 + j);
             }
         }
+        for (k = 0, w = 0; k < n1 * W; k++)
+        {
+            rank[k] = w;
+            w += bitcount(kept[k]);
+        }
+
+        // row j1 of others has all j2 != j1, and row j1 of apart has the j2 != j1
+        // that are not neighbors of j1
+        std::vector<u64> others(n2 * W, ALL_ONES), apart;
+        for (j = 1; j <= n2; j++)
+        {
+            u64* ot = &others[(j - 1) * W];
+            if ((n2 & 63) != 0) ot[W - 1] = ALL_ONES << (64 - (n2 & 63));
+            ot[(j - 1) >> 6] &= ~(MSB_64 >> ((j - 1) & 63));
+        }
+        apart = others;
+        for (j = 1; j <= n2; j++)
+        {
+            for (k = 0; k < g2.vertices[j].N; k++)
+            {
+                i = g2.edge_list[g2.vertices[j].elo + k] - 1;
+                apart[(j - 1) * W + (i >> 6)] &= ~(MSB_64 >> (i & 63));
+            }
+        }
+
+        // the edges from each kept (i1, j1) to the kept (i2, j2) with i2 > i1
+        csrBuilder edges(vmap.size());
+        auto generate = [&](const bool fill, const u64 t)
+        {
+            const u64 i1 = t + 1;
+            const u64* k1 = &kept[(i1 - 1) * W];
+            u64 i2, j1, w1, w2, b, b1, mask1, word, pick, pos, v1, v2;
+            for (i2 = i1 + 1; i2 <= n1; i2++)
+            {
+                const u64* k2 = &kept[(i2 - 1) * W];
+                const u64* r2 = &rank[(i2 - 1) * W];
+                // (i1, i2) is an edge => all j2 are valid, as in iso_edges
+                pick = 0 - static_cast<u64>(g1.find_if_neighbors(i1, i2, pos) == 1);
+                v1 = rank[(i1 - 1) * W];
+                for (w1 = 0; w1 < W; w1++)
+                {
+                    for (mask1 = k1[w1]; mask1 != 0; mask1 &= ~(MSB_64 >> b1))
+                    {
+                        b1 = clz(mask1);
+                        j1 = (w1 << 6) + b1 + 1;
+                        v1++;
+                        const u64* ot = &others[(j1 - 1) * W];
+                        const u64* ap = &apart[(j1 - 1) * W];
+                        for (w2 = 0; w2 < W; w2++)
+                        {
+                            word = k2[w2] & ((ot[w2] & pick) | (ap[w2] & ~pick));
+                            while (word != 0)
+                            {
+                                b = clz(word);
+                                word &= ~(MSB_64 >> b);
+                                v2 = r2[w2] + bitcount(k2[w2] & ~(ALL_ONES >> b)) + 1;
+                                if (fill)
+                                    edges.add(v1, v2);
+                                else
+                                    edges.count(v1, v2);
+                            }
+                        }
+                    }
+                }
+            }
+        };
+
+        const u64 n_threads = resolve_threads(0, vmap.size() * vmap.size());
+        if (n1 > 1 && n2 > 1)
+            parallel_for(n_threads, n1 - 1, [&generate](u64 t) { generate(false, t); });
+        edges.start_fill();
+        if (n1 > 1 && n2 > 1)
+            parallel_for(n_threads, n1 - 1, [&generate](u64 t) { generate(true, t); });
         return edges;
     }
 }  // namespace detail
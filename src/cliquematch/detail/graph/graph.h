@@ -20,32 +20,55 @@
  *
  * Design quirks:
  *
- * The constructor accepts a pair<vector>&& instead of vector<pair>& so that
- * the memory used for reading the edges can be swapped into the graph. This
- * saves a LOT of memory, but the tradeoff is the use of raw pointers, and
- * custom memory management.
+ * The constructor accepts a csrBuilder&& so that the memory used for reading
+ * the edges can be swapped into the graph: the builder creates edge_list
+ * directly (see csrbuilder.h), and edge_bits is allocated only as large as
+ * required. This saves a LOT of memory, but the tradeoff is the use of raw
+ * pointers, and custom memory management.
 
  * Earlier (4) was allocated on the heap, but now has been combined with (3).
  * There is some internal bookkeeping done for the clique search, but overall
  * memory is managed by std::vector<T> and member functions DO NOT perform any
  * new/deletes.
+ *
+ * (1) is accessed via an edgeList view, because it is either owned by the
+ * graph (edge_store, or edge_store32 if the vertex IDs fit in a u32) or read
+ * directly from a file written by to_binary (edge_map). The edges in the file
+ * are already sorted and deduplicated, so loading it only needs the vertex
+ * data, and the OS reads the edges when they are used. A graph cannot be
+ * copied, because edge_list would point into the original.
+ *
+ * If a StackDFS or ColoringDFS runs out of time (or is interrupted), the graph
+ * keeps it in paused_dfs or paused_coloring, so that find_max_cliques can
+ * continue its search from the same node when called again with the returned
+ * start_vert.
  */
 
 #include <detail/graph/vertex.h>
+#include <detail/csrbuilder.h>
+#include <detail/edgelist.h>
+#include <detail/mapfile.h>
 #include <chrono>
 #include <functional>
+#include <memory>
 #include <set>
+#include <string>
 #include <utility>
 
 namespace cliquematch
 {
 namespace detail
 {
+    class StackDFS;
+    class ColoringDFS;
 
     class graph
     {
        private:
-        std::vector<u64> edge_list;    // store raw list of edges
+        edgeList edge_list;             // raw list of edges (edge_store* or edge_map)
+        std::vector<u64> edge_store;    // store raw list of edges
+        std::vector<u32> edge_store32;  // (or as u32s, if the vertex IDs fit)
+        std::shared_ptr<const mappedFile> edge_map;  // binary file with the edges
         std::vector<u64> edge_bits;    // store all clique bitsets (padded)
         std::vector<vertex> vertices;  // store all contextual vertex info
         u64 el_size;                   // edge_list.size(), computed separately
@@ -83,13 +106,16 @@ namespace detail
                 std::chrono::steady_clock::now() - this->start_time);
             return static_cast<double>(elapsed.count()) / 1e6;
         }
+        std::shared_ptr<StackDFS> paused_dfs;          // searches paused by the
+        std::shared_ptr<ColoringDFS> paused_coloring;  // time limit (one at most)
+        u64 paused_at;                                 // (the start_vert it returned)
 
         // find if two vertices are neighbors, if yes, return valid position
         BFResult find_if_neighbors(const u64 v1_id, const u64 v2_id,
                                    u64& v2_position) const
         {
-            return binary_find(&(this->edge_list[this->vertices[v1_id].elo]),
-                               this->vertices[v1_id].N, v2_id, v2_position);
+            return this->edge_list.find(this->vertices[v1_id].elo,
+                                        this->vertices[v1_id].N, v2_id, v2_position);
         }
 
         void set_bounds();  // used by constructor to set bounds for search
@@ -105,15 +131,34 @@ namespace detail
         u64 CUR_MAX_CLIQUE_SIZE;      // size of the CUR_MAX_CLIQUE
         u64 CUR_MAX_CLIQUE_LOCATION;  // vertex ID containing the CUR_MAX_CLIQUE
 
+        // checked along with the time limit during the search: if it returns
+        // true, the search is paused as if it ran out of time (e.g. on Ctrl-C)
+        std::function<bool()> interrupt;
+
         // basic functions
         graph();
-        // notice that edges are consumed (CALLER needs to std::move)
-        graph(const u64 n_vert, const u64 n_edges,
-              std::pair<std::vector<u64>, std::vector<u64>>&& edges);
+        graph(const graph&) = delete;
+        graph& operator=(const graph&) = delete;
+        // the builder is consumed after both passes (CALLER needs to std::move)
+        explicit graph(csrBuilder&& edges);
+        // load a graph from a file written by to_binary (throws error if the
+        // file is invalid); the edges are used directly from the mapped file
+        explicit graph(const std::string& binary_filename);
+        // write the edge data to a binary file (the search results are not saved)
+        void to_binary(const std::string& filename) const;
+        // number of edges in the graph (not counting loops)
+        u64 n_edges() const { return (el_size - n_vert) / 2; }
 
         // call with starting vertex to compute cliques
+        // (n_threads > 1 searches in parallel, 0 uses all available cores;
+        // use_coloring prunes with a coloring bound, on a single thread;
+        // use_bitmatrix stores the neighborhood of each vertex as a bitmatrix,
+        // on a single thread; a time_limit > 0 also searches on a single
+        // thread, and start_vert is set to where the search was paused)
         double find_max_cliques(u64& start_vert, bool use_heur = false,
-                                bool use_dfs = true, double time_limit = -1);
+                                bool use_dfs = true, double time_limit = -1,
+                                u64 n_threads = 1, bool use_coloring = false,
+                                bool use_bitmatrix = false);
         // return the overall max clique
         std::vector<u64> get_max_clique() const;
         // return the max clique stored for vertex i
@@ -127,15 +172,21 @@ namespace detail
         void disp() const;
 
         // construct a correspondence graph for subgraph isomorphisms
-        friend std::pair<std::vector<u64>, std::vector<u64>> iso_edges(u64&, u64&,
-                                                                       const graph&,
-                                                                       const graph&);
+        friend csrBuilder iso_edges(const graph&, const graph&);
+        // (keeping only the pairs of vertices allowed by degree and labels)
+        friend csrBuilder iso_edges(const graph&, const graph&, const bool,
+                                    const std::vector<u64>&, const std::vector<u64>&,
+                                    std::vector<u64>&);
 
         // clique search objects need access to internal data
         friend class RecursionDFS;
         friend class StackDFS;
+        friend class ParallelDFS;
+        friend class ColoringDFS;
         friend class DegreeHeuristic;
         friend class CliqueEnumerator;
+        friend class ParallelEnumerator;
+        friend class MaximalEnumerator;
     };
 }  // namespace detail
 }  // namespace cliquematch
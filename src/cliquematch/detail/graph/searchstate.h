@@ -48,6 +48,23 @@ namespace detail
             this->res.set(this->id);
         }
     };
+
+    // A PivotState is an element of the search stack used in MaximalEnumerator.
+    // Bron-Kerbosch needs the excluded vertices (excl) along with cand, and
+    // the vertices left to branch on after choosing a pivot (todo). The memory
+    // comes from the CALLER, and res is shared by the whole stack, as above.
+    struct PivotState
+    {
+        const u64 id;  // index of the neighbor that's been added to the clique
+        u64 start_at;  // index where the search of todo should start
+        graphBits res, cand, excl, todo;
+
+        PivotState(u64 id) : id(id), start_at(0){};
+        PivotState(PivotState&& tmp)
+            : id(tmp.id), start_at(tmp.start_at), res(std::move(tmp.res)),
+              cand(std::move(tmp.cand)), excl(std::move(tmp.excl)),
+              todo(std::move(tmp.todo)){};
+    };
 }  // namespace detail
 }  // namespace cliquematch
 #endif /* SEARCHSTATE_H */
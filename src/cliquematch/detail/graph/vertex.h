@@ -21,6 +21,7 @@
  */
 
 #include <detail/gbits.h>
+#include <detail/edgelist.h>
 
 namespace cliquematch
 {
@@ -63,11 +64,11 @@ namespace detail
         }
 
         // display the neighbors given the raw data
-        void disp(const u64, const u64*) const;
-        void clique_disp(const u64*) const;
+        void disp(const u64, const edgeList&) const;
+        void clique_disp(const edgeList&) const;
 
         // return a clique computed starting at this vertex
-        std::vector<u64> give_clique(const u64*) const;
+        std::vector<u64> give_clique(const edgeList&) const;
     };
 
 }  // namespace detail
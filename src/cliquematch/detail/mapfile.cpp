@@ -0,0 +1,101 @@
+#include <detail/mapfile.h>
+#include <stdexcept>
+#include <string>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace cliquematch
+{
+namespace detail
+{
+    static std::runtime_error map_error(const char* filename, int line)
+    {
+        return std::runtime_error("Unable to map file " + std::string(filename) +
+                                  "!\n" + std::string(__FILE__) + "  " +
+                                  std::to_string(line) + "\n");
+    }
+
+#ifdef _WIN32
+    mappedFile::mappedFile(const char* filename)
+    {
+        base = nullptr;
+        len = 0;
+        map_handle = nullptr;
+        file_handle = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL,
+                                  OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (file_handle == INVALID_HANDLE_VALUE) throw map_error(filename, __LINE__);
+
+        LARGE_INTEGER fsize;
+        if (!GetFileSizeEx(file_handle, &fsize))
+        {
+            CloseHandle(file_handle);
+            throw map_error(filename, __LINE__);
+        }
+        len = static_cast<u64>(fsize.QuadPart);
+        // an empty file cannot be mapped, but is still a valid file
+        if (len == 0) return;
+
+        map_handle = CreateFileMappingA(file_handle, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (map_handle != nullptr)
+            base = static_cast<const char*>(
+                MapViewOfFile(map_handle, FILE_MAP_READ, 0, 0, 0));
+        if (base == nullptr)
+        {
+            if (map_handle != nullptr) CloseHandle(map_handle);
+            CloseHandle(file_handle);
+            throw map_error(filename, __LINE__);
+        }
+    }
+
+    mappedFile::~mappedFile()
+    {
+        if (base != nullptr) UnmapViewOfFile(base);
+        if (map_handle != nullptr) CloseHandle(map_handle);
+        CloseHandle(file_handle);
+    }
+#else
+    mappedFile::mappedFile(const char* filename)
+    {
+        base = nullptr;
+        len = 0;
+        int fd = open(filename, O_RDONLY);
+        if (fd < 0) throw map_error(filename, __LINE__);
+
+        struct stat st;
+        if (fstat(fd, &st) != 0)
+        {
+            close(fd);
+            throw map_error(filename, __LINE__);
+        }
+        len = static_cast<u64>(st.st_size);
+        // an empty file cannot be mapped, but is still a valid file
+        if (len == 0)
+        {
+            close(fd);
+            return;
+        }
+
+        void* ptr = mmap(nullptr, len, PROT_READ, MAP_PRIVATE, fd, 0);
+        // the mapping stays valid after the file is closed
+        close(fd);
+        if (ptr == MAP_FAILED) throw map_error(filename, __LINE__);
+        base = static_cast<const char*>(ptr);
+    }
+
+    mappedFile::~mappedFile()
+    {
+        if (base != nullptr) munmap(const_cast<char*>(base), len);
+    }
+#endif
+}  // namespace detail
+}  // namespace cliquematch
@@ -0,0 +1,43 @@
+#ifndef MAPFILE_H
+#define MAPFILE_H
+
+/* mapfile.h
+ *
+ * mappedFile maps an entire file into memory as read-only data, and unmaps it
+ * when destroyed. The data is paged in by the OS when it is accessed, so
+ * large files can be "loaded" without reading them: a graph written with
+ * graph::to_binary uses the edges directly from the mapping.
+ *
+ * mappedFile instances cannot be copied or moved; share them via
+ * std::shared_ptr so that the mapping outlives everything that refers to it.
+ */
+
+#include <detail/utils.h>
+
+namespace cliquematch
+{
+namespace detail
+{
+    class mappedFile
+    {
+       private:
+        const char* base;  // start of the mapped data (NULL if the file is empty)
+        u64 len;           // size of the file in bytes
+#ifdef _WIN32
+        void* file_handle;
+        void* map_handle;
+#endif
+
+       public:
+        mappedFile(const mappedFile&) = delete;
+        mappedFile& operator=(const mappedFile&) = delete;
+        // throws error if unable to open or map the file
+        explicit mappedFile(const char* filename);
+        ~mappedFile();
+
+        const char* data() const { return base; }
+        u64 size() const { return len; }
+    };
+}  // namespace detail
+}  // namespace cliquematch
+#endif /* MAPFILE_H */
@@ -1,82 +1,204 @@
+/* mmio.cpp
+ *
+ * Reader for Matrix Market files. The file is mapped into memory (see
+ * mapfile.h) and split into chunks of whole lines, which are parsed on
+ * separate threads:
+ *
+ * 1) each thread counts the edge lines (i.e. lines that are not blank or
+ * comments) in its chunk, which gives the index of the first edge of each
+ * chunk, so that only the first n_edges edges (as given in the header) are read
+ *
+ * 2) each thread parses its chunk and counts the degrees of the vertices
+ *
+ * 3) each thread parses its chunk again, and places the edges in the lists of
+ * neighbors allocated after (2). See csrbuilder.h, which allows (2) and (3)
+ * without any locking.
+ *
+ * The integers are parsed by hand, which is much faster than iostreams.
+ */
+
 #include <detail/mmio.h>
+#include <detail/mapfile.h>
+#include <detail/csrbuilder.h>
+#include <algorithm>
+#include <functional>
 #include <iostream>
-#include <fstream>
+#include <memory>
 #include <string>
 #include <stdexcept>
+#include <thread>
 
 namespace cliquematch
 {
 namespace detail
 {
-    std::pair<std::vector<u64>, std::vector<u64>> mmio4_reader(const char* filename,
-                                                               u64& n_vert,
-                                                               u64& n_edges)
+    // files smaller than this are not worth splitting across threads
+    constexpr u64 MIN_CHUNK_BYTES = 1 << 20;
+
+    // returns the position just after the end of the line containing p
+    static inline const char* next_line(const char* p, const char* end)
+    {
+        while (p < end && *p != '\n') p++;
+        return p < end ? p + 1 : end;
+    }
+
+    static inline bool is_blank(const char c)
+    {
+        return c == ' ' || c == '\t' || c == '\r';
+    }
+
+    // a line contains an edge if it is not blank or a comment
+    static inline bool is_edge_line(const char* p, const char* end)
+    {
+        while (p < end && is_blank(*p)) p++;
+        return p < end && *p != '\n' && *p != '%' && *p != '#';
+    }
+
+    // read an unsigned integer from the current line, moving p past it;
+    // values that do not fit in a u64 are read as the largest u64
+    static inline bool parse_value(const char*& p, const char* end, u64& val)
+    {
+        while (p < end && is_blank(*p)) p++;
+        if (p == end || *p < '0' || *p > '9') return false;
+        val = 0;
+        for (; p < end && *p >= '0' && *p <= '9'; p++)
+        {
+            const u64 digit = static_cast<u64>(*p - '0');
+            val = (val > (~0ULL - digit) / 10) ? ~0ULL : 10 * val + digit;
+        }
+        return true;
+    }
+
+    // the header values may be spread across lines, like reading with >>
+    static bool parse_header_value(const char*& p, const char* end, u64& val)
+    {
+        while (p < end && (is_blank(*p) || *p == '\n')) p++;
+        return parse_value(p, end, val);
+    }
+
+    static u64 count_edge_lines(const char* p, const char* end)
+    {
+        u64 count = 0;
+        for (; p < end; p = next_line(p, end)) count += is_edge_line(p, end);
+        return count;
+    }
+
+    // parse the edge lines in [p, end), the first of which is edge number
+    // edge_index in the file, calling func(v1, v2) for each edge (func returns
+    // false if the edge is invalid); returns the number of invalid edges
+    template <typename Func>
+    static u64 parse_edge_lines(const char* p, const char* end, u64 edge_index,
+                                const u64 n_edges, Func func)
+    {
+        u64 n_invalids = 0, v1, v2;
+        for (; p < end && edge_index < n_edges; p = next_line(p, end))
+        {
+            if (!is_edge_line(p, end)) continue;
+            edge_index++;
+
+            // there might be some additional data, like edge weights,
+            // which is ignored when moving to the next line
+            const char* q = p;
+            if (!parse_value(q, end, v1) || !parse_value(q, end, v2))
+            {
+                n_invalids++;
+                continue;
+            }
+            // loops are ignored, but are not invalid
+            if (!func(v1, v2)) n_invalids += (v1 != v2);
+        }
+        return n_invalids;
+    }
+
+    csrBuilder mmio4_reader(const char* filename, u64& n_vert, u64& n_edges)
     {
         using namespace std;
-        ifstream f(filename, ios::in);
-        if (!f.is_open())
+        unique_ptr<mappedFile> f;
+        try
+        {
+            f.reset(new mappedFile(filename));
+        }
+        catch (runtime_error&)
         {
             throw runtime_error("Unable to open Matrix Market File!\n" +
                                 string(__FILE__) + "  " + to_string(__LINE__) + "\n");
         }
+        const char* p = f->data();
+        const char* const end = p + f->size();
+
         // the Matrix Market format has a preamble:
         // a number of lines starting with % or #
         // describing the origin of the graph, who made it,
         // and some properties
-        while (f.peek() == '%' || f.peek() == '#') f.ignore(2048, '\n');
-
-        u64 n_loops = 0, n_invalids = 0, dummy, i, j;
-        u64 v1, v2;
+        while (p < end && (*p == '%' || *p == '#')) p = next_line(p, end);
 
         // the file then has the number of vertices twice
         // followed by the number of edges
-        f >> n_vert;
-        f >> dummy;
-        f >> n_edges;
-
-        pair<vector<u64>, vector<u64>> Edges;
-        // each edge is going to stored twice
-        // plus dummy loop edges for easier cliques
-        // plus a sentinel vertex to show errors
-        Edges.first.resize(2 * n_edges + n_vert + 1);
-        Edges.second.resize(2 * n_edges + n_vert + 1);
-
-        // fill the loop edges first.  A better way might be to fill these at
-        // the end, and filling only those vertices which have neighbors.
-        for (j = 0; j < n_vert + 1; j++)
+        u64 dummy, i, j;
+        if (!parse_header_value(p, end, n_vert) || !parse_header_value(p, end, dummy) ||
+            !parse_header_value(p, end, n_edges))
         {
-            Edges.first[j] = j;
-            Edges.second[j] = j;
+            throw runtime_error("Invalid Matrix Market File!\n" + string(__FILE__) +
+                                "  " + to_string(__LINE__) + "\n");
         }
-        for (i = 0, j = n_vert + 1; i < n_edges && !f.eof(); i++, j += 2)
+        p = next_line(p, end);
+
+        // split the edge lines into chunks, each ending at a newline
+        const u64 len = static_cast<u64>(end - p);
+        u64 n_threads = std::max(1u, std::thread::hardware_concurrency());
+        n_threads = std::min(n_threads, 1 + len / MIN_CHUNK_BYTES);
+        vector<const char*> bounds(n_threads + 1, end);
+        vector<u64> counts(n_threads, 0), invalids(n_threads, 0);
+        bounds[0] = p;
+        for (i = 1; i < n_threads; i++)
         {
-            f >> v1 >> v2;
-            // there might be some additional data, like edge weights
-            f.ignore(2048, '\n');
+            const char* guess = p + i * (len / n_threads);
+            bounds[i] = next_line(std::max(bounds[i - 1], guess), end);
+        }
 
-            // ignore any invalid edges or loops
-            if (v1 > n_vert || v2 > n_vert || v1 == v2)
+        auto run_chunks = [n_threads](std::function<void(u64)> func)
+        {
+            vector<thread> threads;
+            for (u64 t = 1; t < n_threads; t++) threads.emplace_back(func, t);
+            func(0);
+            for (auto& t : threads) t.join();
+        };
+        run_chunks([&bounds, &counts](u64 t)
+                   { counts[t] = count_edge_lines(bounds[t], bounds[t + 1]); });
+        // counts[t] becomes the index of the first edge in chunk t
+        for (i = 0, j = 0; i < n_threads; i++)
+        {
+            const u64 c = counts[i];
+            counts[i] = j;
+            j += c;
+        }
+        // edges with vertices > n_vert (or 0, the sentinel) are invalid
+        csrBuilder edges(n_vert);
+        run_chunks(
+            [&](u64 t)
             {
-                (v1 != v2) ? n_invalids++ : n_loops++;
-                Edges.first[j] = 0;
-                Edges.second[j] = 0;
-                Edges.first[j + 1] = 0;
-                Edges.second[j + 1] = 0;
-            }
-            else
+                invalids[t] = parse_edge_lines(bounds[t], bounds[t + 1], counts[t],
+                                               n_edges, [&edges](u64 v1, u64 v2)
+                                               { return edges.count(v1, v2); });
+            });
+        edges.start_fill();
+        run_chunks(
+            [&](u64 t)
             {
-                Edges.first[j] = v1;
-                Edges.second[j] = v2;
-                Edges.first[j + 1] = v2;
-                Edges.second[j + 1] = v1;
-            }
-        }
-        f.close();
+                parse_edge_lines(bounds[t], bounds[t + 1], counts[t], n_edges,
+                                 [&edges](u64 v1, u64 v2)
+                                 {
+                                     edges.add(v1, v2);
+                                     return true;
+                                 });
+            });
 
+        u64 n_invalids = 0;
+        for (auto x : invalids) n_invalids += x;
         if (n_invalids != 0)
             cerr << "Warning: " << n_invalids
                  << " invalid edges ignored while reading file\n";
-        return Edges;
+        return edges;
     }
 }  // namespace detail
 }  // namespace cliquematch
@@ -1,8 +1,7 @@
 #ifndef MMIO_H
 #define MMIO_H
 
-#include <vector>
-#include <utility>
+#include <detail/csrbuilder.h>
 #include <cstdint>
 
 namespace cliquematch
@@ -14,11 +13,11 @@ namespace detail
     //
     // https://math.nist.gov/MatrixMarket/formats.html.
     //
-    // returns loaded edges
+    // (large files are parsed on multiple threads, see mmio.cpp)
+    //
+    // returns loaded edges, ready to construct a graph
     // number of vertices/edges are also read from file, returned by reference
-    std::pair<std::vector<u64>, std::vector<u64>> mmio4_reader(const char* filename,
-                                                               u64& n_vert,
-                                                               u64& n_edges);
+    csrBuilder mmio4_reader(const char* filename, u64& n_vert, u64& n_edges);
     // throws error if unable to read the file,
     // prints to stderr if invalid edges are found (ignored in graph)
 }  // namespace detail
@@ -1,3 +1,15 @@
+/* nw_dfs.cpp
+ *
+ * stack-based implementation of the weighted clique search, exactly as in
+ * StackDFS, except that the clique potential is the total weight of the
+ * candidates instead of their count.
+ *
+ * The time limit (and G.interrupt) is checked every CHECK_INTERVAL nodes; when
+ * the time runs out, the stack is kept and process_graph returns the root
+ * vertex being searched, so that calling process_graph again continues from
+ * the top of the stack (see nwgraph::find_max_cliques). The memory for the
+ * stack is owned by the search, as in StackDFS.
+ */
 #include <detail/nwgraph/nwclique.h>
 
 namespace cliquematch
@@ -9,30 +21,47 @@ namespace detail
         // the upper bound on clique size is the maximum depth on the stack
         this->states.reserve(G.max_depth);
         this->to_remove.reserve(G.max_depth);
-        this->weights.reserve(G.max_neighbors);
-        this->process_vertex(G, G.CUR_MAX_CLIQUE_LOCATION);
-        for (i = 0; i < G.n_vert; i++)
+
+        if (!states.empty())
+        {
+            // a paused search first finishes the subtree on its stack
+            if (!this->search_vertex(G)) return i;
+            if (cur == i) i++;
+        }
+        else if (i == 0)
+        {
+            // a new search first tries the vertex with the current maximum
+            // (vertex 0 is the sentinel, so a paused search never returns 0)
+            i = 1;
+            if (this->load_vertex(G, G.CUR_MAX_CLIQUE_LOCATION) &&
+                !this->search_vertex(G))
+                return i;
+        }
+
+        for (; i < G.n_vert; i++)
         {
             if (G.vertices[i].mcs <= G.CUR_MAX_CLIQUE_SIZE ||
                 G.CUR_MAX_CLIQUE_SIZE >= G.CLIQUE_LIMIT)
                 continue;
-            process_vertex(G, i);
+            if (this->out_of_time(G)) break;
+            // if the search is paused in the subtree of i, the stack is kept
+            if (this->load_vertex(G, i) && !this->search_vertex(G)) break;
         }
-        // Dummy return. i = G.n_vert, because the search cannot be interrupted
+        // i = G.n_vert if the search is complete
         return i;
     }
 
-    void NWStackDFS::process_vertex(nwgraph& G, u64 cur)
+    // load the NWSearchState at the root of the subtree of v onto the stack
+    // return false if v cannot possibly build a clique heavier than the maximum
+    bool NWStackDFS::load_vertex(nwgraph& G, u64 v)
     {
-        double cand_potential = 0;
+        this->cur = v;
         request_size =
             (G.vertices[cur].N % BITS_PER_U64 != 0) + G.vertices[cur].N / BITS_PER_U64;
-        // "memory" allocations for cand, res at root of subtree
-        NWSearchState x(G.vertices[cur], G.load_memory(request_size),
-                        G.load_memory(request_size));
         this->clique_potential = 0;
+        u64 n_cand = 0;
 
-        this->weights.clear();
+        this->weights.assign(G.vertices[cur].N, 0);
         // only search thru neighbors with greater degrees
         // (this amortizes the search cost because
         // vertices with really low degree have fewer neighbors
@@ -42,7 +71,7 @@ namespace detail
         {
             vert = G.edge_list[G.vertices[cur].elo + j];
             if (G.vertices[vert].degree <= G.vertices[cur].degree) continue;
-            x.cand.set(j);
+            n_cand++;
             this->clique_potential += G.vertices[vert].weight;
             this->weights[j] = G.vertices[vert].weight;
         }
@@ -54,26 +83,56 @@ namespace detail
         {
             vert = G.edge_list[G.vertices[cur].elo + j];
             if (G.vertices[vert].degree < G.vertices[cur].degree) continue;
-            x.cand.set(j);
+            n_cand++;
             this->clique_potential += G.vertices[vert].weight;
             this->weights[j] = G.vertices[vert].weight;
         }
 
         if (this->clique_potential + G.vertices[cur].weight <= G.CUR_MAX_CLIQUE_SIZE)
+            return false;
+
+        // the stack can hold at most n_cand + 1 states, and each state
+        // needs memory for one cand; the base also needs memory for res
+        // (only resized when the stack is empty, so resizing is safe)
+        if (memory.size() < (n_cand + 2) * request_size)
+            memory.resize((n_cand + 2) * request_size, 0);
+
+        // "memory" allocations for cand, res at root of subtree
+        NWSearchState x(G.vertices[cur], load_memory(request_size),
+                        load_memory(request_size));
+        for (j = 0; j < G.vertices[cur].spos; j++)
+        {
+            vert = G.edge_list[G.vertices[cur].elo + j];
+            if (G.vertices[vert].degree > G.vertices[cur].degree) x.cand.set(j);
+        }
+        for (j = G.vertices[cur].spos + 1; j < G.vertices[cur].N; j++)
         {
-            G.clear_memory(2 * request_size);  // clear x.cand, x.res
-            return;
+            vert = G.edge_list[G.vertices[cur].elo + j];
+            if (G.vertices[vert].degree >= G.vertices[cur].degree) x.cand.set(j);
         }
 
+        // rows are needed only for the candidates at the root of the subtree,
+        // and replace the binary_find below
+        with_adj = this->use_bitmatrix &&
+                   adj.load(G.edge_list, G.vertices, cur, x.cand);
+
         x.potential = this->clique_potential;
 
         // always use std::move when pushing on to stack
         states.push_back(std::move(x));
         clique_weight = G.vertices[cur].weight;
+        return true;
+    }
 
+    // search the subtree on the stack until it is done (return true), or until
+    // the time runs out (return false, the stack is kept for the next call)
+    bool NWStackDFS::search_vertex(nwgraph& G)
+    {
+        double cand_potential = 0;
         while (!states.empty())
         {
             if (G.CUR_MAX_CLIQUE_SIZE >= G.CLIQUE_LIMIT) break;
+            if (this->out_of_time(G)) return false;
             // strong assumption:
             // the top of the stack always leads to a clique larger than the current max
             // (checking is done before pushing on to the stack)
@@ -101,10 +160,12 @@ namespace detail
                      k < G.vertices[cur].N && candidates_left != 0;
                      k = cur_state.cand.next(k + 1))
                 {
-                    if (binary_find(&(G.edge_list[G.vertices[vert].elo +
-                                                  G.vertices[vert].spos]),
-                                    G.vertices[vert].N - G.vertices[vert].spos,
-                                    G.edge_list[G.vertices[cur].elo + k], ans) != FOUND)
+                    if (with_adj
+                            ? !adj.adjacent(j, k)
+                            : G.edge_list.find(
+                                  G.vertices[vert].elo + G.vertices[vert].spos,
+                                  G.vertices[vert].N - G.vertices[vert].spos,
+                                  G.edge_list[G.vertices[cur].elo + k], ans) != FOUND)
                     {
                         to_remove.push_back(k);
                         candidates_left -= 1;
@@ -142,7 +203,7 @@ namespace detail
                         // no need to allocate memory for res, refer_from passes the
                         // reference of the cur_state.res much like res is passed in
                         // RecursionDFS
-                        future_state.refer_from(G.load_memory(request_size),
+                        future_state.refer_from(load_memory(request_size),
                                                 cur_state.cand, cur_state.res);
 
                         // clique_size has increased due to vert
@@ -170,26 +231,29 @@ namespace detail
             {
                 // all potential cliques that can contain (cur, v) have been searched
                 // where v is at position cur_state.id in list of cur's neighbors
+                const u64 id = cur_state.id;
                 states.pop_back();
-                G.clear_memory(request_size);
+                clear_memory(request_size);
 
                 // remove v from clique consideration because the future
                 // candidates will not have it as part of the clique
-                cur_state.res.reset(cur_state.id);
-                clique_weight -= this->weights[cur_state.id];
+                // (res is shared by the whole stack)
+                if (!states.empty()) states.back().res.reset(id);
+                clique_weight -= this->weights[id];
             }
         }
 
         if (!states.empty())  // the search was terminated due to CLIQUE_LIMIT
         {
             // release memory of all candidates on the stack
-            G.clear_memory(request_size * states.size());
+            clear_memory(request_size * states.size());
             states.clear();
         }
 
-        G.clear_memory(request_size);
+        clear_memory(request_size);
         // release memory of x.res i.e. the space for
         // the clique allocated at the base of the stack
+        return true;
     }
 }  // namespace detail
 }  // namespace cliquematch
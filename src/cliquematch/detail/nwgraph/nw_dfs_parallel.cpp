@@ -0,0 +1,371 @@
+/* nw_dfs_parallel.cpp
+ *
+ * multi-threaded version of the weighted clique search in nw_dfs.cpp. The
+ * search from each root vertex is exactly as in NWStackDFS, and the
+ * bookkeeping around it is that of ParallelDFS (see dfs_parallel.cpp): root
+ * vertices are taken from a shared queue, each thread has its own stack,
+ * scratch memory and weights of the root's neighbors, and once the queue is
+ * empty, idle threads steal the bottom-most unexplored SearchStates from the
+ * other threads' stacks.
+ *
+ * The weight of the maximum clique is a double, so it is shared as an
+ * atomic<double> that only grows: a thread that finds a heavier clique raises
+ * it with a compare-exchange loop, so the others prune with it immediately,
+ * and then saves the clique bits of the vertex under a lock.
+ *
+ * Compare with NWStackDFS when changing the implementation.
+ */
+#include <detail/nwgraph/nwclique.h>
+#include <thread>
+
+namespace cliquematch
+{
+namespace detail
+{
+    NWParallelDFS::NWParallelDFS(u64 n_threads)
+        : n_threads(n_threads), first_root(0), next_root(0), max_weight(0),
+          n_busy(0)
+    {
+    }
+
+    void NWParallelDFS::Worker::reserve_memory(const u64 N)
+    {
+        // only called when the stack is empty, so resizing is safe
+        if (mem_cur + N > memory.size()) memory.resize(mem_cur + N, 0);
+    }
+
+    // weights[j] is the weight of the neighbor of cur at position j;
+    // only called when the worker's stack is empty
+    void NWParallelDFS::load_weights(const nwgraph& G, Worker& w, const u64 cur)
+    {
+        w.weights.resize(G.vertices[cur].N);
+        for (u64 j = 0; j < G.vertices[cur].N; j++)
+            w.weights[j] = G.vertices[G.edge_list[G.vertices[cur].elo + j]].weight;
+    }
+
+    u64 NWParallelDFS::process_graph(nwgraph& G)
+    {
+        u64 i, n_workers = n_threads;
+        if (n_workers == 0) n_workers = std::thread::hardware_concurrency();
+        if (n_workers == 0) n_workers = 1;
+
+        first_root = G.CUR_MAX_CLIQUE_LOCATION;
+        next_root.store(0);
+        max_weight.store(G.CUR_MAX_CLIQUE_SIZE);
+        // every worker is busy until the queue of root vertices is empty
+        n_busy.store(n_workers);
+
+        // the upper bound on clique size is the maximum depth on the stack;
+        // reserve before starting the threads, because stacks can be stolen from
+        workers.clear();
+        for (i = 0; i < n_workers; i++)
+        {
+            workers.emplace_back(new Worker());
+            workers[i]->states.reserve(G.max_depth);
+            workers[i]->to_remove.reserve(G.max_depth);
+            workers[i]->weights.reserve(G.max_neighbors);
+        }
+
+        std::vector<std::thread> threads;
+        threads.reserve(n_workers - 1);
+        for (i = 1; i < n_workers; i++)
+            threads.emplace_back(&NWParallelDFS::run_worker, this, std::ref(G), i);
+        // the calling thread is also a worker
+        this->run_worker(G, 0);
+        for (auto& t : threads) t.join();
+        workers.clear();
+
+        // Dummy return. i = G.n_vert, because the search cannot be interrupted
+        return G.n_vert;
+    }
+
+    // pop the next root vertex from the shared queue: position 0 is
+    // first_root (the location of the maximum clique before the search
+    // started), and position i + 1 is vertex i
+    bool NWParallelDFS::next_vertex(nwgraph& G, u64& cur)
+    {
+        u64 pos;
+        while ((pos = next_root.fetch_add(1)) <= G.n_vert)
+        {
+            if (current_max() >= G.CLIQUE_LIMIT) return false;
+            cur = (pos == 0) ? first_root : pos - 1;
+            if (pos != 0 && cur == first_root) continue;
+            if (G.vertices[cur].mcs <= current_max()) continue;
+            return true;
+        }
+        return false;
+    }
+
+    // raise the shared maximum to weight, unless another thread has already
+    // raised it further
+    void NWParallelDFS::raise_max(const double weight)
+    {
+        double seen = max_weight.load(std::memory_order_relaxed);
+        while (weight > seen && !max_weight.compare_exchange_weak(
+                                    seen, weight, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    // res (with the vertex at position j already set) is a clique of the given
+    // weight in the neighborhood of cur; save it if it is still a maximum
+    void NWParallelDFS::save_clique(nwgraph& G, u64 cur, const graphBits& res,
+                                    double weight)
+    {
+        this->raise_max(weight);
+        std::lock_guard<std::mutex> guard(found_lock);
+        if (weight <= G.CUR_MAX_CLIQUE_SIZE) return;
+        G.vertices[cur].bits.copy_data(res);
+        G.vertices[cur].mcs = weight;
+        G.CUR_MAX_CLIQUE_SIZE = weight;
+        G.CUR_MAX_CLIQUE_LOCATION = cur;
+    }
+
+    void NWParallelDFS::run_worker(nwgraph& G, u64 id)
+    {
+        Worker& w = *(workers[id]);
+        u64 cur = 0;
+        double clique_weight = 0;
+        while (this->next_vertex(G, cur))
+        {
+            if (this->load_vertex(G, w, cur))
+                this->process_stack(G, w, G.vertices[cur].weight);
+        }
+        n_busy.fetch_sub(1);
+
+        // no more root vertices, so help the workers that are still busy.
+        // a successful steal marks this worker as busy before the victim's
+        // lock is released, so n_busy == 0 only when there is nothing left
+        while (current_max() < G.CLIQUE_LIMIT)
+        {
+            if (this->steal_state(G, id, clique_weight))
+            {
+                this->process_stack(G, w, clique_weight);
+                n_busy.fetch_sub(1);
+            }
+            else if (n_busy.load() == 0)
+                break;
+            else
+                std::this_thread::yield();
+        }
+    }
+
+    // load the NWSearchState at the root of the subtree of cur onto the stack
+    // return false if the subtree cannot beat the maximum
+    bool NWParallelDFS::load_vertex(nwgraph& G, Worker& w, u64 cur)
+    {
+        const u64 request_size =
+            (G.vertices[cur].N % BITS_PER_U64 != 0) + G.vertices[cur].N / BITS_PER_U64;
+        u64 j, vert, n_cand = 0;
+        double potential = 0;
+
+        // count the candidates first, to know how much memory the worker needs:
+        // only search thru neighbors with greater degrees (see NWStackDFS)
+        for (j = 0; j < G.vertices[cur].N; j++)
+        {
+            vert = G.edge_list[G.vertices[cur].elo + j];
+            if (j == G.vertices[cur].spos ||
+                G.vertices[vert].degree < G.vertices[cur].degree ||
+                (j < G.vertices[cur].spos &&
+                 G.vertices[vert].degree == G.vertices[cur].degree))
+                continue;
+            n_cand++;
+            potential += G.vertices[vert].weight;
+        }
+        if (potential + G.vertices[cur].weight <= current_max()) return false;
+
+        // the stack can hold at most n_cand + 1 states, and each state
+        // needs memory for one cand; the base also needs memory for res
+        w.reserve_memory((n_cand + 2) * request_size);
+        this->load_weights(G, w, cur);
+
+        // "memory" allocations for cand, res at root of subtree
+        NWSearchState x(G.vertices[cur], w.load_memory(request_size),
+                        w.load_memory(request_size));
+        for (j = 0; j < G.vertices[cur].N; j++)
+        {
+            vert = G.edge_list[G.vertices[cur].elo + j];
+            if (j == G.vertices[cur].spos ||
+                G.vertices[vert].degree < G.vertices[cur].degree ||
+                (j < G.vertices[cur].spos &&
+                 G.vertices[vert].degree == G.vertices[cur].degree))
+                continue;
+            x.cand.set(j);
+        }
+        x.potential = potential;
+
+        // always use std::move when pushing on to stack
+        std::lock_guard<std::mutex> guard(w.stack_lock);
+        w.root = cur;
+        w.states.push_back(std::move(x));
+        return true;
+    }
+
+    // take the bottom-most unfinished NWSearchState (other than the top) from
+    // another worker's stack, and make it the base of this worker's stack.
+    // clique_weight is set to the weight of the clique at the stolen state
+    bool NWParallelDFS::steal_state(nwgraph& G, u64 id, double& clique_weight)
+    {
+        Worker& w = *(workers[id]);
+        u64 i, d, cur, remaining = 0, request_size;
+        double weight;
+
+        for (i = 1; i < workers.size(); i++)
+        {
+            Worker& v = *(workers[(id + i) % workers.size()]);
+            std::unique_lock<std::mutex> guard(v.stack_lock);
+            cur = v.root;
+
+            for (d = 0, weight = 0; d + 1 < v.states.size(); d++)
+            {
+                // the clique at depth d has the weights of the ids of the states
+                // up to d, and is worth stealing only if it can still beat the
+                // maximum (potential is only changed at the top of the stack)
+                weight += v.weights[v.states[d].id];
+                remaining = v.states[d].cand.count();
+                if (remaining >= 2 && weight + v.states[d].potential > current_max())
+                    break;
+            }
+            if (d + 1 >= v.states.size()) continue;
+
+            NWSearchState& victim = v.states[d];
+            request_size = (G.vertices[cur].N % BITS_PER_U64 != 0) +
+                           G.vertices[cur].N / BITS_PER_U64;
+            // the stolen state is the base of this worker's stack
+            w.reserve_memory((remaining + 2) * request_size);
+            w.weights = v.weights;
+
+            NWSearchState x(victim.id, victim.potential);
+            x.start_at = victim.start_at;
+            // "memory" allocations for res, cand at the base of the stack
+            x.res.refer_from(w.load_memory(request_size), G.vertices[cur].N);
+            x.cand.copy_from(victim.cand, w.load_memory(request_size));
+            for (u64 k = 0; k <= d; k++) x.res.set(v.states[k].id);
+
+            // the victim will pop this state when it returns to it,
+            // and it cannot be stolen again
+            victim.cand.clear();
+            victim.start_at = G.vertices[cur].N;
+            victim.potential = 0;
+
+            // this worker is busy before the victim can become idle
+            n_busy.fetch_add(1);
+            guard.unlock();
+
+            std::lock_guard<std::mutex> own_guard(w.stack_lock);
+            w.root = cur;
+            w.states.push_back(std::move(x));
+            clique_weight = weight;
+            return true;
+        }
+        return false;
+    }
+
+    // run the NWStackDFS search on the worker's stack until it is empty,
+    // clique_weight is the weight of the clique at the base of the stack
+    void NWParallelDFS::process_stack(nwgraph& G, Worker& w, double clique_weight)
+    {
+        const u64 cur = w.root;
+        const u64 request_size =
+            (G.vertices[cur].N % BITS_PER_U64 != 0) + G.vertices[cur].N / BITS_PER_U64;
+        const std::vector<double>& weights = w.weights;
+        double cand_potential, clique_potential;
+        u64 candidates_left, j, k, vert, ans;
+
+        while (!w.states.empty())
+        {
+            if (current_max() >= G.CLIQUE_LIMIT) break;
+            // strong assumption (weakened by other threads changing the maximum):
+            // the top of the stack leads to a clique heavier than the current max
+            NWSearchState& cur_state = w.states.back();
+            cur_state.start_at = cur_state.cand.next(cur_state.start_at);
+
+            for (j = cur_state.start_at; j < G.vertices[cur].N; j = cur_state.start_at)
+            {
+                cur_state.cand.reset(j);
+                cur_state.start_at = cur_state.cand.next(j + 1);
+                cur_state.potential -= weights[j];
+                candidates_left = cur_state.cand.count();
+
+                cand_potential = 0;
+                vert = G.edge_list[G.vertices[cur].elo + j];
+
+                // ensure only the vertices found in the below loop are removed later
+                w.to_remove.clear();
+                for (k = cur_state.start_at;
+                     k < G.vertices[cur].N && candidates_left != 0;
+                     k = cur_state.cand.next(k + 1))
+                {
+                    if (G.edge_list.find(G.vertices[vert].elo + G.vertices[vert].spos,
+                                         G.vertices[vert].N - G.vertices[vert].spos,
+                                         G.edge_list[G.vertices[cur].elo + k],
+                                         ans) != FOUND)
+                    {
+                        w.to_remove.push_back(k);
+                        candidates_left -= 1;
+                    }
+                    else
+                        cand_potential += weights[k];
+                }
+                clique_potential = cand_potential + clique_weight + weights[j];
+
+                // is the current maximum beatable?
+                if (clique_potential > current_max())
+                {
+                    if (candidates_left == 0)
+                    {
+                        // include vert as part of the clique and copy
+                        cur_state.res.set(j);
+                        this->save_clique(G, cur, cur_state.res, clique_potential);
+                        // search can now continue without vert
+                        cur_state.res.reset(j);
+                    }
+
+                    else  // clique may still grow to beat the maximum
+                    {
+                        NWSearchState future_state(j, cand_potential);
+                        future_state.refer_from(w.load_memory(request_size),
+                                                cur_state.cand, cur_state.res);
+
+                        // remove invalid members from the candidate set
+                        for (auto k : w.to_remove) future_state.cand.reset(k);
+
+                        // cur_state is no longer the top of the stack after this,
+                        // so it can be stolen
+                        std::lock_guard<std::mutex> guard(w.stack_lock);
+                        w.states.push_back(std::move(future_state));
+                        clique_weight += weights[j];
+                        // the top of the stack has changed,
+                        // prevent any further operations on cur_state
+                        break;
+                    }
+                }
+            }
+
+            // all verts with id > cur_state.id have been checked
+            if (j == G.vertices[cur].N)
+            {
+                const u64 id = cur_state.id;
+                std::lock_guard<std::mutex> guard(w.stack_lock);
+                w.states.pop_back();
+                w.clear_memory(request_size);
+                // res is shared by the whole stack, the base of which is not popped
+                if (!w.states.empty()) w.states.back().res.reset(id);
+                clique_weight -= weights[id];
+            }
+        }
+
+        std::lock_guard<std::mutex> guard(w.stack_lock);
+        if (!w.states.empty())  // the search was terminated due to CLIQUE_LIMIT
+        {
+            // release memory of all candidates on the stack
+            w.clear_memory(request_size * w.states.size());
+            w.states.clear();
+        }
+
+        w.clear_memory(request_size);
+        // release memory of x.res i.e. the space for
+        // the clique allocated at the base of the stack
+    }
+}  // namespace detail
+}  // namespace cliquematch
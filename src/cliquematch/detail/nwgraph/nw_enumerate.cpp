@@ -124,10 +124,10 @@ namespace detail
                      k++)
                 {
                     if (!cur_state.cand[k]) continue;
-                    if (binary_find(&(G.edge_list[G.vertices[vert].elo +
-                                                  G.vertices[vert].spos]),
-                                    G.vertices[vert].N - G.vertices[vert].spos,
-                                    G.edge_list[G.vertices[cur].elo + k], ans) != FOUND)
+                    if (G.edge_list.find(G.vertices[vert].elo + G.vertices[vert].spos,
+                                         G.vertices[vert].N - G.vertices[vert].spos,
+                                         G.edge_list[G.vertices[cur].elo + k],
+                                         ans) != FOUND)
                     {
                         to_remove.push_back(k);
                         cand_potential -= this->weights[k];
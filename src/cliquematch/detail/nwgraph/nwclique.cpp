@@ -5,13 +5,44 @@ namespace cliquematch
 {
 namespace detail
 {
-    void nwgraph::find_max_cliques(u64& start_vert, bool use_heur, bool use_dfs)
+    void nwgraph::find_max_cliques(u64& start_vert, bool use_heur, bool use_dfs,
+                                   bool use_bitmatrix, u64 n_threads,
+                                   double time_limit)
     {
         NWHeuristic heur;
-        NWStackDFS dfs;
+        // a paused NWStackDFS can only be continued by the next call
+        std::shared_ptr<NWStackDFS> paused = std::move(this->paused_dfs);
 
+        this->start_time = std::chrono::steady_clock::now();
         if (use_heur) heur.process_graph((*this));
-        if (use_dfs) start_vert = dfs.process_graph((*this));
+        // the bitmatrix search runs on a single thread, so it ignores n_threads
+        if (time_limit <= 0 && n_threads != 1 && !use_bitmatrix)
+        {
+            NWParallelDFS dfs(n_threads);
+            if (use_dfs) start_vert = dfs.process_graph((*this));
+        }
+        else if (use_dfs)
+        {
+            // continue the paused search if it stopped at start_vert, otherwise
+            // start a new one from start_vert (as in graph::find_max_cliques)
+            std::shared_ptr<NWStackDFS> dfs;
+            if (paused && start_vert != 0 && start_vert == paused_at)
+            {
+                dfs = std::move(paused);
+                dfs->resume(time_limit);
+            }
+            else
+                dfs = std::make_shared<NWStackDFS>(start_vert, time_limit,
+                                                   use_bitmatrix);
+
+            this->start_time = std::chrono::steady_clock::now();
+            start_vert = dfs->process_graph((*this));
+            if (start_vert < this->n_vert)
+            {
+                paused_dfs = std::move(dfs);
+                paused_at = start_vert;
+            }
+        }
     }
 
     std::vector<u64> nwgraph::get_max_clique() const
@@ -20,7 +51,7 @@ namespace detail
     }
     std::vector<u64> nwgraph::get_max_clique(u64 i) const
     {
-        return this->vertices[i].give_clique(this->edge_list.data());
+        return this->vertices[i].give_clique(this->edge_list);
     }
     double nwgraph::get_clique_weight(const std::vector<u64>& clique) const
     {
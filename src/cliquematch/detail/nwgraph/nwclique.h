@@ -1,7 +1,11 @@
 #ifndef NWCLIQUE_H
 #define NWCLIQUE_H
 
+#include <detail/adjmat.h>
 #include <detail/nwgraph/nwgraph.h>
+#include <atomic>
+#include <memory>
+#include <mutex>
 
 namespace cliquematch
 {
@@ -55,17 +59,116 @@ namespace detail
         std::vector<NWSearchState> states;  // used like a stack with push_back/pop_back
         std::vector<u64> to_remove;         // vertices to remove from a candidate
         std::vector<double> weights;
+        // the stack has to outlive a pause, so the memory is owned by the
+        // search instead of being taken from the graph (see StackDFS)
+        std::vector<u64> memory;
+        u64 mem_cur;
 
         double cand_potential, clique_weight, clique_potential;
         u64 candidates_left;
-        u64 i, j, k, vert, ans;
+        u64 i, j, k, vert, ans, cur;
+
+        double TIME_LIMIT;  // <= 0 means no time limit
+        u64 n_nodes;        // nodes searched since the time was last checked
+
+        const bool use_bitmatrix;  // try to use adj for every root vertex
+        bool with_adj;             // adj is loaded for the current root vertex
+        adjMatrix adj;
+
+        u64* load_memory(const u64 N)
+        {
+            u64* loc = &(memory[mem_cur]);
+            mem_cur += N;
+            return loc;
+        }
+        void clear_memory(const u64 N)
+        {
+            mem_cur -= N;
+            for (u64 t = 0; t < N; t++) memory[mem_cur + t] = 0;
+        }
+        bool out_of_time(const nwgraph& G)
+        {
+            if (++n_nodes < CHECK_INTERVAL) return false;
+            n_nodes = 0;
+            return (this->TIME_LIMIT > 0 && G.elapsed_time() > this->TIME_LIMIT) ||
+                   (G.interrupt && G.interrupt());
+        }
 
        public:
-        void process_vertex(nwgraph&, u64);
+        bool load_vertex(nwgraph&, u64);
+        bool search_vertex(nwgraph&);
         u64 process_graph(nwgraph&);
+        // continue a paused search, with a new time limit
+        void resume(double t)
+        {
+            TIME_LIMIT = t;
+            n_nodes = 0;
+        }
+        // (the search starts from vertex v, or is a new search if v is 0)
+        NWStackDFS(u64 v = 0, double t = -1, bool use_bitmatrix = false)
+            : mem_cur(0), i(v), cur(0), TIME_LIMIT(t), n_nodes(0),
+              use_bitmatrix(use_bitmatrix), with_adj(false){};
         ~NWStackDFS() = default;
     };
 
+    class NWParallelDFS : public NWCliqueOperator
+    {
+       private:
+        // everything a thread needs to run its own NWStackDFS (see ParallelDFS):
+        // the memory and the weights of the root's neighbors are owned by the
+        // worker instead of being shared via the graph
+        struct Worker
+        {
+            std::vector<NWSearchState> states;
+            std::vector<u64> to_remove;
+            std::vector<double> weights;
+            std::vector<u64> memory;
+            u64 mem_cur;
+            u64 root;               // the vertex whose subtree is on the stack
+            std::mutex stack_lock;  // held when states is changed, or stolen from
+
+            Worker() : mem_cur(0), root(0){};
+            void reserve_memory(const u64 N);
+            u64* load_memory(const u64 N)
+            {
+                u64* loc = &(memory[mem_cur]);
+                mem_cur += N;
+                return loc;
+            }
+            void clear_memory(const u64 N)
+            {
+                mem_cur -= N;
+                for (u64 i = 0; i < N; i++) memory[mem_cur + i] = 0;
+            }
+        };
+
+        const u64 n_threads;
+        std::vector<std::unique_ptr<Worker>> workers;
+        u64 first_root;                    // G.CUR_MAX_CLIQUE_LOCATION at the start
+        std::atomic<u64> next_root;        // the shared queue of root vertices
+        std::atomic<double> max_weight;    // shared copy of G.CUR_MAX_CLIQUE_SIZE
+        std::atomic<u64> n_busy;           // number of workers with a nonempty stack
+        std::mutex found_lock;             // held when G's clique data is changed
+
+        double current_max() const
+        {
+            return max_weight.load(std::memory_order_relaxed);
+        }
+        void raise_max(const double);
+        void load_weights(const nwgraph&, Worker&, const u64);
+        bool next_vertex(nwgraph&, u64&);
+        bool steal_state(nwgraph&, u64, double&);
+        void save_clique(nwgraph&, u64, const graphBits&, double);
+        void run_worker(nwgraph&, u64);
+        bool load_vertex(nwgraph&, Worker&, u64);
+        void process_stack(nwgraph&, Worker&, double);
+
+       public:
+        u64 process_graph(nwgraph&);
+        NWParallelDFS(u64 n_threads);
+        ~NWParallelDFS() = default;
+    };
+
     class NWCliqueEnumerator : public NWCliqueOperator
     {
        private:
@@ -1,5 +1,4 @@
 #include <detail/nwgraph/nwgraph.h>
-#include <iostream>
 
 namespace cliquematch
 {
@@ -22,43 +21,49 @@ namespace detail
         CUR_MAX_CLIQUE_LOCATION = 0;
         CUR_MAX_CLIQUE_SIZE = 0;
         max_degree = 0;
+        paused_at = 0;
         CLIQUE_LIMIT = 0xFFFF;
     }
 
-    nwgraph::nwgraph(const u64 n_vert, const u64 n_edges,
-                     std::pair<std::vector<u64>, std::vector<u64>>&& edges,
-                     std::vector<double>&& weights)
-        : nwgraph()
+    nwgraph::nwgraph(csrBuilder&& edges, std::vector<double>&& weights) : nwgraph()
     {
-        clean_edges(n_vert + 1, edges);
-        this->n_vert = n_vert + 1;
+        edges.finish();
+        this->n_vert = edges.n_vert;
         this->vertices.resize(this->n_vert);
+        this->edge_store.swap(edges.neighbors);
+        this->edge_store32.swap(edges.neighbors32);
+        if (edges.narrow)
+            this->edge_list = edgeList(edge_store32.data());
+        else
+            this->edge_list = edgeList(edge_store.data());
+        this->el_size = edges.offsets[this->n_vert];
+
+        u64 i, j, N, spos, eb_len = 0;
+        for (i = 0; i < this->n_vert; i++)
+        {
+            N = edges.offsets[i + 1] - edges.offsets[i];
+            eb_len += (N % BITS_PER_U64 != 0) + N / BITS_PER_U64;
+            if (N > max_neighbors) max_neighbors = N;
+        }
+        // edge_bits has no spare memory, so set_bounds allocates exactly what
+        // the search requires
+        this->edge_bits.resize(eb_len + 1);
 
-        this->edge_list.swap(edges.second);
-        this->edge_bits.swap(edges.first);
-
-        u64 i, j, spos, el_size_max = edge_list.size();
         u64* eb_base = edge_bits.data();
         double degree;
-
         for (i = 0; i < this->n_vert; i++)
         {
-            spos = 0;
+            N = edges.offsets[i + 1] - edges.offsets[i];
+            edge_list.find(edges.offsets[i], N, i, spos);
             degree = 0;
-            for (j = 0; el_size + j < el_size_max && edge_bits[el_size + j] == i; j++)
-            {
-                edge_bits[el_size + j] = 0;
-                degree += weights[edge_list[el_size + j]];
-                if (edge_list[el_size + j] == i) spos = j;
-            }
+            for (j = 0; j < N; j++) degree += weights[edge_list[edges.offsets[i] + j]];
 
-            this->vertices[i].load(j, this->el_size, this->eb_size, eb_base, spos,
+            this->vertices[i].load(N, edges.offsets[i], this->eb_size, eb_base, spos,
                                    weights[i], degree);
-            this->el_size += j;
-            this->eb_size += (j % BITS_PER_U64 != 0) + j / BITS_PER_U64;
+            this->eb_size += (N % BITS_PER_U64 != 0) + N / BITS_PER_U64;
             if (degree > max_degree) max_degree = degree;
-            if (j > max_neighbors) max_neighbors = j;
         }
+        edges.offsets = std::vector<u64>();
 
         search_start = 1 + eb_size;
         search_cur = search_start;
@@ -114,35 +119,29 @@ namespace detail
 
         const u64 size_per_step =
             (max_neighbors % BITS_PER_U64 != 0) + max_neighbors / BITS_PER_U64;
-        const u64 spread = (search_end - search_start);
+        // (edge_bits may be shorter than search_start for graphs with very few edges)
+        const u64 spread = search_end > search_start ? search_end - search_start : 0;
         const u64 max_space = 2 * (max_depth + 1) * (size_per_step);
         /*
-         * Available memory in edge_bits ~= (|V| + 2|E|) - ceil(2|E|/64) max.
-         * degree for a vertex = d_max < |V|
-         * -> max. clique search depth = d_max < |V|
-         * -> max. search space required = d_max x ceil(d_max/64) (dividing by
-         *  64-bit for bitsets to be safe) Claim is that available memory is
-         *  almost always greater than maximum search space required.
-         *
-         *  (assume that search space is reusable)
-         *
-         * the condition in the below line is almost always false, due to
-         * the above calculation (may happen for really small or dense nwgraphs)
+         * The constructors allocate edge_bits only for the vertex bitsets, so
+         * the space for the clique search is added here: the search depth is
+         * at most max_depth, and each step uses bitsets of size_per_step.
          */
         if (spread < max_space + 1)
         {
-            std::cerr << "search spread: " << spread
-                      << "; max requirement: " << max_space << "; ratio = "
-                      << (1.0 * (search_end - search_start)) / (max_space) << std::endl;
             edge_bits.resize(eb_size + max_space + 1);
             search_end = edge_bits.size();
+            // the vertex bitsets refer to the old memory
+            for (cur = 0; cur < size; cur++)
+                vertices[cur].bits.refer_from(&edge_bits[vertices[cur].ebo],
+                                              vertices[cur].N);
         }
     }
 
     void nwgraph::disp() const
     {
         for (u64 i = 0; i < this->n_vert; i++)
-            this->vertices[i].disp(i, this->edge_list.data());
+            this->vertices[i].disp(i, this->edge_list);
     }
 
     // pass edges one by one to external function
@@ -158,9 +157,9 @@ namespace detail
     // return all neighbors of a vertex as a set
     std::pair<double, std::set<u64>> nwgraph::vertex_data(u64 i) const
     {
-        auto ans = std::set<u64>(
-            this->edge_list.begin() + this->vertices[i].elo,
-            this->edge_list.begin() + this->vertices[i].elo + this->vertices[i].N);
+        std::set<u64> ans;
+        for (u64 k = 0; k < this->vertices[i].N; k++)
+            ans.insert(ans.end(), this->edge_list[this->vertices[i].elo + k]);
         ans.erase(ans.find(i));
         return std::make_pair(this->vertices[i].weight, std::move(ans));
     }
@@ -2,7 +2,11 @@
 #define NWGRAPH_H
 
 #include <detail/nwgraph/wvertex.h>
+#include <detail/csrbuilder.h>
+#include <detail/edgelist.h>
+#include <chrono>
 #include <functional>
+#include <memory>
 #include <set>
 #include <utility>
 
@@ -10,10 +14,14 @@ namespace cliquematch
 {
 namespace detail
 {
+    class NWStackDFS;
+
     class nwgraph
     {
        private:
-        std::vector<u64> edge_list;     // store raw list of edges
+        edgeList edge_list;             // raw list of edges (edge_store*)
+        std::vector<u64> edge_store;    // store raw list of edges
+        std::vector<u32> edge_store32;  // (or as u32s, if the vertex IDs fit)
         std::vector<u64> edge_bits;     // store all clique bitsets (padded)
         std::vector<wvertex> vertices;  // store all contextual vertex info
         u64 el_size;                    // edge_list.size(), computed separately
@@ -46,12 +54,23 @@ namespace detail
         BFResult find_if_neighbors(const u64 v1_id, const u64 v2_id,
                                    u64& v2_position) const
         {
-            return binary_find(&(this->edge_list[this->vertices[v1_id].elo]),
-                               this->vertices[v1_id].N, v2_id, v2_position);
+            return this->edge_list.find(this->vertices[v1_id].elo,
+                                        this->vertices[v1_id].N, v2_id, v2_position);
         }
 
         void set_bounds();  // used by constructor to set bounds for search
 
+        std::chrono::time_point<std::chrono::steady_clock> start_time;
+        double elapsed_time() const
+        {
+            auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - this->start_time);
+            return static_cast<double>(elapsed.count()) / 1e6;
+        }
+        // a NWStackDFS that ran out of time is kept (as in graph)
+        std::shared_ptr<NWStackDFS> paused_dfs;  // search paused by the time limit
+        u64 paused_at;                           // (the start_vert it returned)
+
        public:
         u64 n_vert;     // number of vertices in the graph
         u64 max_depth;  // the maximum depth of the search stack
@@ -61,16 +80,25 @@ namespace detail
         double CUR_MAX_CLIQUE_SIZE;   // size of the CUR_MAX_CLIQUE
         u64 CUR_MAX_CLIQUE_LOCATION;  // vertex ID containing the CUR_MAX_CLIQUE
 
+        // checked along with the time limit during the search (see graph)
+        std::function<bool()> interrupt;
+
         // basic functions
         nwgraph();
-        // notice that edges are consumed (CALLER needs to std::move)
-        nwgraph(const u64 n_vert, const u64 n_edges,
-                std::pair<std::vector<u64>, std::vector<u64>>&& edges,
-                std::vector<double>&& weights);
+        // the builder is consumed after both passes (CALLER needs to std::move)
+        nwgraph(csrBuilder&& edges, std::vector<double>&& weights);
+        // number of edges in the graph (not counting loops)
+        u64 n_edges() const { return (el_size - n_vert) / 2; }
 
         // call with starting vertex to compute cliques
+        // use_bitmatrix stores the neighborhood of each vertex as a bitmatrix
+        // on a single thread (n_threads > 1 searches in parallel, 0 uses all
+        // available cores, ignored with use_bitmatrix; a time_limit > 0
+        // searches on a single thread, and start_vert is set to where the
+        // search was paused)
         void find_max_cliques(u64& start_vert, bool use_heur = false,
-                              bool use_dfs = true);
+                              bool use_dfs = true, bool use_bitmatrix = false,
+                              u64 n_threads = 1, double time_limit = -1);
         // return the overall max clique
         std::vector<u64> get_max_clique() const;
         // return the max clique stored for vertex i
@@ -89,6 +117,7 @@ namespace detail
 
         // clique search objects need access to internal data
         friend class NWStackDFS;
+        friend class NWParallelDFS;
         friend class NWHeuristic;
         friend class NWCliqueEnumerator;
     };
@@ -5,7 +5,7 @@ namespace cliquematch
 {
 namespace detail
 {
-    void wvertex::disp(const u64 id, const u64* el_base) const
+    void wvertex::disp(const u64 id, const edgeList& el_base) const
     {
         if (this->N <= 1 || this->mcs <= this->weight) return;
         std::cout << "Vertex " << id << " has weight = " << this->weight
@@ -15,17 +15,27 @@ namespace detail
         std::cout << std::endl;
         std::cout << "Current Clique (weight = " << this->mcs << "):";
         this->bits.show();
-        this->bits.show(&el_base[this->elo], this->N);
+        this->clique_disp(el_base);
     }
 
-    void wvertex::clique_disp(const u64* el_base) const
+    void wvertex::clique_disp(const edgeList& el_base) const
     {
-        this->bits.show(&el_base[this->elo], this->N);
+        for (u64 i = 0; i < this->N; i++)
+        {
+            if (this->bits[i]) std::cout << el_base[this->elo + i] << " ";
+        }
+        std::cout << " (" << this->bits.count() << "/" << this->N << ")\n";
     }
 
-    std::vector<u64> wvertex::give_clique(const u64* el_base) const
+    std::vector<u64> wvertex::give_clique(const edgeList& el_base) const
     {
-        return this->bits.get_subset(&el_base[this->elo], this->N);
+        std::vector<u64> ans;
+        ans.reserve(this->bits.count());
+        for (u64 i = 0; i < this->N; i++)
+        {
+            if (this->bits[i]) ans.push_back(el_base[this->elo + i]);
+        }
+        return ans;
     }
 }  // namespace detail
 }  // namespace cliquematch
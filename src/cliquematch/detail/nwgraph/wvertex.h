@@ -2,6 +2,7 @@
 #define WVERTEX_H
 
 #include <detail/gbits.h>
+#include <detail/edgelist.h>
 
 namespace cliquematch
 {
@@ -32,9 +33,9 @@ namespace detail
             this->bits.set(this->spos);
         }
 
-        void disp(const u64, const u64*) const;
-        void clique_disp(const u64*) const;
-        std::vector<u64> give_clique(const u64*) const;
+        void disp(const u64, const edgeList&) const;
+        void clique_disp(const edgeList&) const;
+        std::vector<u64> give_clique(const edgeList&) const;
     };
 }  // namespace detail
 }  // namespace cliquematch
@@ -1,11 +1,14 @@
 #ifndef UTILS_H
 #define UTILS_H
 
+#include <algorithm>
 #include <cstdint>
+#include <functional>
 #include <vector>
 #include <utility>
 
 typedef uint64_t u64;
+typedef uint32_t u32;
 
 namespace cliquematch
 {
@@ -23,9 +26,10 @@ namespace detail
     /* this function is called to check if two vertices are neighbors
      * the parameters are usually the list of neighbors of a vertex,
      * the vertex degree, a potential neighbor, and the location of the neighbor
+     * (T is u32 or u64, depending on how the graph stores its edges)
      */
-    inline BFResult binary_find(const u64* const a, const u64 N, const u64 val,
-                                u64& loc)
+    template <typename T>
+    inline BFResult binary_find(const T* const a, const u64 N, const u64 val, u64& loc)
     {
         /* modified binary search, returns location by reference
          * return FOUND if found, NOT_FOUND if not found
@@ -54,11 +58,51 @@ namespace detail
         return NOT_FOUND;
     }
 
-    void insertionSort(u64* p0, u64* p1, u64 start, u64 end);
-    void radixSort(u64* p0, u64* p1, u64 start, u64 end, u64 shift = 0,
-                   bool key_first = true, const u64 max_shift = 28);
-    u64 modUnique(u64* p0, u64* p1, u64 start, u64 end);
-    void clean_edges(u64, std::pair<std::vector<u64>, std::vector<u64>>&);
+    // less work than this many items is done on a single thread
+    constexpr u64 PARALLEL_MIN_LEN = 1 << 16;
+    // a search checks its time limit (and interrupt) once every these many
+    // nodes, so the clock is not read at every node
+    constexpr u64 CHECK_INTERVAL = 1 << 10;
+    // number of threads to use for len items (n_threads = 0 uses all cores)
+    u64 resolve_threads(u64 n_threads, u64 len);
+    // call func(i) for i in [0, n_items) on n_threads threads
+    void parallel_for(u64 n_threads, u64 n_items, std::function<void(u64)> func);
+
+    /* std::sort on multiple threads: n_threads chunks of [first, last) are
+     * sorted in parallel, and then merged pairwise (with std::inplace_merge)
+     * in log2(n_threads) rounds. Like std::sort, the sort is not stable.
+     */
+    template <typename T>
+    void parallel_sort(T* first, T* last, u64 n_threads = 0)
+    {
+        const u64 len = last - first;
+        n_threads = resolve_threads(n_threads, len);
+        if (n_threads == 1)
+        {
+            std::sort(first, last);
+            return;
+        }
+
+        std::vector<u64> bounds(n_threads + 1);
+        for (u64 t = 0; t <= n_threads; t++) bounds[t] = t * len / n_threads;
+        parallel_for(n_threads, n_threads, [first, &bounds](u64 t)
+                     { std::sort(first + bounds[t], first + bounds[t + 1]); });
+
+        for (u64 width = 1; width < n_threads; width *= 2)
+        {
+            parallel_for(n_threads, (n_threads + 2 * width - 1) / (2 * width),
+                         [first, &bounds, width, n_threads](u64 m)
+                         {
+                             const u64 lo = 2 * m * width;
+                             const u64 mid = std::min(lo + width, n_threads);
+                             const u64 hi = std::min(lo + 2 * width, n_threads);
+                             if (mid < hi)
+                                 std::inplace_merge(first + bounds[lo],
+                                                    first + bounds[mid],
+                                                    first + bounds[hi]);
+                         });
+        }
+    }
 
 }  // namespace detail
 }  // namespace cliquematch
@@ -10,6 +10,133 @@ namespace ext
     {
         return euc_dist0(ll.row(i), ll.row(j));
     }
+
+    /* If delfunc is the default Euclidean distance, the distances from each
+     * point i are computed for all the other points at once, with the
+     * coordinates stored column-wise so that the loop over the other points
+     * vectorizes. The points are split across threads, and the distances
+     * are then sorted in parallel. Any other delfunc (usually a Python
+     * function) is called once per pair, on a single thread.
+     */
+    template <>
+    void relset<Eigen::Ref<DoubleMatrixR>, double>::fill_dists(
+        const Eigen::Ref<DoubleMatrixR>& x)
+    {
+        typedef double (*dfunc_ptr)(const Eigen::Ref<DoubleMatrixR>&, const u64,
+                                    const u64);
+        const dfunc_ptr* f = this->delfunc.template target<dfunc_ptr>();
+        const dfunc_ptr euclidean = dummy_comparison<Eigen::Ref<DoubleMatrixR>, double>;
+        if (f == nullptr || *f != euclidean || static_cast<u64>(x.rows()) < this->N ||
+            x.cols() == 0)
+        {
+            this->compute_dists(x);
+            this->sort_dists();
+            return;
+        }
+
+        const u64 N = this->N, n_dims = x.cols();
+        const bool symmetric = this->symmetric;
+        const Eigen::MatrixXd cols = x.topRows(N);  // column-major copy
+        this->dists.resize(this->n_pairs());
+        auto base = this->dists.data();
+        const u64 n_threads = detail::resolve_threads(0, this->dists.size());
+        const u64 n_blocks = (n_threads == 1) ? 1 : 8 * n_threads;
+
+        detail::parallel_for(
+            n_threads, n_blocks,
+            [&cols, base, N, n_dims, symmetric, n_blocks](u64 b)
+            {
+                Eigen::ArrayXd acc(N);
+                u64 i = b * N / n_blocks, j, k;
+                const u64 i_end = (b + 1) * N / n_blocks;
+                for (; i < i_end; i++)
+                {
+                    // distances to the points j0..N-1
+                    const u64 j0 = symmetric ? i + 1 : 0, len = N - j0;
+                    auto d = acc.head(len);
+                    d = (cols.col(0).segment(j0, len).array() - cols(i, 0)).square();
+                    for (k = 1; k < n_dims; k++)
+                        d += (cols.col(k).segment(j0, len).array() - cols(i, k))
+                                 .square();
+                    d = d.sqrt();
+
+                    // same order as compute_dists
+                    auto out =
+                        base + (symmetric ? i * (2 * N - i - 1) / 2 : i * (N - 1));
+                    for (j = j0; j < N; j++)
+                    {
+                        if (j == i) continue;
+                        out->first = i;
+                        out->second = j;
+                        out->dist = d(j - j0);
+                        out++;
+                    }
+                }
+            });
+        this->sort_dists(n_threads);
+    }
+
+    /* Within max_dist, the Euclidean distances are found with a k-d tree, so
+     * the work and memory grow with the number of pairs kept, instead of
+     * with N^2. Each thread collects the pairs of a block of points, and the
+     * blocks are joined in order before the sort.
+     */
+    template <>
+    void relset<Eigen::Ref<DoubleMatrixR>, double>::fill_dists_within(
+        const Eigen::Ref<DoubleMatrixR>& x, const double max_dist)
+    {
+        typedef double (*dfunc_ptr)(const Eigen::Ref<DoubleMatrixR>&, const u64,
+                                    const u64);
+        const dfunc_ptr* f = this->delfunc.template target<dfunc_ptr>();
+        const dfunc_ptr euclidean = dummy_comparison<Eigen::Ref<DoubleMatrixR>, double>;
+        if (f == nullptr || *f != euclidean || static_cast<u64>(x.rows()) < this->N ||
+            x.cols() == 0)
+        {
+            this->compute_dists_within(x, max_dist);
+            this->sort_dists();
+            return;
+        }
+
+        const u64 N = this->N;
+        const bool symmetric = this->symmetric;
+        const kdTree tree(x.topRows(N));
+        const u64 n_threads = detail::resolve_threads(0, N * N);
+        const u64 n_blocks = (n_threads == 1) ? 1 : 8 * n_threads;
+        std::vector<std::vector<pair_dist<double>>> found(n_blocks);
+
+        detail::parallel_for(
+            n_threads, n_blocks,
+            [&tree, &found, N, symmetric, n_blocks, max_dist](u64 b)
+            {
+                u64 i = b * N / n_blocks;
+                const u64 i_end = (b + 1) * N / n_blocks;
+                pair_dist<double> p;
+                auto keep = [&found, &p, b, symmetric](u64 j, double d)
+                {
+                    if (j == p.first || (symmetric && j < p.first)) return;
+                    p.second = j;
+                    p.dist = d;
+                    found[b].push_back(p);
+                };
+                for (; i < i_end; i++)
+                {
+                    p.first = i;
+                    tree.within(i, max_dist, keep);
+                }
+            });
+
+        u64 b, total = 0;
+        for (b = 0; b < n_blocks; b++) total += found[b].size();
+        this->dists.clear();
+        this->dists.reserve(total);
+        for (b = 0; b < n_blocks; b++)
+        {
+            this->dists.insert(this->dists.end(), found[b].begin(), found[b].end());
+            std::vector<pair_dist<double>>().swap(found[b]);
+        }
+        this->sort_dists(n_threads);
+    }
+
     template bool build_edges(
         pygraph& pg, const Eigen::Ref<DoubleMatrixR>& pts1, const u64 pts1_len,
         const Eigen::Ref<DoubleMatrixR>& pts2, const u64 pts2_len, const double epsilon,
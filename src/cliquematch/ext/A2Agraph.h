@@ -3,6 +3,7 @@
 
 #include <pybind11/eigen.h>
 #include <ext/eigen_distance.hpp>
+#include <ext/kdtree.hpp>
 #include <templates/ext_template.hpp>   // contains only templates
 #include <templates/wrap_template.hpp>  // contains only templates
 
@@ -14,6 +15,16 @@ namespace ext
     double dummy_comparison<Eigen::Ref<DoubleMatrixR>, double>(
         const Eigen::Ref<DoubleMatrixR>& ll, const u64 i, const u64 j);
 
+    // Euclidean distances (i.e. dummy_comparison) are computed in bulk
+    template <>
+    void relset<Eigen::Ref<DoubleMatrixR>, double>::fill_dists(
+        const Eigen::Ref<DoubleMatrixR>& x);
+
+    // (with a k-d tree)
+    template <>
+    void relset<Eigen::Ref<DoubleMatrixR>, double>::fill_dists_within(
+        const Eigen::Ref<DoubleMatrixR>& x, const double max_dist);
+
     // Implemented in A2AGraph.cpp
     extern template struct relset<Eigen::Ref<DoubleMatrixR>, double>;
     extern template bool build_edges(
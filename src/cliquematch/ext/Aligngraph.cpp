@@ -1,54 +1,159 @@
 #include <ext/Aligngraph.h>
-
-using ULongMatrixR =
-    Eigen::Matrix<u64, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>;
+#include <algorithm>
+#include <cmath>
 
 namespace cliquematch
 {
 namespace ext
 {
-    double inline filter_score(const Eigen::Ref<DoubleMatrixR> control,
-                               const Eigen::Ref<BoolMatrixR> msk, Eigen::RowVector2d& c,
-                               Eigen::Ref<DoubleMatrixR> rot_con,
-                               Eigen::Ref<ULongMatrixR> RCU,
-                               const Eigen::Ref<DoubleMatrixR>& M1, const u64 i1,
-                               const u64 j1, const Eigen::Ref<DoubleMatrixR>& M2,
-                               const u64 i2, const u64 j2)
+    maskFilter::maskFilter(const Eigen::Ref<DoubleMatrixR>& control_pts,
+                           const Eigen::Ref<BoolMatrixR>& mask, const double percentage)
+        : n_ctrl(control_pts.rows()), m_r(mask.rows()), m_c(mask.cols()), mask(mask)
     {
-        Eigen::Matrix<double, 4, 4> coeffs;
-        Eigen::Matrix<double, 4, 1> rhs;
-        Eigen::Matrix<double, 4, 1> answer;
+        u64 r, c;
+        if (control_pts.cols() < 2)
+            throw CM_ERROR("Control points need (x, y) coordinates\n");
+        cx = control_pts.col(0);
+        cy = control_pts.col(1);
+        box[0] = box[1] = box[2] = box[3] = 0;
+        if (n_ctrl != 0)
+        {
+            box[0] = cx.minCoeff();
+            box[1] = cy.minCoeff();
+            box[2] = cx.maxCoeff();
+            box[3] = cy.maxCoeff();
+        }
 
-        u64 k, m_r = msk.rows(), m_c = msk.cols();
-        double a, b, msk_score = 0;
-        double x1, y1, x2, y2, x3, y3, x4, y4;
-        x1 = M2(i2, 0), y1 = M2(i2, 1);
-        x2 = M2(j2, 0), y2 = M2(j2, 1);
-        x3 = M1(i1, 0), y3 = M1(i1, 1);
-        x4 = M1(j1, 0), y4 = M1(j1, 1);
-        coeffs << x1, -y1, 1, 0, y1, x1, 0, 1, x2, -y2, 1, 0, y2, x2, 0, 1;
-        rhs << x3, y3, x4, y4;
-        if (x1 - x2 == 0 && y1 - y2 == 0) return msk_score;
-        answer = coeffs.partialPivLu().solve(rhs);
-        a = answer(0, 0);
-        b = answer(1, 0);
-        c(0) = answer(2, 0);
-        c(1) = answer(3, 0);
+        // the same comparison as (number of points in mask) / n_ctrl >= percentage
+        zero_pass = (0 >= percentage);
+        for (need = 0; need <= n_ctrl; need++)
+        {
+            if (static_cast<double>(need) / n_ctrl >= percentage) break;
+        }
+
+        if ((m_r + 1) * (m_c + 1) > UINT32_MAX) return;
+        const u64 w = m_c + 1;
+        area.assign((m_r + 1) * w, 0);
+        for (r = 0; r < m_r; r++)
+        {
+            for (c = 0; c < m_c; c++)
+            {
+                area[(r + 1) * w + c + 1] = this->mask(r, c) + area[r * w + c + 1] +
+                                            area[(r + 1) * w + c] - area[r * w + c];
+            }
+        }
+    }
 
-        rot_con.col(0) = a * control.col(0) - b * control.col(1);
-        rot_con.col(1) = b * control.col(0) + a * control.col(1);
-        rot_con.rowwise() += c;
+    // number of pixels of the mask in rows r0..r1 and cols c0..c1 (inclusive)
+    u64 maskFilter::box_count(const u64 r0, const u64 c0, const u64 r1,
+                              const u64 c1) const
+    {
+        const u64 w = m_c + 1;
+        return (static_cast<u64>(area[(r1 + 1) * w + c1 + 1]) + area[r0 * w + c0]) -
+               (static_cast<u64>(area[r0 * w + c1 + 1]) + area[(r1 + 1) * w + c0]);
+    }
 
-        RCU = rot_con.cast<u64>();
-        // assumption is M1, M2, control_pts and therefore RCU all are in the same
-        // coordinate system, i.e. (x,y) or (col, row)
-        for (k = 0; k < static_cast<u64>(rot_con.rows()); k++)
+    // decide the transform from the bounding box of the control points, if
+    // possible: returns false if every control point has to be checked
+    bool maskFilter::box_check(const double a, const double b, const double c0,
+                               const double c1, bool& result) const
+    {
+        double xlo, xhi, ylo, yhi, x, y;
+        int k;
+        xlo = ylo = INFINITY;
+        xhi = yhi = -INFINITY;
+        for (k = 0; k < 4; k++)
         {
-            if (RCU(k, 1) < m_r && RCU(k, 0) < m_c && msk(RCU(k, 1), RCU(k, 0)))
-                msk_score++;
+            x = box[2 * (k & 1)];
+            y = box[1 + 2 * (k >> 1)];
+            xlo = std::min(xlo, a * x - b * y + c0);
+            xhi = std::max(xhi, a * x - b * y + c0);
+            ylo = std::min(ylo, b * x + a * y + c1);
+            yhi = std::max(yhi, b * x + a * y + c1);
         }
-        msk_score /= rot_con.rows();
-        return msk_score;
+        // the pixels the points can fall on, with a margin of one pixel for
+        // rounding (a point (x, y) falls on pixel (int(y), int(x)))
+        xlo = std::floor(xlo) - 1, xhi = std::floor(xhi) + 1;
+        ylo = std::floor(ylo) - 1, yhi = std::floor(yhi) + 1;
+        if (!(xlo <= xhi && ylo <= yhi)) return false;  // NaNs
+
+        if (xlo >= 0 && ylo >= 0 && xhi < m_c && yhi < m_r)
+        {
+            const u64 row0 = ylo, col0 = xlo, row1 = yhi, col1 = xhi;
+            const u64 count = box_count(row0, col0, row1, col1);
+            // every point falls on the mask
+            if (count == (row1 - row0 + 1) * (col1 - col0 + 1))
+            {
+                result = true;
+                return true;
+            }
+            // no point falls on the mask
+            if (count == 0)
+            {
+                result = zero_pass;
+                return true;
+            }
+            return false;
+        }
+
+        // the part of the box that is inside the image
+        xlo = std::max(xlo, 0.0), ylo = std::max(ylo, 0.0);
+        xhi = std::min(xhi, m_c - 1.0), yhi = std::min(yhi, m_r - 1.0);
+        if (xlo > xhi || ylo > yhi || box_count(ylo, xlo, yhi, xhi) == 0)
+        {
+            result = zero_pass;
+            return true;
+        }
+        return false;
+    }
+
+    bool maskFilter::check(const Eigen::Ref<DoubleMatrixR>& M1, const u64 i1,
+                           const u64 j1, const Eigen::Ref<DoubleMatrixR>& M2,
+                           const u64 i2, const u64 j2) const
+    {
+        const double x1 = M2(i2, 0), y1 = M2(i2, 1), x2 = M2(j2, 0), y2 = M2(j2, 1);
+        const double x3 = M1(i1, 0), y3 = M1(i1, 1), x4 = M1(j1, 0), y4 = M1(j1, 1);
+        const double dx = x1 - x2, dy = y1 - y2, ex = x3 - x4, ey = y3 - y4;
+        // (the score is zero if the two points coincide)
+        if (dx == 0 && dy == 0) return zero_pass;
+        if (need > n_ctrl) return false;
+
+        // the transform (x, y) -> (a x - b y + c0, b x + a y + c1) is a complex
+        // multiplication by a + ib plus c0 + ic1, so (a + ib) = (e / d)
+        const double den = dx * dx + dy * dy;
+        const double a = (ex * dx + ey * dy) / den, b = (ey * dx - ex * dy) / den;
+        const double c0 = x3 - (a * x1 - b * y1), c1 = y3 - (b * x1 + a * y1);
+
+        bool result;
+        if (!area.empty() && box_check(a, b, c0, c1, result)) return result;
+
+        const u64 B = 64;
+        double tx[B], ty[B];
+        u64 k, start, len, hits = 0;
+        const double mc = m_c, mr = m_r;
+        for (start = 0; start < n_ctrl; start += B)
+        {
+            len = std::min(B, n_ctrl - start);
+            const double* px = cx.data() + start;
+            const double* py = cy.data() + start;
+            for (k = 0; k < len; k++)
+            {
+                tx[k] = a * px[k] - b * py[k] + c0;
+                ty[k] = b * px[k] + a * py[k] + c1;
+            }
+            // (int(x) is 0 for x in (-1, 0), so those points are also checked)
+            for (k = 0; k < len; k++)
+            {
+                if (tx[k] > -1 && ty[k] > -1 && tx[k] < mc && ty[k] < mr &&
+                    mask(static_cast<u64>(ty[k] < 0 ? 0 : ty[k]),
+                         static_cast<u64>(tx[k] < 0 ? 0 : tx[k])))
+                    hits++;
+            }
+            // stop once the result is known
+            if (hits >= need) return true;
+            if (hits + (n_ctrl - start - len) < need) return false;
+        }
+        return hits >= need;
     }
 
     bool build_edges_with_filter(pygraph& pg, const Eigen::Ref<DoubleMatrixR>& pts1,
@@ -59,28 +164,30 @@ namespace ext
                                  const Eigen::Ref<BoolMatrixR> mask,
                                  const double percentage)
     {
-        Eigen::RowVector2d _c;
-        DoubleMatrixR _rot_con(control_pts.rows(), control_pts.cols());
-        ULongMatrixR _RCU(control_pts.rows(), control_pts.cols());
+        // the filter does not call into Python, so the edges are built on
+        // all cores
+        const maskFilter filter(control_pts, mask, percentage);
+        auto rule_func = [&pts1, &pts2, &filter](const u64 i1, const u64 j1,
+                                                 const u64 i2, const u64 j2) -> bool
+        { return filter.check(pts1, i1, j1, pts2, i2, j2); };
 
-        auto rule_func = [&control_pts, &mask, &_c, &_rot_con, &_RCU, &percentage](
-                             const Eigen::Ref<DoubleMatrixR>& p1, const u64 i1,
-                             const u64 j1, const Eigen::Ref<DoubleMatrixR>& p2,
-                             const u64 i2, const u64 j2) -> bool
-        {
-            return filter_score(control_pts, mask, _c, _rot_con, _RCU, p1, i1, j1, p2,
-                                i2, j2) >= percentage;
-        };
-        return build_edges<Eigen::Ref<DoubleMatrixR>, Eigen::Ref<DoubleMatrixR>, double,
-                           double, double>(pg, pts1, pts1_len, pts2, pts2_len, epsilon,
-                                           rule_func);
+        // (relset keeps a reference to the distance function)
+        std::function<double(const Eigen::Ref<DoubleMatrixR>&, const u64, const u64)>
+            d = dummy_comparison<Eigen::Ref<DoubleMatrixR>, double>;
+        relset<Eigen::Ref<DoubleMatrixR>, double> ps1(pts1_len, d, true);
+        relset<Eigen::Ref<DoubleMatrixR>, double> ps2(pts2_len, d, true);
+        ps1.fill_dists(pts1);
+        ps2.fill_dists(pts2);
+        pg.load_graph(efr_condition(ps1, ps2, epsilon, rule_func, 0));
+        return true;
     }
 }  // namespace ext
 
 void init_Aligngraph(pybind11::module& mm)
 {
     using namespace pybind11;
-    mm.def("_build_edges_with_filter", &ext::build_edges_with_filter);
+    mm.def("_build_edges_with_filter", &ext::build_edges_with_filter,
+           call_guard<gil_scoped_release>());
 }
 
 }  // namespace cliquematch
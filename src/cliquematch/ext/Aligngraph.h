@@ -2,11 +2,54 @@
 #define ALIGNGRAPH_H
 
 #include <ext/A2Agraph.h>
+#include <vector>
 
 namespace cliquematch
 {
 namespace ext
 {
+    /*
+     * maskFilter is the condition used by build_edges_with_filter: the
+     * similarity transform that maps two points of pts2 onto two points of
+     * pts1 must also map at least percentage of the control points into the
+     * mask (the transformed points are in (x, y) i.e. (col, row) order).
+     *
+     * The transform is solved in closed form, and the control points are
+     * transformed in blocks that the compiler can vectorize; the check stops
+     * once enough points have fallen inside (or outside) the mask. A
+     * summed-area table of the mask decides some transforms without
+     * looking at the control points: when the bounding box of the
+     * transformed points lies entirely on the mask, or entirely off it.
+     *
+     * check() does not modify the filter, so it can be called from many threads.
+     */
+    class maskFilter
+    {
+       private:
+        u64 n_ctrl, m_r, m_c;
+        Eigen::VectorXd cx, cy;  // control points, one vector per coordinate
+        double box[4];           // bounding box of the control points
+        BoolMatrixR mask;
+        // summed-area table of the mask, (m_r + 1) x (m_c + 1), or empty if
+        // the mask is too large for u32 counts
+        std::vector<u32> area;
+        // number of control points to be mapped into the mask, and whether a
+        // score of zero is enough (e.g. if percentage <= 0)
+        u64 need;
+        bool zero_pass;
+
+        u64 box_count(const u64 r0, const u64 c0, const u64 r1, const u64 c1) const;
+        bool box_check(const double a, const double b, const double c0,
+                       const double c1, bool& result) const;
+
+       public:
+        maskFilter(const Eigen::Ref<DoubleMatrixR>& control_pts,
+                   const Eigen::Ref<BoolMatrixR>& mask, const double percentage);
+        bool check(const Eigen::Ref<DoubleMatrixR>& M1, const u64 i1, const u64 j1,
+                   const Eigen::Ref<DoubleMatrixR>& M2, const u64 i2,
+                   const u64 j2) const;
+    };
+
     bool build_edges_with_filter(pygraph& pg, const Eigen::Ref<DoubleMatrixR>& pts1,
                                  const u64 pts1_len,
                                  const Eigen::Ref<DoubleMatrixR>& pts2,
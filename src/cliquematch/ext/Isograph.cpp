@@ -1,4 +1,5 @@
 #include <ext/Isograph.h>
+#include <pybind11/stl.h>
 
 namespace cliquematch
 {
@@ -6,15 +7,30 @@ namespace ext
 {
     bool build_edges_for_iso(pygraph& pg, const pygraph& s1, const pygraph& s2)
     {
-        u64 no_of_vertices, no_of_edges;
         if (s1.nvert == 0 || s2.nvert == 0)
             throw CM_ERROR("One of the inputs is an empty graph");
 
-        auto edges = iso_edges(no_of_vertices, no_of_edges, s1, s2);
+        pg.load_graph(iso_edges(s1, s2));
 
-        if (edges.first.size() == 0 || edges.second.size() == 0)
-            throw CM_ERROR("Could not extract edges");
-        pg.load_graph(no_of_vertices, no_of_edges, std::move(edges));
+        return true;
+    }
+
+    bool build_edges_for_iso_filtered(pygraph& pg, const pygraph& s1, const pygraph& s2,
+                                      const bool use_degree,
+                                      const std::vector<u64>& labels1,
+                                      const std::vector<u64>& labels2)
+    {
+        if (s1.nvert == 0 || s2.nvert == 0)
+            throw CM_ERROR("One of the inputs is an empty graph");
+        if (labels1.size() != (labels2.empty() ? 0 : s1.nvert) ||
+            labels2.size() != (labels1.empty() ? 0 : s2.nvert))
+            throw CM_ERROR("Labels must be given for all the vertices of both graphs");
+
+        std::vector<u64> vmap;
+        detail::csrBuilder edges =
+            iso_edges(s1, s2, use_degree, labels1, labels2, vmap);
+        if (vmap.empty()) throw CM_ERROR("No vertices of g2 can be matched to g1");
+        pg.load_graph(std::move(edges), std::move(vmap));
 
         return true;
     }
@@ -23,6 +39,9 @@ void init_Isograph(pybind11::module& mm)
 {
     using namespace pybind11;
     mm.def("_build_edges", &ext::build_edges_for_iso, "G"_a.none(false),
-           "g1"_a.none(false), "g2"_a.none(false));
+           "g1"_a.none(false), "g2"_a.none(false), call_guard<gil_scoped_release>());
+    mm.def("_build_edges", &ext::build_edges_for_iso_filtered, "G"_a.none(false),
+           "g1"_a.none(false), "g2"_a.none(false), "use_degree"_a, "labels1"_a,
+           "labels2"_a, call_guard<gil_scoped_release>());
 }
 }  // namespace cliquematch
@@ -8,6 +8,10 @@ namespace cliquematch
 namespace ext
 {
     bool build_edges_for_iso(pygraph&, const pygraph&, const pygraph&);
+    // keeps only the pairs of vertices allowed by degree and labels
+    bool build_edges_for_iso_filtered(pygraph&, const pygraph&, const pygraph&,
+                                      const bool, const std::vector<u64>&,
+                                      const std::vector<u64>&);
 }  // namespace ext
 }  // namespace cliquematch
 #endif /* ISOGRAPH_H */
@@ -0,0 +1,119 @@
+#ifndef KDTREE_HPP
+#define KDTREE_HPP
+
+// A k-d tree over the rows of a matrix, to find the points within a given
+// (Euclidean) distance of each point, without comparing all pairs of points
+#include <detail/utils.h>
+#include <ext/eigen_wrap.h>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace cliquematch
+{
+namespace ext
+{
+    class kdTree
+    {
+       private:
+        struct node
+        {
+            u64 begin, end;  // the points of the node are index[begin..end)
+            u64 dim;         // points of left have pts(., dim) <= split,
+            double split;    // and points of right have pts(., dim) >= split
+            u64 left, right;  // 0 for a leaf (node 0 is the root)
+        };
+
+        DoubleMatrixR pts;
+        std::vector<u64> index;
+        std::vector<node> nodes;
+
+        u64 build(const u64 begin, const u64 end)
+        {
+            u64 k, dim = 0, mid, cur = nodes.size();
+            nodes.push_back(node{begin, end, 0, 0, 0, 0});
+            if (end - begin <= 16) return cur;
+
+            // split at the median of the widest dimension
+            double width = -1, lo, hi, x;
+            for (k = 0; k < static_cast<u64>(pts.cols()); k++)
+            {
+                lo = hi = pts(index[begin], k);
+                for (mid = begin; mid < end; mid++)
+                {
+                    x = pts(index[mid], k);
+                    lo = std::min(lo, x);
+                    hi = std::max(hi, x);
+                }
+                if (hi - lo > width)
+                {
+                    width = hi - lo;
+                    dim = k;
+                }
+            }
+            mid = begin + (end - begin) / 2;
+            std::nth_element(index.begin() + begin, index.begin() + mid,
+                             index.begin() + end, [this, dim](u64 a, u64 b)
+                             { return pts(a, dim) < pts(b, dim); });
+
+            nodes[cur].dim = dim;
+            nodes[cur].split = pts(index[mid], dim);
+            const u64 left = build(begin, mid);
+            const u64 right = build(mid, end);
+            nodes[cur].left = left;
+            nodes[cur].right = right;
+            return cur;
+        }
+
+       public:
+        explicit kdTree(const DoubleMatrixR& x) : pts(x), index(x.rows())
+        {
+            for (u64 i = 0; i < index.size(); i++) index[i] = i;
+            if (!index.empty()) build(0, index.size());
+        }
+
+        // the distance between points i and j, computed in the same order as
+        // the bulk Euclidean distances in A2Agraph.cpp
+        double dist(const u64 i, const u64 j) const
+        {
+            double t = pts(j, 0) - pts(i, 0), s = t * t;
+            for (u64 k = 1; k < static_cast<u64>(pts.cols()); k++)
+            {
+                t = pts(j, k) - pts(i, k);
+                s += t * t;
+            }
+            return std::sqrt(s);
+        }
+
+        // call func(j, dist(i, j)) for every point j (including i itself)
+        // with dist(i, j) <= radius
+        template <typename Func>
+        void within(const u64 i, const double radius, Func func) const
+        {
+            if (nodes.empty()) return;
+            // (a little extra, so rounding does not prune any points)
+            const double reach = radius + 1e-9 * std::fabs(radius);
+            u64 stack[128], top = 0, k;
+            double d;
+            stack[top++] = 0;
+            while (top > 0)
+            {
+                const node& cur = nodes[stack[--top]];
+                if (cur.left == 0)
+                {
+                    for (k = cur.begin; k < cur.end; k++)
+                    {
+                        d = dist(i, index[k]);
+                        if (d <= radius) func(index[k], d);
+                    }
+                    continue;
+                }
+                const double x = pts(i, cur.dim);
+                if (x + reach >= cur.split) stack[top++] = cur.right;
+                if (x - reach <= cur.split) stack[top++] = cur.left;
+            }
+        }
+    };
+}  // namespace ext
+}  // namespace cliquematch
+#endif /* KDTREE_HPP */
@@ -11,6 +11,7 @@ namespace cliquematch
 namespace ext
 {
     using cliquematch::core::pygraph;
+    using cliquematch::detail::csrBuilder;
     namespace py = pybind11;
 
     template <typename List, typename Delta>
@@ -27,12 +28,14 @@ namespace ext
      *  | d1(s1[i], s1[j]) - d2(s2[i'], s2[j']) | < epsilon
      *  where d1 is a distance metric to relate elements of s1
      *  and   d2 is a distance metric to relate elements of s2
+     *
+     * (n_threads = 0 uses all available cores)
      */
     template <typename List1, typename List2, typename Delta1 = double,
               typename Delta2 = Delta1, typename EpsType = Delta1>
-    std::pair<std::vector<u64>, std::vector<u64>> edges_from_relsets(
-        u64& nvert, u64& nedges, const relset<List1, Delta1>&,
-        const relset<List2, Delta2>&, const EpsType epsilon);
+    csrBuilder edges_from_relsets(const relset<List1, Delta1>&,
+                                  const relset<List2, Delta2>&, const EpsType epsilon,
+                                  u64 n_threads = 0);
 
     /*
      * A more flexible version of the above function,
@@ -48,13 +51,16 @@ namespace ext
      * cfunc(i,j,i',j') => true
      * (cfunc internally accesses s1 and s2)
      *
+     * cfunc is called from n_threads threads, so n_threads != 1 only if cfunc
+     * is thread-safe and does not call into Python (0 uses all available cores)
      */
     template <typename List1, typename List2, typename Delta1 = double,
               typename Delta2 = Delta1, typename EpsType = Delta1>
-    std::pair<std::vector<u64>, std::vector<u64>> efr_condition(
-        u64& nvert, u64& nedges, const relset<List1, Delta1>&,
-        const relset<List2, Delta2>&, const EpsType epsilon,
-        const std::function<bool(const u64, const u64, const u64, const u64)> cfunc);
+    csrBuilder efr_condition(
+        const relset<List1, Delta1>&, const relset<List2, Delta2>&,
+        const EpsType epsilon,
+        const std::function<bool(const u64, const u64, const u64, const u64)> cfunc,
+        u64 n_threads = 1);
 
     template <typename List1, typename List2, typename Delta1 = double,
               typename Delta2 = Delta1, typename EpsType = Delta1>
@@ -64,6 +70,28 @@ namespace ext
         const std::function<bool(const List1&, const u64, const u64, const List2&,
                                  const u64, const u64)>
             cfunc);
+
+    /*
+     * build_edges_condition_only calls cfunc on all O(M^2 N^2) pairs of pairs,
+     * so the version below takes a cheap key for each pair of elements, and
+     * calls cfunc only if:
+     *  | key1(s1, i1, i2) - key2(s2, j1, j2) | <= tolerance
+     * (for i1 < i2, j1 < j2). The keys are stored and sorted in relsets, so
+     * the pairs of pairs to check are found by a sweep over both of them. The
+     * graph is the same as that of build_edges_condition_only if the keys are
+     * a necessary condition for cfunc.
+     */
+    template <typename List1, typename List2, typename Delta1 = double,
+              typename Delta2 = Delta1, typename EpsType = Delta1>
+    bool build_edges_condition_keyed(
+        pygraph& pg, const List1& pts1, const u64 pts1_len, const List2& pts2,
+        const u64 pts2_len,
+        const std::function<bool(const List1&, const u64, const u64, const List2&,
+                                 const u64, const u64)>
+            cfunc,
+        const std::function<Delta1(const List1&, const u64, const u64)> key1,
+        const std::function<Delta2(const List2&, const u64, const u64)> key2,
+        const EpsType tolerance);
     // overloads are defined as such because default arguments to pybind11
     // does not allow dummy_comparison<List, Delta>
     template <typename List1, typename List2, typename Delta1 = double,
@@ -92,6 +120,67 @@ namespace ext
         const std::function<Delta2(const List2&, const u64, const u64)> d2 =
             dummy_comparison<List2, Delta2>,
         const bool is_d2_symmetric = true);
+
+    /*
+     * build_edges_metric_only with only the pairs of s1 that are at most
+     * max_dist apart (and the pairs of s2 at most max_dist + epsilon apart,
+     * which are the only ones they can match). The relsets never hold the
+     * other pairs, so the memory grows with the number of close pairs
+     * instead of with M^2 and N^2.
+     */
+    template <typename List1, typename List2, typename Delta1 = double,
+              typename Delta2 = Delta1, typename EpsType = Delta1>
+    bool build_edges_metric_within(
+        pygraph& pg, const List1& pts1, const u64 pts1_len, const List2& pts2,
+        const u64 pts2_len, const EpsType epsilon, const Delta1 max_dist,
+        const std::function<Delta1(const List1&, const u64, const u64)> d1 =
+            dummy_comparison<List1, Delta1>,
+        const bool is_d1_symmetric = true,
+        const std::function<Delta2(const List2&, const u64, const u64)> d2 =
+            dummy_comparison<List2, Delta2>,
+        const bool is_d2_symmetric = true);
+
+    /*
+     * Calling a Python function once per pair (or pair of pairs) is slow, so the
+     * functions below call batched versions of cfunc, d1 and d2 instead, with
+     * batch_size pairs at a time. A batched function takes vectors of indices,
+     * and fills a vector with the result for each position.
+     *
+     * An empty d1 or d2 falls back to dummy_comparison, and an empty cfunc
+     * builds edges with only the distance metrics.
+     */
+    template <typename List1, typename List2>
+    using batch_cfunc = std::function<void(
+        const List1&, const std::vector<u64>&, const std::vector<u64>&, const List2&,
+        const std::vector<u64>&, const std::vector<u64>&, std::vector<bool>&)>;
+
+    template <typename List1, typename List2, typename Delta1 = double,
+              typename Delta2 = Delta1, typename EpsType = Delta1>
+    bool build_edges_condition_only_batched(pygraph& pg, const List1& pts1,
+                                            const u64 pts1_len, const List2& pts2,
+                                            const u64 pts2_len,
+                                            const batch_cfunc<List1, List2>& bcfunc,
+                                            const u64 batch_size);
+
+    template <typename List1, typename List2, typename Delta1 = double,
+              typename Delta2 = Delta1, typename EpsType = Delta1>
+    bool build_edges_condition_keyed_batched(
+        pygraph& pg, const List1& pts1, const u64 pts1_len, const List2& pts2,
+        const u64 pts2_len, const batch_cfunc<List1, List2>& bcfunc,
+        const batch_delfunc<List1, Delta1>& bkey1,
+        const batch_delfunc<List2, Delta2>& bkey2, const EpsType tolerance,
+        const u64 batch_size);
+
+    template <typename List1, typename List2, typename Delta1 = double,
+              typename Delta2 = Delta1, typename EpsType = Delta1>
+    bool build_edges_batched(pygraph& pg, const List1& pts1, const u64 pts1_len,
+                             const List2& pts2, const u64 pts2_len,
+                             const EpsType epsilon,
+                             const batch_cfunc<List1, List2>& bcfunc,
+                             const batch_delfunc<List1, Delta1>& bd1,
+                             const bool is_d1_symmetric,
+                             const batch_delfunc<List2, Delta2>& bd2,
+                             const bool is_d2_symmetric, const u64 batch_size);
 }  // namespace ext
 
 }  // namespace cliquematch
@@ -10,156 +10,180 @@ namespace ext
     // template syntax brain hurty
     namespace py = pybind11;
 
-    template <typename List1, typename List2, typename Delta1, typename Delta2,
-              typename EpsType>
-    std::pair<std::vector<u64>, std::vector<u64>> edges_from_relsets(
-        u64& n_vert, u64& n_edges, const relset<List1, Delta1>& s1,
-        const relset<List2, Delta2>& s2, const EpsType epsilon)
+    /*
+     * Both functions below go through the distances twice: once to count the
+     * neighbors of each vertex, and once to fill them into the csrBuilder (see
+     * csrbuilder.h). The binary searches are cheap compared to storing each
+     * edge twice in a pair<vector>, and the results of cfunc (which may be a
+     * slow Python function) are remembered from the first pass, as one bit per
+     * call.
+     *
+     * The distances of s1 are split into blocks, and each pass processes the
+     * blocks on n_threads threads (0 uses all cores). csrBuilder updates its
+     * lists atomically, so the threads add their edges without any locks.
+     */
+
+    // number of blocks of s1.dists to process on n_threads threads
+    inline u64 relset_blocks(u64& n_threads, const u64 len1, const u64 len2)
     {
-        u64 M = s1.N, N = s2.N;
-        u64 i, j;
-        n_vert = M * N;
-        n_edges = 0;
-
-        if (M == 0 || N == 0)
-            throw CM_ERROR("One of the sets is empty (initialization error)\n");
-
-        std::pair<std::vector<u64>, std::vector<u64>> Edges;
-        Edges.first.resize(n_vert + 1);
-        Edges.second.resize(n_vert + 1);
-        for (i = 0; i < Edges.first.size(); i++)
-        {
-            Edges.first[i] = i;
-            Edges.second[i] = i;
-        }
-        u64 v1, v2;
-
-        auto base = s2.dists.data();
-        u64 len1 = s1.symmetric ? M * (M - 1) / 2 : M * (M - 1);
-        u64 len2 = s2.symmetric ? N * (N - 1) / 2 : N * (N - 1);
+        // len1 * len2 bounds the work, which depends on epsilon
+        n_threads = detail::resolve_threads(n_threads, len1 * len2);
+        return (n_threads == 1) ? 1 : 8 * n_threads;
+    }
 
+    // call func(i, lb, ub) for i in [i, i_end), where s2.dists[lb..ub] (inclusive)
+    // are the distances within epsilon of s1.dists[i]
+    template <typename Delta1, typename Delta2, typename EpsType, typename Func>
+    void match_ranges(const std::vector<pair_dist<Delta1>>& d1,
+                      const std::vector<pair_dist<Delta2>>& d2, const EpsType epsilon,
+                      u64 i, const u64 i_end, Func func)
+    {
+        const u64 len2 = d2.size();
         EpsType cur_ub = 0, cur_lb = 0;
         u64 ub_loc = len2, lb_loc = 0;
-
         short found1, found2;
+        if (len2 == 0) return;
 
-        for (i = 0; i < len1; i++)
+        for (; i < i_end; i++)
         {
-            cur_lb = s1.dists[i].dist - epsilon;
+            cur_lb = d1[i].dist - epsilon;
             cur_ub = cur_lb + 2 * epsilon;
 
-            found1 = binary_find2(base, len2, cur_lb, lb_loc);
+            found1 = binary_find2(d2.data(), len2, cur_lb, lb_loc);
             if (found1 == -1) break;
-            found2 = binary_find2(base, len2, cur_ub, ub_loc);
+            found2 = binary_find2(d2.data(), len2, cur_ub, ub_loc);
             if (found2 == -1) ub_loc = len2 - 1;
 
-            for (j = lb_loc; j <= ub_loc; j++)
-            {
-                // if d(i,j) approx= d(i',j') then edge between (i,i') and (j,j')
-                v1 = s1.dists[i].first * N + s2.dists[j].first + 1;
-                v2 = s1.dists[i].second * N + s2.dists[j].second + 1;
-
-                Edges.first.push_back(v1);
-                Edges.second.push_back(v2);
-                Edges.first.push_back(v2);
-                Edges.second.push_back(v1);
-                n_edges++;
-
-                if (!s1.symmetric && !s2.symmetric) continue;
-                // if d(i,j) approx= d(i',j') then edge between (i,j') and (j,i')
-                v1 = s1.dists[i].second * N + s2.dists[j].first + 1;
-                v2 = s1.dists[i].first * N + s2.dists[j].second + 1;
-
-                Edges.first.push_back(v1);
-                Edges.second.push_back(v2);
-                Edges.first.push_back(v2);
-                Edges.second.push_back(v1);
-                n_edges++;
-            }
+            func(i, lb_loc, ub_loc);
         }
-
-        return Edges;
     }
 
     template <typename List1, typename List2, typename Delta1, typename Delta2,
               typename EpsType>
-    std::pair<std::vector<u64>, std::vector<u64>> efr_condition(
-        u64& n_vert, u64& n_edges, const relset<List1, Delta1>& s1,
-        const relset<List2, Delta2>& s2, const EpsType epsilon,
-        const std::function<bool(const u64, const u64, const u64, const u64)> cfunc)
+    csrBuilder edges_from_relsets(const relset<List1, Delta1>& s1,
+                                  const relset<List2, Delta2>& s2,
+                                  const EpsType epsilon, u64 n_threads)
     {
         u64 M = s1.N, N = s2.N;
-        u64 i, j;
-        n_vert = M * N;
-        n_edges = 0;
 
         if (M == 0 || N == 0)
             throw CM_ERROR("One of the sets is empty (initialization error)\n");
 
-        std::pair<std::vector<u64>, std::vector<u64>> Edges;
-        Edges.first.resize(n_vert + 1);
-        Edges.second.resize(n_vert + 1);
-        for (i = 0; i < Edges.first.size(); i++)
+        csrBuilder edges(M * N);
+        const u64 len1 = s1.dists.size(), len2 = s2.dists.size();
+        const u64 n_blocks = relset_blocks(n_threads, len1, len2);
+
+        for (int pass = 0; pass < 2; pass++)
         {
-            Edges.first[i] = i;
-            Edges.second[i] = i;
+            auto link = [&edges, pass](u64 a, u64 b)
+            { pass == 0 ? (void)edges.count(a, b) : edges.add(a, b); };
+            auto add_range = [&](u64 i, u64 lb, u64 ub)
+            {
+                for (u64 j = lb; j <= ub; j++)
+                {
+                    // if d(i,j) approx= d(i',j') then edge between (i,i') and (j,j')
+                    link(s1.dists[i].first * N + s2.dists[j].first + 1,
+                         s1.dists[i].second * N + s2.dists[j].second + 1);
+
+                    if (!s1.symmetric && !s2.symmetric) continue;
+                    // if d(i,j) approx= d(i',j') then edge between (i,j') and (j,i')
+                    link(s1.dists[i].second * N + s2.dists[j].first + 1,
+                         s1.dists[i].first * N + s2.dists[j].second + 1);
+                }
+            };
+
+            detail::parallel_for(n_threads, n_blocks,
+                                 [&](u64 b)
+                                 {
+                                     match_ranges(s1.dists, s2.dists, epsilon,
+                                                  b * len1 / n_blocks,
+                                                  (b + 1) * len1 / n_blocks, add_range);
+                                 });
+            if (pass == 0) edges.start_fill();
         }
-        u64 v1, v2;
-
-        auto base = s2.dists.data();
-        u64 len1 = s1.symmetric ? M * (M - 1) / 2 : M * (M - 1);
-        u64 len2 = s2.symmetric ? N * (N - 1) / 2 : N * (N - 1);
 
-        EpsType cur_ub = 0, cur_lb = 0;
-        u64 ub_loc = len2, lb_loc = 0;
+        return edges;
+    }
 
-        short found1, found2;
+    template <typename List1, typename List2, typename Delta1, typename Delta2,
+              typename EpsType>
+    csrBuilder efr_condition(
+        const relset<List1, Delta1>& s1, const relset<List2, Delta2>& s2,
+        const EpsType epsilon,
+        const std::function<bool(const u64, const u64, const u64, const u64)> cfunc,
+        u64 n_threads)
+    {
+        u64 M = s1.N, N = s2.N;
 
-        for (i = 0; i < len1; i++)
-        {
-            cur_lb = s1.dists[i].dist - epsilon;
-            cur_ub = cur_lb + 2 * epsilon;
+        if (M == 0 || N == 0)
+            throw CM_ERROR("One of the sets is empty (initialization error)\n");
 
-            found1 = binary_find2(base, len2, cur_lb, lb_loc);
-            if (found1 == -1) break;
-            found2 = binary_find2(base, len2, cur_ub, ub_loc);
-            if (found2 == -1) ub_loc = len2 - 1;
+        csrBuilder edges(M * N);
+        const u64 len1 = s1.dists.size(), len2 = s2.dists.size();
+        const u64 n_blocks = relset_blocks(n_threads, len1, len2);
+        // results of cfunc from the first pass, for each block
+        std::vector<std::vector<bool>> valid(n_blocks);
+        // cfunc is called once per pair of distances, or twice if there is an
+        // alternate mapping (i.e. if either s1 or s2 is symmetric)
+        const u64 n_mappings = (s1.symmetric || s2.symmetric) ? 2 : 1;
 
-            for (j = lb_loc; j <= ub_loc; j++)
-            {
-                // if d(i,j) approx= d(i',j') then edge between (i,i') and (j,j')
-                v1 = s1.dists[i].first * N + s2.dists[j].first + 1;
-                v2 = s1.dists[i].second * N + s2.dists[j].second + 1;
+        for (int pass = 0; pass < 2; pass++)
+        {
+            auto link = [&edges, pass](u64 a, u64 b)
+            { pass == 0 ? (void)edges.count(a, b) : edges.add(a, b); };
 
-                if (cfunc(s1.dists[i].first, s1.dists[i].second, s2.dists[j].first,
-                          s2.dists[j].second))
+            detail::parallel_for(
+                n_threads, n_blocks,
+                [&](u64 blk)
                 {
-                    Edges.first.push_back(v1);
-                    Edges.second.push_back(v2);
-                    Edges.first.push_back(v2);
-                    Edges.second.push_back(v1);
-                    n_edges++;
-                }
-
-                if (!s1.symmetric && !s2.symmetric) continue;
-                // if d(i,j) approx= d(i',j') then edge between (i,j') and (j,i')
-                v1 = s1.dists[i].second * N + s2.dists[j].first + 1;
-                v2 = s1.dists[i].first * N + s2.dists[j].second + 1;
+                    const u64 i_begin = blk * len1 / n_blocks;
+                    const u64 i_end = (blk + 1) * len1 / n_blocks;
+                    u64 k = 0;
+                    // the number of calls is known from the ranges, so the
+                    // results are stored without regrowing the vector
+                    if (pass == 0)
+                    {
+                        match_ranges(s1.dists, s2.dists, epsilon, i_begin, i_end,
+                                     [&k](u64, u64 lb, u64 ub) { k += ub - lb + 1; });
+                        valid[blk].resize(k * n_mappings);
+                        k = 0;
+                    }
 
-                // if either s1 or s2 is symmetric, the alternate mapping is valid
-                if (cfunc(s1.dists[i].first, s1.dists[i].second, s2.dists[j].second,
-                          s2.dists[j].first))
-                {
-                    Edges.first.push_back(v1);
-                    Edges.second.push_back(v2);
-                    Edges.first.push_back(v2);
-                    Edges.second.push_back(v1);
-                    n_edges++;
-                }
-            }
+                    // in the first pass, call cfunc, and count the edges it accepts;
+                    // in the second pass, fill the edges accepted in the first pass
+                    auto check = [&valid, &k, &cfunc, blk, pass](u64 a, u64 b, u64 a2,
+                                                                u64 b2) -> bool
+                    {
+                        if (pass == 0) valid[blk][k] = cfunc(a, b, a2, b2);
+                        return valid[blk][k++];
+                    };
+                    auto add_range = [&](u64 i, u64 lb, u64 ub)
+                    {
+                        for (u64 j = lb; j <= ub; j++)
+                        {
+                            // if d(i,j) approx= d(i',j') then edge between (i,i')
+                            // and (j,j')
+                            if (check(s1.dists[i].first, s1.dists[i].second,
+                                      s2.dists[j].first, s2.dists[j].second))
+                                link(s1.dists[i].first * N + s2.dists[j].first + 1,
+                                     s1.dists[i].second * N + s2.dists[j].second + 1);
+
+                            if (n_mappings == 1) continue;
+                            // if d(i,j) approx= d(i',j') then edge between (i,j')
+                            // and (j,i')
+                            if (check(s1.dists[i].first, s1.dists[i].second,
+                                      s2.dists[j].second, s2.dists[j].first))
+                                link(s1.dists[i].second * N + s2.dists[j].first + 1,
+                                     s1.dists[i].first * N + s2.dists[j].second + 1);
+                        }
+                    };
+                    match_ranges(s1.dists, s2.dists, epsilon, i_begin, i_end,
+                                 add_range);
+                });
+            if (pass == 0) edges.start_fill();
         }
 
-        return Edges;
+        return edges;
     }
 
     template <typename List1, typename List2, typename Delta1, typename Delta2,
@@ -172,73 +196,170 @@ namespace ext
         const std::function<Delta2(const List2&, const u64, const u64)> d2,
         const bool is_d2_symmetric)
     {
-        u64 no_of_vertices, no_of_edges;
         relset<List1, Delta1> ps1(pts1_len, d1, is_d1_symmetric);
         relset<List2, Delta2> ps2(pts2_len, d2, is_d2_symmetric);
         ps1.fill_dists(pts1);
         ps2.fill_dists(pts2);
-        auto edges = edges_from_relsets(no_of_vertices, no_of_edges, ps1, ps2, epsilon);
-        if (edges.first.size() == 0 || edges.second.size() == 0)
-            throw CM_ERROR("Could not extract edges");
-        pg.load_graph(no_of_vertices, no_of_edges, std::move(edges));
+        pg.load_graph(edges_from_relsets(ps1, ps2, epsilon));
         return true;
     }
 
-    template <typename List1, typename List2, typename Delta1, typename Delta2,
-              typename EpsType>
-    bool build_edges_condition_only(
-        pygraph& pg, const List1& pts1, const u64 pts1_len, const List2& pts2,
-        const u64 pts2_len,
-        const std::function<bool(const List1&, const u64, const u64, const List2&,
-                                 const u64, const u64)>
-            cfunc)
+    // the edges accepted by cfunc for build_edges_condition_only: valid has the
+    // result of cfunc for each pair of pairs (i1 < i2, j1 < j2), in the order of
+    // the loops below
+    inline csrBuilder condition_edges(const u64 pts1_len, const u64 pts2_len,
+                                      const std::vector<bool>& valid)
     {
-        u64 no_of_vertices = pts1_len * pts2_len, no_of_edges = 0;
-        u64 i1, i2, j1, j2, v1, v2;
-        std::pair<std::vector<u64>, std::vector<u64>> edges;
-        edges.first.resize(no_of_vertices + 1);
-        edges.second.resize(no_of_vertices + 1);
-
-        for (v1 = 0; v1 < edges.first.size(); v1++)
-        {
-            edges.first[v1] = v1;
-            edges.second[v1] = v1;
-        }
+        u64 i1, i2, j1, j2, v1, v2, k;
+        csrBuilder edges(pts1_len * pts2_len);
 
-        for (i1 = 0; i1 < pts1_len; ++i1)
+        for (int pass = 0; pass < 2; pass++)
         {
-            for (i2 = i1 + 1; i2 < pts1_len; ++i2)
+            k = 0;
+            for (i1 = 0; i1 < pts1_len; ++i1)
             {
-                for (j1 = 0; j1 < pts2_len; ++j1)
+                for (i2 = i1 + 1; i2 < pts1_len; ++i2)
                 {
-                    for (j2 = j1 + 1; j2 < pts2_len; ++j2)
+                    for (j1 = 0; j1 < pts2_len; ++j1)
                     {
-                        if (cfunc(pts1, i1, i2, pts2, j1, j2))
+                        for (j2 = j1 + 1; j2 < pts2_len; ++j2)
                         {
+                            if (!valid[k++]) continue;
+
                             v1 = i1 * pts2_len + j1 + 1;
                             v2 = i2 * pts2_len + j2 + 1;
-                            edges.first.push_back(v1);
-                            edges.second.push_back(v2);
-                            edges.first.push_back(v2);
-                            edges.second.push_back(v1);
+                            pass == 0 ? (void)edges.count(v1, v2) : edges.add(v1, v2);
 
                             // ouch
                             v1 = i2 * pts2_len + j1 + 1;
                             v2 = i1 * pts2_len + j2 + 1;
-                            edges.first.push_back(v1);
-                            edges.second.push_back(v2);
-                            edges.first.push_back(v2);
-                            edges.second.push_back(v1);
-
-                            no_of_edges += 2;
+                            pass == 0 ? (void)edges.count(v1, v2) : edges.add(v1, v2);
                         }
                     }
                 }
             }
+            if (pass == 0) edges.start_fill();
+        }
+        return edges;
+    }
+
+    template <typename List1, typename List2, typename Delta1, typename Delta2,
+              typename EpsType>
+    bool build_edges_metric_within(
+        pygraph& pg, const List1& pts1, const u64 pts1_len, const List2& pts2,
+        const u64 pts2_len, const EpsType epsilon, const Delta1 max_dist,
+        const std::function<Delta1(const List1&, const u64, const u64)> d1,
+        const bool is_d1_symmetric,
+        const std::function<Delta2(const List2&, const u64, const u64)> d2,
+        const bool is_d2_symmetric)
+    {
+        relset<List1, Delta1> ps1(pts1_len, d1, is_d1_symmetric);
+        relset<List2, Delta2> ps2(pts2_len, d2, is_d2_symmetric);
+        ps1.fill_dists_within(pts1, max_dist);
+        ps2.fill_dists_within(pts2, max_dist + epsilon);
+        pg.load_graph(edges_from_relsets(ps1, ps2, epsilon));
+        return true;
+    }
+
+    template <typename List1, typename List2, typename Delta1, typename Delta2,
+              typename EpsType>
+    bool build_edges_condition_only(
+        pygraph& pg, const List1& pts1, const u64 pts1_len, const List2& pts2,
+        const u64 pts2_len,
+        const std::function<bool(const List1&, const u64, const u64, const List2&,
+                                 const u64, const u64)>
+            cfunc)
+    {
+        u64 i1, i2, j1, j2;
+        // results of cfunc, one for each pair of pairs
+        std::vector<bool> valid;
+        valid.reserve((pts1_len * (pts1_len - 1) / 2) *
+                      (pts2_len * (pts2_len - 1) / 2));
+
+        for (i1 = 0; i1 < pts1_len; ++i1)
+            for (i2 = i1 + 1; i2 < pts1_len; ++i2)
+                for (j1 = 0; j1 < pts2_len; ++j1)
+                    for (j2 = j1 + 1; j2 < pts2_len; ++j2)
+                        valid.push_back(cfunc(pts1, i1, i2, pts2, j1, j2));
+
+        pg.load_graph(condition_edges(pts1_len, pts2_len, valid));
+        return true;
+    }
+
+    // call func(a, b, a2, b2) for the pairs (a, b) of s1 and (a2, b2) of s2
+    // whose distances (i.e. keys) differ by at most tolerance
+    template <typename List1, typename List2, typename Delta1, typename Delta2,
+              typename EpsType, typename Func>
+    void keyed_pairs(const relset<List1, Delta1>& s1, const relset<List2, Delta2>& s2,
+                     const EpsType tolerance, Func func)
+    {
+        const std::vector<pair_dist<Delta1>>& d1 = s1.dists;
+        const std::vector<pair_dist<Delta2>>& d2 = s2.dists;
+        u64 i, j, lo = 0, hi = 0;
+
+        // both lists are sorted, so the window of d2 only moves forward; unlike
+        // match_ranges, the window is exact even if d2 has repeated values
+        for (i = 0; i < d1.size(); i++)
+        {
+            while (lo < d2.size() && d2[lo].dist < d1[i].dist - tolerance) lo++;
+            if (hi < lo) hi = lo;
+            while (hi < d2.size() && d2[hi].dist <= d1[i].dist + tolerance) hi++;
+            for (j = lo; j < hi; j++)
+                func(d1[i].first, d1[i].second, d2[j].first, d2[j].second);
+        }
+    }
+
+    // the edges of build_edges_condition_only, for the pairs of pairs from
+    // keyed_pairs: valid has the result of cfunc for each, in the same order
+    template <typename List1, typename List2, typename Delta1, typename Delta2,
+              typename EpsType>
+    csrBuilder keyed_edges(const relset<List1, Delta1>& s1,
+                           const relset<List2, Delta2>& s2, const EpsType tolerance,
+                           const std::vector<bool>& valid)
+    {
+        const u64 N = s2.N;
+        csrBuilder edges(s1.N * N);
+        u64 k;
+
+        for (int pass = 0; pass < 2; pass++)
+        {
+            auto link = [&edges, pass](u64 a, u64 b)
+            { pass == 0 ? (void)edges.count(a, b) : edges.add(a, b); };
+            k = 0;
+            keyed_pairs(s1, s2, tolerance,
+                        [&](u64 i1, u64 i2, u64 j1, u64 j2)
+                        {
+                            if (!valid[k++]) return;
+                            link(i1 * N + j1 + 1, i2 * N + j2 + 1);
+                            link(i2 * N + j1 + 1, i1 * N + j2 + 1);
+                        });
+            if (pass == 0) edges.start_fill();
         }
-        if (edges.first.size() == 0 || edges.second.size() == 0)
-            throw CM_ERROR("Could not extract edges");
-        pg.load_graph(no_of_vertices, no_of_edges, std::move(edges));
+        return edges;
+    }
+
+    template <typename List1, typename List2, typename Delta1, typename Delta2,
+              typename EpsType>
+    bool build_edges_condition_keyed(
+        pygraph& pg, const List1& pts1, const u64 pts1_len, const List2& pts2,
+        const u64 pts2_len,
+        const std::function<bool(const List1&, const u64, const u64, const List2&,
+                                 const u64, const u64)>
+            cfunc,
+        const std::function<Delta1(const List1&, const u64, const u64)> key1,
+        const std::function<Delta2(const List2&, const u64, const u64)> key2,
+        const EpsType tolerance)
+    {
+        relset<List1, Delta1> ps1(pts1_len, key1, true);
+        relset<List2, Delta2> ps2(pts2_len, key2, true);
+        ps1.fill_dists(pts1);
+        ps2.fill_dists(pts2);
+
+        std::vector<bool> valid;
+        keyed_pairs(ps1, ps2, tolerance,
+                    [&](u64 i1, u64 i2, u64 j1, u64 j2)
+                    { valid.push_back(cfunc(pts1, i1, i2, pts2, j1, j2)); });
+        pg.load_graph(keyed_edges(ps1, ps2, tolerance, valid));
         return true;
     }
 
@@ -254,7 +375,6 @@ namespace ext
                      const std::function<Delta2(const List2&, const u64, const u64)> d2,
                      const bool is_d2_symmetric)
     {
-        u64 no_of_vertices, no_of_edges;
         auto cfwrap = [&pts1, &pts2, &cfunc](const u64 i, const u64 j, const u64 i2,
                                              const u64 j2) -> bool
         { return cfunc(pts1, i, j, pts2, i2, j2); };
@@ -262,11 +382,163 @@ namespace ext
         relset<List2, Delta2> ps2(pts2_len, d2, is_d2_symmetric);
         ps1.fill_dists(pts1);
         ps2.fill_dists(pts2);
-        auto edges =
-            efr_condition(no_of_vertices, no_of_edges, ps1, ps2, epsilon, cfwrap);
-        if (edges.first.size() == 0 || edges.second.size() == 0)
-            throw CM_ERROR("Could not extract edges");
-        pg.load_graph(no_of_vertices, no_of_edges, std::move(edges));
+        pg.load_graph(efr_condition(ps1, ps2, epsilon, cfwrap));
+        return true;
+    }
+
+    // collects the arguments for a batched cfunc, and appends its results to
+    // valid every time batch_size of them have been collected
+    template <typename List1, typename List2>
+    class condBatcher
+    {
+       private:
+        const List1& pts1;
+        const List2& pts2;
+        const batch_cfunc<List1, List2>& bcfunc;
+        const u64 batch_size;
+        std::vector<u64> i1, i2, j1, j2;
+        std::vector<bool> out;
+
+       public:
+        std::vector<bool> valid;
+
+        condBatcher(const List1& pts1, const List2& pts2,
+                    const batch_cfunc<List1, List2>& bcfunc, const u64 batch_size)
+            : pts1(pts1), pts2(pts2), bcfunc(bcfunc),
+              batch_size(batch_size == 0 ? 1 : batch_size){};
+
+        void push(const u64 a, const u64 b, const u64 a2, const u64 b2)
+        {
+            i1.push_back(a);
+            i2.push_back(b);
+            j1.push_back(a2);
+            j2.push_back(b2);
+            if (i1.size() >= batch_size) flush();
+        }
+
+        void flush()
+        {
+            if (i1.empty()) return;
+            bcfunc(pts1, i1, i2, pts2, j1, j2, out);
+            valid.insert(valid.end(), out.begin(), out.begin() + i1.size());
+            i1.clear();
+            i2.clear();
+            j1.clear();
+            j2.clear();
+        }
+    };
+
+    template <typename List1, typename List2, typename Delta1, typename Delta2,
+              typename EpsType>
+    bool build_edges_condition_only_batched(pygraph& pg, const List1& pts1,
+                                            const u64 pts1_len, const List2& pts2,
+                                            const u64 pts2_len,
+                                            const batch_cfunc<List1, List2>& bcfunc,
+                                            const u64 batch_size)
+    {
+        u64 i1, i2, j1, j2;
+        condBatcher<List1, List2> cb(pts1, pts2, bcfunc, batch_size);
+        cb.valid.reserve((pts1_len * (pts1_len - 1) / 2) *
+                         (pts2_len * (pts2_len - 1) / 2));
+
+        for (i1 = 0; i1 < pts1_len; ++i1)
+            for (i2 = i1 + 1; i2 < pts1_len; ++i2)
+                for (j1 = 0; j1 < pts2_len; ++j1)
+                    for (j2 = j1 + 1; j2 < pts2_len; ++j2) cb.push(i1, i2, j1, j2);
+        cb.flush();
+
+        pg.load_graph(condition_edges(pts1_len, pts2_len, cb.valid));
+        return true;
+    }
+
+    // fill_dists with the batched function bd, or delfunc if bd is empty
+    template <typename List, typename Delta>
+    void fill_batched(relset<List, Delta>& ps, const List& pts,
+                      const batch_delfunc<List, Delta>& bd, const u64 batch_size)
+    {
+        if (!bd)
+            ps.fill_dists(pts);
+        else
+        {
+            ps.compute_dists(pts, bd, batch_size);
+            ps.sort_dists();
+        }
+    }
+
+    template <typename List1, typename List2, typename Delta1, typename Delta2,
+              typename EpsType>
+    bool build_edges_batched(pygraph& pg, const List1& pts1, const u64 pts1_len,
+                             const List2& pts2, const u64 pts2_len,
+                             const EpsType epsilon,
+                             const batch_cfunc<List1, List2>& bcfunc,
+                             const batch_delfunc<List1, Delta1>& bd1,
+                             const bool is_d1_symmetric,
+                             const batch_delfunc<List2, Delta2>& bd2,
+                             const bool is_d2_symmetric, const u64 batch_size)
+    {
+        const std::function<Delta1(const List1&, const u64, const u64)> d1 =
+            dummy_comparison<List1, Delta1>;
+        const std::function<Delta2(const List2&, const u64, const u64)> d2 =
+            dummy_comparison<List2, Delta2>;
+        relset<List1, Delta1> ps1(pts1_len, d1, is_d1_symmetric);
+        relset<List2, Delta2> ps2(pts2_len, d2, is_d2_symmetric);
+        fill_batched(ps1, pts1, bd1, batch_size);
+        fill_batched(ps2, pts2, bd2, batch_size);
+
+        if (!bcfunc)
+        {
+            pg.load_graph(edges_from_relsets(ps1, ps2, epsilon));
+            return true;
+        }
+
+        // efr_condition on one thread calls cfunc in the order of match_ranges,
+        // so the results are computed beforehand in batches, in the same order
+        condBatcher<List1, List2> cb(pts1, pts2, bcfunc, batch_size);
+        const bool swapped = (ps1.symmetric || ps2.symmetric);
+        match_ranges(ps1.dists, ps2.dists, epsilon, 0, ps1.dists.size(),
+                     [&](u64 i, u64 lb, u64 ub)
+                     {
+                         for (u64 j = lb; j <= ub; j++)
+                         {
+                             cb.push(ps1.dists[i].first, ps1.dists[i].second,
+                                     ps2.dists[j].first, ps2.dists[j].second);
+                             if (swapped)
+                                 cb.push(ps1.dists[i].first, ps1.dists[i].second,
+                                         ps2.dists[j].second, ps2.dists[j].first);
+                         }
+                     });
+        cb.flush();
+
+        u64 k = 0;
+        auto lookup = [&cb, &k](const u64, const u64, const u64, const u64) -> bool
+        { return cb.valid[k++]; };
+        pg.load_graph(efr_condition(ps1, ps2, epsilon, lookup, 1));
+        return true;
+    }
+
+    template <typename List1, typename List2, typename Delta1, typename Delta2,
+              typename EpsType>
+    bool build_edges_condition_keyed_batched(
+        pygraph& pg, const List1& pts1, const u64 pts1_len, const List2& pts2,
+        const u64 pts2_len, const batch_cfunc<List1, List2>& bcfunc,
+        const batch_delfunc<List1, Delta1>& bkey1,
+        const batch_delfunc<List2, Delta2>& bkey2, const EpsType tolerance,
+        const u64 batch_size)
+    {
+        const std::function<Delta1(const List1&, const u64, const u64)> d1 =
+            dummy_comparison<List1, Delta1>;
+        const std::function<Delta2(const List2&, const u64, const u64)> d2 =
+            dummy_comparison<List2, Delta2>;
+        relset<List1, Delta1> ps1(pts1_len, d1, true);
+        relset<List2, Delta2> ps2(pts2_len, d2, true);
+        fill_batched(ps1, pts1, bkey1, batch_size);
+        fill_batched(ps2, pts2, bkey2, batch_size);
+
+        condBatcher<List1, List2> cb(pts1, pts2, bcfunc, batch_size);
+        keyed_pairs(ps1, ps2, tolerance, [&cb](u64 i1, u64 i2, u64 j1, u64 j2)
+                    { cb.push(i1, i2, j1, j2); });
+        cb.flush();
+        pg.load_graph(keyed_edges(ps1, ps2, tolerance, cb.valid));
         return true;
     }
 
@@ -9,6 +9,13 @@ namespace cliquematch
 {
 namespace ext
 {
+    // a batched delfunc is called with the pairs (i[k], j[k]) of a batch, and
+    // fills out[k] with the distance between them (out is resized to the batch)
+    template <typename List, typename Delta>
+    using batch_delfunc =
+        std::function<void(const List&, const std::vector<u64>&,
+                           const std::vector<u64>&, std::vector<Delta>&)>;
+
     template <typename List, typename Delta>
     struct relset
     {
@@ -25,7 +32,20 @@ namespace ext
         relset& operator=(relset&) = delete;
         relset(const relset&) = delete;
         relset(relset&&) = delete;
+        // compute the distances with delfunc, and sort them
         void fill_dists(const List&);
+        // (the steps of fill_dists, for specializations of it)
+        void compute_dists(const List&);
+        // compute the distances with bfunc instead, batch_size pairs at a time
+        void compute_dists(const List&, const batch_delfunc<List, Delta>& bfunc,
+                           u64 batch_size);
+        void sort_dists(u64 n_threads = 0);
+        // keep only the pairs with distance <= max_dist (the other pairs are
+        // never stored, so this needs far less memory for large sets)
+        void fill_dists_within(const List&, const Delta max_dist);
+        void compute_dists_within(const List&, const Delta max_dist);
+        // number of pairs that fill_dists stores
+        u64 n_pairs() const { return symmetric ? N * (N - 1) / 2 : N * (N - 1); }
         // void disp() const; needed only for debugging
     };
 }  // namespace ext
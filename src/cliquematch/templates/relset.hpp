@@ -2,6 +2,7 @@
 #define RELSET_HPP
 
 #include <templates/relset.h>
+#include <detail/utils.h>
 #include <algorithm>
 
 namespace cliquematch
@@ -15,16 +16,22 @@ namespace ext
         bool symmetric)
         : symmetric(symmetric), N(N), delfunc(dfunc)
     {
-        if (this->symmetric)
-            this->dists.resize(N * (N - 1) / 2);
-        else
-            this->dists.resize(N * (N - 1));
+        // (dists is allocated when it is filled)
     }
 
     template <typename List, typename Delta>
     void relset<List, Delta>::fill_dists(const List& x)
+    {
+        this->compute_dists(x);
+        this->sort_dists();
+    }
+
+    // delfunc may call into Python, so this loop is always on a single thread
+    template <typename List, typename Delta>
+    void relset<List, Delta>::compute_dists(const List& x)
     {
         u64 i, j, count = 0;
+        this->dists.resize(this->n_pairs());
         for (i = 0; i < this->N; i++)
         {
             for (j = (this->symmetric ? i + 1 : 0); j < this->N; j++)
@@ -36,7 +43,79 @@ namespace ext
                 count++;
             }
         }
-        std::sort(this->dists.begin(), this->dists.end());
+    }
+
+    template <typename List, typename Delta>
+    void relset<List, Delta>::compute_dists(const List& x,
+                                            const batch_delfunc<List, Delta>& bfunc,
+                                            u64 batch_size)
+    {
+        u64 i, j, count = 0, start = 0;
+        std::vector<u64> bi, bj;
+        std::vector<Delta> out;
+        this->dists.resize(this->n_pairs());
+        if (batch_size == 0) batch_size = 1;
+        bi.reserve(std::min(batch_size, this->dists.size()));
+        bj.reserve(std::min(batch_size, this->dists.size()));
+
+        // the pairs are in the same order as above, and every time a batch
+        // is full its distances are computed in one call to bfunc
+        for (i = 0; i < this->N; i++)
+        {
+            for (j = (this->symmetric ? i + 1 : 0); j < this->N; j++)
+            {
+                if (j == i) continue;
+                this->dists[count].first = i;
+                this->dists[count].second = j;
+                bi.push_back(i);
+                bj.push_back(j);
+                count++;
+                if (bi.size() < batch_size && count < this->dists.size()) continue;
+
+                bfunc(x, bi, bj, out);
+                for (u64 k = 0; k < bi.size(); k++)
+                    this->dists[start + k].dist = out[k];
+                start = count;
+                bi.clear();
+                bj.clear();
+            }
+        }
+    }
+
+    template <typename List, typename Delta>
+    void relset<List, Delta>::fill_dists_within(const List& x, const Delta max_dist)
+    {
+        this->compute_dists_within(x, max_dist);
+        this->sort_dists();
+    }
+
+    // (delfunc is still called on every pair)
+    template <typename List, typename Delta>
+    void relset<List, Delta>::compute_dists_within(const List& x, const Delta max_dist)
+    {
+        u64 i, j;
+        Delta d;
+        this->dists.clear();
+        for (i = 0; i < this->N; i++)
+        {
+            for (j = (this->symmetric ? i + 1 : 0); j < this->N; j++)
+            {
+                if (j == i) continue;
+                d = this->delfunc(x, i, j);
+                if (!(d <= max_dist)) continue;
+                this->dists.push_back(pair_dist<Delta>());
+                this->dists.back().first = i;
+                this->dists.back().second = j;
+                this->dists.back().dist = d;
+            }
+        }
+    }
+
+    template <typename List, typename Delta>
+    void relset<List, Delta>::sort_dists(u64 n_threads)
+    {
+        auto base = this->dists.data();
+        detail::parallel_sort(base, base + this->dists.size(), n_threads);
     }
 
     /* needed only for debugging
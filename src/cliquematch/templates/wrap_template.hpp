@@ -6,11 +6,76 @@ namespace cliquematch
 {
 namespace ext
 {
+    inline py::array_t<u64> index_array(const std::vector<u64>& ind)
+    {
+        return py::array_t<u64>(ind.size(), ind.data());
+    }
+
+    template <typename T>
+    core::ndarray<T> batch_results(const py::object& res, const u64 batch)
+    {
+        auto arr = res.cast<core::ndarray<T>>();
+        if (arr.ndim() != 1 || static_cast<u64>(arr.size()) != batch)
+            throw CM_ERROR("Batched function returned " + std::to_string(arr.size()) +
+                           " values instead of " + std::to_string(batch) + "\n");
+        return arr;
+    }
+
+    // d(S, i, j) is called with numpy arrays i and j, and returns an array of
+    // the distances; None means the default metric (an empty function)
+    // (the edges are built without the GIL, so it is acquired for each call, and
+    // d is captured by reference, because it cannot be copied without the GIL)
+    template <typename List, typename Delta>
+    batch_delfunc<List, Delta> wrap_batch_delfunc(const py::object& d)
+    {
+        if (d.is_none()) return batch_delfunc<List, Delta>();
+        return [&d](const List& x, const std::vector<u64>& i, const std::vector<u64>& j,
+                    std::vector<Delta>& out)
+        {
+            py::gil_scoped_acquire acquire;
+            auto res = batch_results<Delta>(d(x, index_array(i), index_array(j)),
+                                            i.size());
+            out.assign(res.data(), res.data() + i.size());
+        };
+    }
+
+    // cfunc(S1, i1, j1, S2, i2, j2) is called with numpy arrays of indices,
+    // and returns an array of bools; None means no condition
+    // (called without the GIL, as in wrap_batch_delfunc)
+    template <typename List1, typename List2>
+    batch_cfunc<List1, List2> wrap_batch_cfunc(const py::object& cfunc)
+    {
+        if (cfunc.is_none()) return batch_cfunc<List1, List2>();
+        return [&cfunc](const List1& s1, const std::vector<u64>& i1,
+                        const std::vector<u64>& j1, const List2& s2,
+                        const std::vector<u64>& i2, const std::vector<u64>& j2,
+                        std::vector<bool>& out)
+        {
+            py::gil_scoped_acquire acquire;
+            auto res = batch_results<bool>(cfunc(s1, index_array(i1), index_array(j1),
+                                                 s2, index_array(i2), index_array(j2)),
+                                           i1.size());
+            out.assign(res.data(), res.data() + i1.size());
+        };
+    }
+
+    // a Python distance function, or dummy_comparison if d is None
+    template <typename List, typename Delta>
+    std::function<Delta(const List&, const u64, const u64)> metric_or_default(
+        const py::object& d)
+    {
+        if (d.is_none()) return dummy_comparison<List, Delta>;
+        return d.cast<std::function<Delta(const List&, const u64, const u64)>>();
+    }
+
+    // the edges are built without the GIL: the lists are only read through
+    // references, and the Python functions acquire the GIL when they are called
     template <typename List1, typename List2, typename Delta1 = double,
               typename Delta2 = Delta1, typename EpsType = Delta1>
     void init_GraphTemplate(py::module& m)
     {
         using namespace pybind11;
+        using release_gil = call_guard<gil_scoped_release>;
 
         m.def(
             "_build_edges_metric_only",
@@ -18,7 +83,7 @@ namespace ext
                const u64 l2_len, const EpsType eps)
             { return build_edges_metric_only(pg, l1, l1_len, l2, l2_len, eps); },
             "G"_a.none(false), "set1"_a.noconvert(), "len1"_a, "set2"_a.noconvert(),
-            "len2"_a, "epsilon"_a);
+            "len2"_a, "epsilon"_a, release_gil());
         m.def(
             "_build_edges_metric_only",
             [](pygraph& pg, const List1& l1, const u64 l1_len, const List2& l2,
@@ -30,21 +95,43 @@ namespace ext
                                                is_d1_symmetric);
             },
             "G"_a.none(false), "set1"_a.noconvert(), "len1"_a, "set2"_a.noconvert(),
-            "len2"_a, "epsilon"_a, "d1"_a, "is_d1_symmetric"_a);
+            "len2"_a, "epsilon"_a, "d1"_a, "is_d1_symmetric"_a, release_gil());
         m.def("_build_edges_metric_only",
               &build_edges_metric_only<List1, List2, Delta1, Delta2, EpsType>,
               "G"_a.none(false), "set1"_a.noconvert(), "len1"_a, "set2"_a.noconvert(),
               "len2"_a, "epsilon"_a, "d1"_a, "is_d1_symmetric"_a, "d2"_a,
-              "is_d2_symmetric"_a);
+              "is_d2_symmetric"_a, release_gil());
+        m.def(
+            "_build_edges_within",
+            [](pygraph& pg, const List1& l1, const u64 l1_len, const List2& l2,
+               const u64 l2_len, const EpsType eps, const Delta1 max_dist,
+               const py::object& d1, const bool is_d1_symmetric, const py::object& d2,
+               const bool is_d2_symmetric)
+            {
+                auto f1 = metric_or_default<List1, Delta1>(d1);
+                auto f2 = metric_or_default<List2, Delta2>(d2);
+                py::gil_scoped_release release;
+                return build_edges_metric_within<List1, List2, Delta1, Delta2, EpsType>(
+                    pg, l1, l1_len, l2, l2_len, eps, max_dist, f1, is_d1_symmetric, f2,
+                    is_d2_symmetric);
+            },
+            "G"_a.none(false), "set1"_a.noconvert(), "len1"_a, "set2"_a.noconvert(),
+            "len2"_a, "epsilon"_a, "max_dist"_a, "d1"_a.none(true), "is_d1_symmetric"_a,
+            "d2"_a.none(true), "is_d2_symmetric"_a);
         m.def("_build_edges_condition_only",
               &build_edges_condition_only<List1, List2, Delta1, Delta2, EpsType>,
               "G"_a.none(false), "set1"_a.noconvert(), "len1"_a, "set2"_a.noconvert(),
-              "len2"_a, "condition_func"_a);
+              "len2"_a, "condition_func"_a, release_gil());
+        m.def("_build_edges_condition_only",
+              &build_edges_condition_keyed<List1, List2, Delta1, Delta2, EpsType>,
+              "G"_a.none(false), "set1"_a.noconvert(), "len1"_a, "set2"_a.noconvert(),
+              "len2"_a, "condition_func"_a, "key1"_a, "key2"_a, "key_tolerance"_a,
+              release_gil());
 
         m.def("_build_edges", &build_edges<List1, List2, Delta1, Delta2, EpsType>,
               "G"_a.none(false), "set1"_a.noconvert(), "len1"_a, "set2"_a.noconvert(),
               "len2"_a, "epsilon"_a, "condition_func"_a, "d1"_a, "is_d1_symmetric"_a,
-              "d2"_a, "is_d2_symmetric"_a);
+              "d2"_a, "is_d2_symmetric"_a, release_gil());
         m.def(
             "_build_edges",
             [](pygraph& pg, const List1& l1, const u64 l1_len, const List2& l2,
@@ -58,7 +145,8 @@ namespace ext
                                    is_d1_symmetric);
             },
             "G"_a.none(false), "set1"_a.noconvert(), "len1"_a, "set2"_a.noconvert(),
-            "len2"_a, "epsilon"_a, "condition_func"_a, "d1"_a, "is_d1_symmetric"_a);
+            "len2"_a, "epsilon"_a, "condition_func"_a, "d1"_a, "is_d1_symmetric"_a,
+            release_gil());
         m.def(
             "_build_edges",
             [](pygraph& pg, const List1& l1, const u64 l1_len, const List2& l2,
@@ -68,7 +156,58 @@ namespace ext
                    cfunc)
             { return build_edges(pg, l1, l1_len, l2, l2_len, eps, cfunc); },
             "G"_a.none(false), "set1"_a.noconvert(), "len1"_a, "set2"_a.noconvert(),
-            "len2"_a, "epsilon"_a, "condition_func"_a);
+            "len2"_a, "epsilon"_a, "condition_func"_a, release_gil());
+
+        m.def(
+            "_build_edges_batched",
+            [](pygraph& pg, const List1& l1, const u64 l1_len, const List2& l2,
+               const u64 l2_len, const EpsType eps, const py::object& cfunc,
+               const py::object& d1, const bool is_d1_symmetric, const py::object& d2,
+               const bool is_d2_symmetric, const u64 batch_size)
+            {
+                auto c = wrap_batch_cfunc<List1, List2>(cfunc);
+                auto f1 = wrap_batch_delfunc<List1, Delta1>(d1);
+                auto f2 = wrap_batch_delfunc<List2, Delta2>(d2);
+                py::gil_scoped_release release;
+                return build_edges_batched<List1, List2, Delta1, Delta2, EpsType>(
+                    pg, l1, l1_len, l2, l2_len, eps, c, f1, is_d1_symmetric, f2,
+                    is_d2_symmetric, batch_size);
+            },
+            "G"_a.none(false), "set1"_a.noconvert(), "len1"_a, "set2"_a.noconvert(),
+            "len2"_a, "epsilon"_a, "condition_func"_a.none(true), "d1"_a.none(true),
+            "is_d1_symmetric"_a, "d2"_a.none(true), "is_d2_symmetric"_a,
+            "batch_size"_a);
+        m.def(
+            "_build_edges_condition_only_batched",
+            [](pygraph& pg, const List1& l1, const u64 l1_len, const List2& l2,
+               const u64 l2_len, const py::object& cfunc, const u64 batch_size)
+            {
+                auto c = wrap_batch_cfunc<List1, List2>(cfunc);
+                py::gil_scoped_release release;
+                return build_edges_condition_only_batched<List1, List2, Delta1, Delta2,
+                                                          EpsType>(
+                    pg, l1, l1_len, l2, l2_len, c, batch_size);
+            },
+            "G"_a.none(false), "set1"_a.noconvert(), "len1"_a, "set2"_a.noconvert(),
+            "len2"_a, "condition_func"_a.none(false), "batch_size"_a);
+        m.def(
+            "_build_edges_condition_only_batched",
+            [](pygraph& pg, const List1& l1, const u64 l1_len, const List2& l2,
+               const u64 l2_len, const py::object& cfunc, const py::object& key1,
+               const py::object& key2, const EpsType key_tolerance,
+               const u64 batch_size)
+            {
+                auto c = wrap_batch_cfunc<List1, List2>(cfunc);
+                auto f1 = wrap_batch_delfunc<List1, Delta1>(key1);
+                auto f2 = wrap_batch_delfunc<List2, Delta2>(key2);
+                py::gil_scoped_release release;
+                return build_edges_condition_keyed_batched<List1, List2, Delta1, Delta2,
+                                                           EpsType>(
+                    pg, l1, l1_len, l2, l2_len, c, f1, f2, key_tolerance, batch_size);
+            },
+            "G"_a.none(false), "set1"_a.noconvert(), "len1"_a, "set2"_a.noconvert(),
+            "len2"_a, "condition_func"_a.none(false), "key1"_a.none(false),
+            "key2"_a.none(false), "key_tolerance"_a, "batch_size"_a);
     }
 }  // namespace ext
 }  // namespace cliquematch
@@ -4,6 +4,9 @@ from cliquematch.core import (
     _build_edges_metric_only,
     _build_edges,
     _build_edges_condition_only,
+    _build_edges_batched,
+    _build_edges_condition_only_batched,
+    _build_edges_within,
 )
 
 
@@ -35,17 +38,57 @@ class GenGraph(Graph):
         self.is_d2_symmetric = is_d2_symmetric
         self.epsilon = 1.1
 
-    def build_edges(self):
+    def build_edges(self, batch_size=0, max_dist=None):
         """Build edges of the correspondence graph using distance metrics.
 
         Checks `.d1` and `.d2` for defaults before passing to base class.
 
+        Args:
+            batch_size ( `int` ): if positive, `.d1` and `.d2` are called with
+                            batches of at most ``batch_size`` pairs: they must take
+                            the set and two `numpy.ndarray`\ s of indices, and
+                            return a `numpy.ndarray` of the distances
+            max_dist ( `float` ): if given, only pairs of elements in `.S1` that
+                            are at most ``max_dist`` apart are used to build edges;
+                            this uses much less memory for large sets, and with
+                            the default (Euclidean) metric the pairs are found
+                            with a k-d tree (``batch_size`` is not used)
+
         Raises:
             RuntimeError: if `.d1`\ or `.d2`  are invalid functions
 
         Returns:
             bool: `True` if construction was successful
         """
+        if max_dist is not None:
+            return _build_edges_within(
+                self,
+                self.S1,
+                len(self.S1),
+                self.S2,
+                len(self.S2),
+                self.epsilon,
+                max_dist,
+                self.d1,
+                self.is_d1_symmetric,
+                self.d2,
+                self.is_d2_symmetric,
+            )
+        elif batch_size > 0:
+            return _build_edges_batched(
+                self,
+                self.S1,
+                len(self.S1),
+                self.S2,
+                len(self.S2),
+                self.epsilon,
+                None,
+                self.d1,
+                self.is_d1_symmetric,
+                self.d2,
+                self.is_d2_symmetric,
+                batch_size,
+            )
         args = [self, self.S1, len(self.S1), self.S2, len(self.S2), self.epsilon]
         if self.d1:
             args = args + [self.d1, self.is_d1_symmetric]
@@ -53,7 +96,15 @@ class GenGraph(Graph):
                 args = args + [self.d2, self.is_d2_symmetric]
         return _build_edges_metric_only(*args)
 
-    def build_edges_with_condition(self, condition_func, use_cfunc_only):
+    def build_edges_with_condition(
+        self,
+        condition_func,
+        use_cfunc_only,
+        batch_size=0,
+        key1=None,
+        key2=None,
+        key_tolerance=0.0,
+    ):
         """Build edges of the correspondence graph using a given condition function.
 
         Args:
@@ -62,6 +113,22 @@ class GenGraph(Graph):
                             `int`, `int`, and return `bool`
             use_cfunc_only ( `bool` ): if `True`, the distance metrics will not
                             be used to filter out edges (slower)
+            batch_size ( `int` ): if positive, ``condition_func``, `.d1` and `.d2`
+                            are called with batches of at most ``batch_size``
+                            pairs: the `int` parameters are replaced by
+                            `numpy.ndarray`\ s of indices, and the functions
+                            return a `numpy.ndarray` of the results
+            key1 ( `callable` (`.S1`, `int`, `int`) -> `float`):
+                            if given with ``use_cfunc_only``, a cheap key for
+                            each pair of elements in `.S1`: ``condition_func``
+                            is only called on pairs of pairs whose keys differ by
+                            at most ``key_tolerance``. The edges are the same as
+                            without a key if ``condition_func`` is never `True`
+                            for pairs with keys further apart (much faster)
+            key2 ( `callable` (`.S2`, `int`, `int`) -> `float`):
+                            key for each pair of elements in `.S2`,
+                            same as ``key1`` if `None`
+            key_tolerance ( `float` ): maximum difference between matching keys
 
         Returns:
             `True` if construction was successful
@@ -76,7 +143,20 @@ class GenGraph(Graph):
             self.S2,
             len(self.S2),
         ]
-        if use_cfunc_only:
+        if use_cfunc_only and key1 is not None:
+            key2 = key1 if key2 is None else key2
+            args = args + [condition_func, key1, key2, key_tolerance]
+            if batch_size > 0:
+                return _build_edges_condition_only_batched(*(args + [batch_size]))
+            return _build_edges_condition_only(*args)
+        elif batch_size > 0 and use_cfunc_only:
+            args = args + [condition_func, batch_size]
+            return _build_edges_condition_only_batched(*args)
+        elif batch_size > 0:
+            args = args + [self.epsilon, condition_func]
+            args = args + [self.d1, self.is_d1_symmetric, self.d2, self.is_d2_symmetric]
+            return _build_edges_batched(*(args + [batch_size]))
+        elif use_cfunc_only:
             args = args + [condition_func]
             return _build_edges_condition_only(*args)
         else:
@@ -99,6 +179,9 @@ class GenGraph(Graph):
         use_dfs=True,
         continue_search=False,
         return_indices=True,
+        n_threads=1,
+        use_coloring=False,
+        use_bitmatrix=False,
     ):
         """Get corresponding subsets between the `.S1` and `.S2`.
         Calls `~cliquematch.Graph.get_max_clique` internally.
@@ -117,6 +200,17 @@ class GenGraph(Graph):
                 if `True`\, use the depth-first to obtain the clique. default is `True`\.
             continue_search (`bool`\):
                 set as `True` to continue a clique search interrupted by ``time_limit``\.
+            n_threads (`int`\):
+                number of threads to use for the depth-first search; set as
+                `0` to use all available cores. Ignored with ``use_coloring``
+                or ``use_bitmatrix``\. default is `1`\.
+            use_coloring (`bool`\):
+                if `True`\, prune the depth-first search with a coloring bound;
+                faster on dense graphs, and runs on one thread. default is `False`\.
+            use_bitmatrix (`bool`\):
+                if `True`\, store the neighborhood of each vertex as a bitmatrix
+                during the depth-first search; faster on dense graphs, and runs
+                on one thread. default is `False`\.
             return_indices (`bool`\):
                 if `True` return the indices of the corresponding elements,
                 else return the elements
@@ -136,6 +230,9 @@ class GenGraph(Graph):
             use_heuristic,
             use_dfs,
             continue_search,
+            n_threads,
+            use_coloring,
+            use_bitmatrix,
         )
         if return_indices:
             answer = indices
@@ -143,7 +240,9 @@ class GenGraph(Graph):
             answer = self._format_correspondence(indices)
         return answer
 
-    def all_correspondences(self, size, return_indices=True):
+    def all_correspondences(
+        self, size, return_indices=True, use_bitmatrix=False, n_threads=1
+    ):
         """Find all correspondences of a given size.
 
         Args:
@@ -151,6 +250,13 @@ class GenGraph(Graph):
             return_indices (`bool`\):
                 if `True` return the indices of the corresponding elements,
                 else return the elements
+            use_bitmatrix (`bool`\):
+                if `True`\, store the neighborhood of each vertex as a bitmatrix
+                during the search. default is `False`\.
+            n_threads (`int`\):
+                number of threads to use for the search; set as `0` to use
+                all available cores. With more than one thread, the
+                correspondences come in a different order. default is `1`\.
 
         Returns:
             `~cliquematch._WrappedIterator`:
@@ -161,9 +267,13 @@ class GenGraph(Graph):
             RuntimeError: if called before edges have been constructed
         """
         if return_indices:
-            return Graph._all_correspondences(self, len(self.S1), len(self.S2), size)
+            return Graph._all_correspondences(
+                self, len(self.S1), len(self.S2), size, use_bitmatrix, n_threads
+            )
         else:
             return WrappedIterator(
-                Graph._all_correspondences(self, len(self.S1), len(self.S2), size),
+                Graph._all_correspondences(
+                    self, len(self.S1), len(self.S2), size, use_bitmatrix, n_threads
+                ),
                 lambda x: self._format_correspondence(x),
             )
@@ -158,6 +158,9 @@ class AlignGraph(GenGraph):
         use_dfs=True,
         continue_search=False,
         return_indices=True,
+        n_threads=1,
+        use_coloring=False,
+        use_bitmatrix=False,
     ):
         """Find correspondence between the sets of points ``S1`` and ``S2``.
         Calls `~cliquematch.Graph.get_max_clique` internally.
@@ -176,6 +179,17 @@ class AlignGraph(GenGraph):
                 if `True`\, use the depth-first to obtain the clique. default is `True`\.
             continue_search (`bool`\):
                 set as `True` to continue a clique search interrupted by ``time_limit``\.
+            n_threads (`int`\):
+                number of threads to use for the depth-first search; set as
+                `0` to use all available cores. Ignored with ``use_coloring``
+                or ``use_bitmatrix``\. default is `1`\.
+            use_coloring (`bool`\):
+                if `True`\, prune the depth-first search with a coloring bound;
+                faster on dense graphs, and runs on one thread. default is `False`\.
+            use_bitmatrix (`bool`\):
+                if `True`\, store the neighborhood of each vertex as a bitmatrix
+                during the depth-first search; faster on dense graphs, and runs
+                on one thread. default is `False`\.
             return_indices (`bool`\):
                 if `True` return the indices of the corresponding elements,
                 else return the below `dict`
@@ -201,6 +215,9 @@ class AlignGraph(GenGraph):
             use_dfs,
             continue_search,
             True,
+            n_threads,
+            use_coloring,
+            use_bitmatrix,
         )
         if return_indices:
             return indices
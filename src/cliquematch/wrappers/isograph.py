@@ -17,10 +17,36 @@ class IsoGraph(Graph):
         self.S1 = G1
         self.S2 = G2
 
-    def build_edges(self):
+    def build_edges(self, use_degree=False, labels1=None, labels2=None):
         """Build edges of the correspondence graph.
+
+        Args:
+            use_degree (`bool`\):
+                if `True`\, a vertex of `.S2` is only matched to vertices of
+                `.S1` with at least as many neighbors. The correspondence graph
+                is much smaller, but only correspondences that map all of `.S2`
+                into `.S1` are sure to be found.
+            labels1 (`list`\):
+                if given, the label of each vertex of `.S1` (vertex ``v`` at
+                position ``v - 1``\); vertices are only matched to vertices with
+                the same label, so ``labels2`` must also be given.
+            labels2 (`list`\): the label of each vertex of `.S2`
+
+        Raises:
+            RuntimeError: if the labels do not cover the vertices of both graphs,
+                or if no vertex of `.S2` can be matched to `.S1`
         """
-        _build_edges(self, self.S1, self.S2)
+        if not use_degree and labels1 is None and labels2 is None:
+            _build_edges(self, self.S1, self.S2)
+            return
+        ids1, ids2 = [], []
+        if labels1 is not None or labels2 is not None:
+            # replace the labels by integers; labels only in labels2 get an
+            # integer that is not in ids1, so they match nothing
+            table = dict()
+            ids1 = [table.setdefault(x, len(table)) for x in (labels1 or [])]
+            ids2 = [table.get(x, len(table)) for x in (labels2 or [])]
+        _build_edges(self, self.S1, self.S2, use_degree, ids1, ids2)
 
     def _format_correspondence(self, indices):
         v1 = set(indices[0])
@@ -47,6 +73,9 @@ class IsoGraph(Graph):
         use_dfs=True,
         continue_search=False,
         return_indices=True,
+        n_threads=1,
+        use_coloring=False,
+        use_bitmatrix=False,
     ):
         """Obtain the corresponding vertices in the subgraph isomorphism.
 
@@ -64,6 +93,17 @@ class IsoGraph(Graph):
                 if `True`\, use the depth-first to obtain the clique. default is `True`\.
             continue_search (`bool`\):
                 set as `True` to continue a clique search interrupted by ``time_limit``\.
+            n_threads (`int`\):
+                number of threads to use for the depth-first search; set as
+                `0` to use all available cores. Ignored with ``use_coloring``
+                or ``use_bitmatrix``\. default is `1`\.
+            use_coloring (`bool`\):
+                if `True`\, prune the depth-first search with a coloring bound;
+                faster on dense graphs, and runs on one thread. default is `False`\.
+            use_bitmatrix (`bool`\):
+                if `True`\, store the neighborhood of each vertex as a bitmatrix
+                during the depth-first search; faster on dense graphs, and runs
+                on one thread. default is `False`\.
             return_indices (`bool`\):
                 if `True` return the vertices of the corresponding subgraphs,
                 else return `dict`\s for each corresponding subgraph and
@@ -83,6 +123,9 @@ class IsoGraph(Graph):
             use_heuristic,
             use_dfs,
             continue_search,
+            n_threads,
+            use_coloring,
+            use_bitmatrix,
         )
         offset = lambda l: [x + 1 for x in l]
         indices = [offset(indices[0]), offset(indices[1])]
@@ -91,7 +134,9 @@ class IsoGraph(Graph):
         else:
             return self._format_correspondence(indices)
 
-    def all_correspondences(self, size, return_indices=True):
+    def all_correspondences(
+        self, size, return_indices=True, use_bitmatrix=False, n_threads=1
+    ):
         """Find all correspondences of a given size.
 
         Args:
@@ -100,6 +145,13 @@ class IsoGraph(Graph):
                 if `True` return the vertices of the corresponding subgraphs,
                 else return `dict`\s for each corresponding subgraph and
                 a `dict` mapping the vertices.
+            use_bitmatrix (`bool`\):
+                if `True`\, store the neighborhood of each vertex as a bitmatrix
+                during the search. default is `False`\.
+            n_threads (`int`\):
+                number of threads to use for the search; set as `0` to use
+                all available cores. With more than one thread, the
+                correspondences come in a different order. default is `1`\.
 
         Returns:
             `~cliquematch._WrappedIterator`:
@@ -112,11 +164,15 @@ class IsoGraph(Graph):
         offset = lambda l: [x + 1 for x in l]
         if return_indices:
             return WrappedIterator(
-                Graph._all_correspondences(self, len(self.S1), len(self.S2), size),
+                Graph._all_correspondences(
+                    self, len(self.S1), len(self.S2), size, use_bitmatrix, n_threads
+                ),
                 lambda x: [offset(x[0]), offset(x[1])],
             )
         else:
             return WrappedIterator(
-                Graph._all_correspondences(self, len(self.S1), len(self.S2), size),
+                Graph._all_correspondences(
+                    self, len(self.S1), len(self.S2), size, use_bitmatrix, n_threads
+                ),
                 lambda x: self._format_correspondence([offset(x[0]), offset(x[1])]),
             )
@@ -24,7 +24,7 @@ class TestGraph(object):
     * setting and accessing attributes
     * ensuring dfs works for a small sample Graph
     * checks that the search can be reset
-    * (doesn't check continue_search or heuristic)
+    * (doesn't check the heuristic)
     """
 
     def test_adjmat(self):
@@ -53,6 +53,13 @@ class TestGraph(object):
         assert G1.n_edges == len(elist)
         assert np.sum(G1.to_edgelist() - elist) == 0
 
+        # repeated and reversed edges are counted once
+        G2 = cliquematch.Graph.from_edgelist(
+            np.concatenate([elist, elist[:, ::-1]]), 5
+        )
+        assert G2.n_edges == len(elist)
+        assert np.sum(G2.to_edgelist() - elist) == 0
+
         elist[0, 0] = 0
         with pytest.raises(RuntimeError):
             G2 = cliquematch.Graph.from_edgelist(elist, 5)
@@ -61,6 +68,21 @@ class TestGraph(object):
         with pytest.raises(RuntimeError):
             G2 = cliquematch.Graph.from_edgelist(elist, 3)
 
+    def test_elist_hub(self):
+        # vertex 1 has a list long enough to be sorted on all threads
+        n = 100000
+        elist = np.zeros((n - 1, 2), dtype=np.uint32)
+        elist[:, 0] = 1
+        elist[:, 1] = np.arange(2, n + 1)
+        shuffled = np.concatenate([elist, elist[:, ::-1]])
+        np.random.seed(824)
+        np.random.shuffle(shuffled)
+
+        G1 = cliquematch.Graph.from_edgelist(shuffled, n)
+        assert G1.n_vertices == n
+        assert G1.n_edges == n - 1
+        assert np.sum(G1.to_edgelist() != elist) == 0
+
     def test_adjlist(self):
         adjlist = [
             set(),
@@ -112,6 +134,28 @@ class TestGraph(object):
             {1, 3},
         ]
 
+        G3 = cliquematch.Graph.from_file(get_location("sample_read3.mtx"))
+        assert G3.n_vertices == 5
+        assert G3.n_edges == 6
+        assert G3.to_adjlist() == G2.to_adjlist()
+
+    def test_binary(self, tmp_path):
+        G1 = cliquematch.Graph.from_file(get_location("sample_read1.mtx"))
+        fname = str(tmp_path / "sample.bin")
+        G1.to_binary(fname)
+        G2 = cliquematch.Graph.from_binary(fname)
+        assert G2.n_vertices == 5
+        assert G2.n_edges == 6
+        assert G2.to_adjlist() == G1.to_adjlist()
+        assert G2.get_max_clique() == G1.get_max_clique()
+
+        # rewriting the file that G2 was loaded from
+        G2.to_binary(fname)
+        assert cliquematch.Graph.from_binary(fname).to_adjlist() == G1.to_adjlist()
+
+        with pytest.raises(RuntimeError):
+            G3 = cliquematch.Graph.from_binary(get_location("sample_read1.mtx"))
+
     def test_data(self):
         edges = np.array(
             [
@@ -176,6 +220,205 @@ class TestGraph(object):
         ans = G.get_max_clique(use_heuristic=False, use_dfs=True)
         assert ans == [1, 4, 5, 6, 7]
 
+    def test_parallel_dfs(self):
+        edges = np.array(
+            [
+                [2, 3],
+                [1, 3],
+                [1, 4],
+                [1, 5],
+                [1, 6],
+                [1, 7],
+                [4, 5],
+                [4, 6],
+                [4, 7],
+                [5, 6],
+                [5, 7],
+                [6, 7],
+                [2, 8],
+                [3, 8],
+            ],
+            dtype=np.uint32,
+        )
+
+        G = cliquematch.Graph.from_edgelist(edges, 8)
+        ans = G.get_max_clique(use_heuristic=False, use_dfs=True, n_threads=4)
+        assert ans == [1, 4, 5, 6, 7]
+        G.reset_search()
+        ans = G.get_max_clique(use_heuristic=False, use_dfs=True, n_threads=0)
+        assert ans == [1, 4, 5, 6, 7]
+
+    def test_parallel_steal(self):
+        # large enough that the root queue empties while the first roots are
+        # still being searched, so the idle threads steal from the others
+        np.random.seed(824)
+        adjmat = np.random.uniform(0, 1, (150, 150)) < 0.3
+        adjmat = np.logical_or(adjmat, adjmat.T)
+        np.fill_diagonal(adjmat, False)
+
+        G = cliquematch.Graph.from_matrix(adjmat)
+        full = G.get_max_clique(use_heuristic=False, use_dfs=True)
+        for n_threads in [4, 0]:
+            G.reset_search()
+            ans = G.get_max_clique(
+                use_heuristic=False, use_dfs=True, n_threads=n_threads
+            )
+            assert len(ans) == len(full)
+            assert all(adjmat[u - 1, v - 1] for u in ans for v in ans if u != v)
+
+    def test_python_threads(self):
+        # the searches release the GIL, and calls on one graph wait for each other
+        from concurrent.futures import ThreadPoolExecutor
+
+        edges = np.array(
+            [
+                [2, 3],
+                [1, 3],
+                [1, 4],
+                [1, 5],
+                [1, 6],
+                [1, 7],
+                [4, 5],
+                [4, 6],
+                [4, 7],
+                [5, 6],
+                [5, 7],
+                [6, 7],
+                [2, 8],
+                [3, 8],
+            ],
+            dtype=np.uint32,
+        )
+        G = cliquematch.Graph.from_edgelist(edges, 8)
+
+        def search(i):
+            H = cliquematch.Graph.from_edgelist(edges, 8)
+            ans = H.get_max_clique(use_heuristic=False, use_dfs=True)
+            assert G.to_edgelist().shape == (14, 2)
+            assert len(list(G.all_cliques(size=3))) == 11
+            return ans
+
+        with ThreadPoolExecutor(max_workers=4) as pool:
+            for ans in pool.map(search, range(8)):
+                assert ans == [1, 4, 5, 6, 7]
+
+    def test_coloring_dfs(self):
+        edges = np.array(
+            [
+                [2, 3],
+                [1, 3],
+                [1, 4],
+                [1, 5],
+                [1, 6],
+                [1, 7],
+                [4, 5],
+                [4, 6],
+                [4, 7],
+                [5, 6],
+                [5, 7],
+                [6, 7],
+                [2, 8],
+                [3, 8],
+            ],
+            dtype=np.uint32,
+        )
+
+        G = cliquematch.Graph.from_edgelist(edges, 8)
+        ans = G.get_max_clique(use_heuristic=False, use_dfs=True, use_coloring=True)
+        assert ans == [1, 4, 5, 6, 7]
+        G.reset_search()
+        ans = G.get_max_clique(
+            use_heuristic=False, use_dfs=True, time_limit=10, use_coloring=True
+        )
+        assert ans == [1, 4, 5, 6, 7]
+
+    def test_bitmatrix_dfs(self):
+        edges = np.array(
+            [
+                [2, 3],
+                [1, 3],
+                [1, 4],
+                [1, 5],
+                [1, 6],
+                [1, 7],
+                [4, 5],
+                [4, 6],
+                [4, 7],
+                [5, 6],
+                [5, 7],
+                [6, 7],
+                [2, 8],
+                [3, 8],
+            ],
+            dtype=np.uint32,
+        )
+
+        G = cliquematch.Graph.from_edgelist(edges, 8)
+        ans = G.get_max_clique(use_heuristic=False, use_dfs=True, use_bitmatrix=True)
+        assert ans == [1, 4, 5, 6, 7]
+        G.reset_search()
+        ans = G.get_max_clique(
+            use_heuristic=False, use_dfs=True, time_limit=10, use_bitmatrix=True
+        )
+        assert ans == [1, 4, 5, 6, 7]
+
+        c3 = list(x for x in G.all_cliques(size=3, use_bitmatrix=True))
+        assert len(c3) == len(list(x for x in G.all_cliques(size=3)))
+        c4 = list(x for x in G.all_cliques(size=4, use_bitmatrix=True))
+        assert len(c4) == 5
+        for x in c4:
+            assert set(x) < set(ans)
+
+    def test_continue_search(self):
+        np.random.seed(824)
+        adjmat = np.random.uniform(0, 1, (150, 150)) < 0.3
+        adjmat = np.logical_or(adjmat, adjmat.T)
+        np.fill_diagonal(adjmat, False)
+
+        G = cliquematch.Graph.from_matrix(adjmat)
+        full = G.get_max_clique(use_heuristic=False, use_dfs=True)
+
+        # the search is paused every 1024 nodes, and continued from there
+        G.reset_search()
+        ans = G.get_max_clique(use_heuristic=False, use_dfs=True, time_limit=1e-6)
+        n_calls = 1
+        while not G.search_done:
+            ans = G.get_max_clique(
+                use_heuristic=False, use_dfs=True, time_limit=1e-6, continue_search=True
+            )
+            n_calls += 1
+        assert n_calls > 1
+        assert len(ans) == len(full)
+        assert all(adjmat[u - 1, v - 1] for u in ans for v in ans if u != v)
+
+    def test_coloring_continue(self):
+        np.random.seed(824)
+        adjmat = np.random.uniform(0, 1, (150, 150)) < 0.5
+        adjmat = np.logical_or(adjmat, adjmat.T)
+        np.fill_diagonal(adjmat, False)
+
+        G = cliquematch.Graph.from_matrix(adjmat)
+        full = G.get_max_clique(use_heuristic=False, use_dfs=True, use_coloring=True)
+
+        # the coloring bound prunes more, so the graph has to be denser to pause
+        G.reset_search()
+        ans = G.get_max_clique(
+            use_heuristic=False, use_dfs=True, time_limit=1e-6, use_coloring=True
+        )
+        n_calls = 1
+        while not G.search_done:
+            ans = G.get_max_clique(
+                use_heuristic=False,
+                use_dfs=True,
+                time_limit=1e-6,
+                continue_search=True,
+                use_coloring=True,
+            )
+            n_calls += 1
+        assert n_calls > 1
+        assert len(ans) == len(full)
+        assert all(adjmat[u - 1, v - 1] for u in ans for v in ans if u != v)
+
     def test_reset_search(self):
         edges = np.array(
             [
@@ -241,3 +484,25 @@ class TestGraph(object):
         assert len(c4) == 5
         for x in c4:
             assert set(x) < set(ans)
+
+        for size in range(1, 6):
+            seq = sorted(G.all_cliques(size=size))
+            assert sorted(G.all_cliques(size=size, n_threads=3)) == seq
+            assert sorted(G.all_cliques(size=size, n_threads=0)) == seq
+        it = G.all_cliques(size=2, n_threads=2)
+        assert len(next(it)) == 2
+        del it
+
+        for size in range(1, 6):
+            seq = list(G.all_cliques(size=size))
+            it = G.all_cliques(size=size)
+            blocks = [it.next_batch(2) for _ in range(len(seq) // 2 + 2)]
+            assert all(b.shape[1] == size for b in blocks)
+            assert [list(x) for b in blocks for x in b] == seq
+            assert blocks[-1].shape == (0, size)
+
+        maximal = sorted(sorted(x) for x in G.all_maximal_cliques())
+        assert maximal == [[1, 3], [1, 4, 5, 6, 7], [2, 3, 8]]
+        assert list(G.all_maximal_cliques(min_size=4)) == [[1, 4, 5, 6, 7]]
+        verts, offsets = G.all_maximal_cliques().next_batch(10)
+        assert len(offsets) == len(maximal) + 1 and len(verts) == offsets[-1] == 10
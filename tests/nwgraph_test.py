@@ -170,6 +170,87 @@ class TestNWGraph(object):
         assert ans == [1, 4, 5, 6, 7]
         assert G.get_clique_weight(ans) == 15.5
 
+    def test_bitmatrix_dfs(self):
+        edges = np.array(
+            [
+                [2, 3],
+                [1, 3],
+                [1, 4],
+                [1, 5],
+                [1, 6],
+                [1, 7],
+                [4, 5],
+                [4, 6],
+                [4, 7],
+                [5, 6],
+                [5, 7],
+                [6, 7],
+                [2, 8],
+                [3, 8],
+            ],
+            dtype=np.uint32,
+        )
+        weights = np.full((8,), 3.1, dtype=np.float64)
+
+        G = cliquematch.NWGraph.from_edgelist(edges, 8, weights)
+        ans = G.get_max_clique(use_heuristic=False, use_dfs=True, use_bitmatrix=True)
+        assert ans == [1, 4, 5, 6, 7]
+        assert G.get_clique_weight(ans) == 15.5
+
+    def test_parallel_dfs(self):
+        edges = np.array(
+            [
+                [2, 3],
+                [1, 3],
+                [1, 4],
+                [1, 5],
+                [1, 6],
+                [1, 7],
+                [4, 5],
+                [4, 6],
+                [4, 7],
+                [5, 6],
+                [5, 7],
+                [6, 7],
+                [2, 8],
+                [3, 8],
+            ],
+            dtype=np.uint32,
+        )
+        weights = np.array([1, 9, 9, 1, 1, 1, 1, 9], dtype=np.float64)
+
+        G = cliquematch.NWGraph.from_edgelist(edges, 8, weights)
+        ans = G.get_max_clique(use_heuristic=False, use_dfs=True, n_threads=4)
+        assert ans == [2, 3, 8]
+        assert G.get_clique_weight(ans) == 27
+        G.reset_search()
+        ans = G.get_max_clique(use_heuristic=False, use_dfs=True, n_threads=0)
+        assert ans == [2, 3, 8]
+
+    def test_continue_search(self):
+        np.random.seed(824)
+        adjmat = np.random.uniform(0, 1, (150, 150)) < 0.3
+        adjmat = np.logical_or(adjmat, adjmat.T)
+        np.fill_diagonal(adjmat, False)
+        weights = np.random.uniform(1, 2, (150,))
+
+        G = cliquematch.NWGraph.from_matrix(adjmat, weights)
+        full = G.get_clique_weight(
+            G.get_max_clique(use_heuristic=False, use_dfs=True)
+        )
+
+        # the search is paused every 1024 nodes, and continued from there
+        G.reset_search()
+        ans = G.get_max_clique(use_heuristic=False, use_dfs=True, time_limit=1e-6)
+        n_calls = 1
+        while not G.search_done:
+            ans = G.get_max_clique(
+                use_heuristic=False, use_dfs=True, time_limit=1e-6, continue_search=True
+            )
+            n_calls += 1
+        assert n_calls > 1
+        assert abs(G.get_clique_weight(ans) - full) < 1e-9
+
     def test_reset_search(self):
         edges = np.array(
             [
@@ -236,3 +317,7 @@ class TestNWGraph(object):
         assert len(c4) == 5
         for x in c4:
             assert set(x) < set(ans)
+
+        verts, offsets = G.all_cliques(size=0.4).next_batch(10)
+        assert len(offsets) == len(c4) + 1
+        assert [list(verts[offsets[i] : offsets[i + 1]]) for i in range(5)] == c4
@@ -125,6 +125,32 @@ class TestA2AGraph(object):
         subset.sort()
         assert ans[0] == subset
 
+    def test_edge_within(self):
+        S1 = self.S1
+        S2 = self.S2
+        subset = list(x for x in range(20))
+        random.shuffle(subset)
+        subset = subset[:10]
+        S2 = S1[subset, :] + [1, 1]
+        with warnings.catch_warnings():
+            warnings.simplefilter("ignore")
+            G1 = cliquematch.A2AGraph(S1, S2)
+            G2 = cliquematch.A2AGraph(S1, S2)
+        G1.epsilon = 0.001
+        G2.epsilon = 0.001
+        G1.build_edges()
+        # every pair is within max_dist, so the graph is the same
+        G2.build_edges(max_dist=1000)
+        assert G1.n_edges == G2.n_edges
+        assert np.all(G1.to_edgelist() == G2.to_edgelist())
+
+        # edges only come from pairs of S1 within max_dist
+        G2.build_edges(max_dist=30)
+        assert G2.n_edges < G1.n_edges
+        for u, v in G2.to_edgelist():
+            i, j = (u - 1) // len(S2), (v - 1) // len(S2)
+            assert eucd(S1, i, j) <= 30 + 1e-9
+
     def test_heuristic(self):
         S1 = self.S1
         S2 = self.S2
@@ -231,6 +257,9 @@ class TestA2AGraph(object):
         c9 = list(x for x in G.all_correspondences(size=len(ans[0]) - 1))
         if len(c9) != len(ans[0]):
             warnings.warn("possible clique enumeration error", Warning)
+        b1, b2 = G.all_correspondences(size=len(ans[0]) - 1).next_batch(len(c9) + 1)
+        assert b1.shape == (len(c9), len(ans[0]) - 1) and b1.shape == b2.shape
+        assert [(list(x), list(y)) for x, y in zip(b1, b2)] == c9
 
         c9b = list(
             x for x in G.all_correspondences(size=len(ans[0]) - 1, return_indices=False)
@@ -47,3 +47,33 @@ class TestIsoGraph(object):
             assert len(g1[k]) == len(g2[mapping[k]])
             t = set(mapping[x] for x in g1[k])
             assert t == g2[mapping[k]]
+
+    def test_filtered(self):
+        G = cliquematch.IsoGraph(self.S1, self.S2)
+        G.build_edges()
+        H = cliquematch.IsoGraph(self.S1, self.S2)
+        H.build_edges(use_degree=True)
+        assert H.n_vertices < G.n_vertices
+        ans = H.get_correspondence(return_indices=True)
+        assert set(ans[0]) == {1, 2, 3, 4, 5}
+        assert set(ans[1]) == {1, 2, 3, 4, 5}
+        g1, g2, mapping = H.get_correspondence(return_indices=False)
+        for k in mapping.keys():
+            assert len(g1[k]) == len(g2[mapping[k]])
+            t = set(mapping[x] for x in g1[k])
+            assert t == g2[mapping[k]]
+
+    def test_labels(self):
+        # vertex 1 of S1 and vertex 2 of S2 are the only ones with degree > 2
+        labels1 = ["hub", "x", "x", "x", "x"]
+        labels2 = ["x", "hub", "x", "x", "x"]
+        G = cliquematch.IsoGraph(self.S1, self.S2)
+        G.build_edges(labels1=labels1, labels2=labels2)
+        ans = G.get_correspondence(return_indices=True)
+        assert len(ans[0]) == 5
+        for i, j in zip(ans[0], ans[1]):
+            assert labels1[i - 1] == labels2[j - 1]
+        with pytest.raises(RuntimeError):
+            G.build_edges(labels1=labels1)
+        with pytest.raises(RuntimeError):
+            G.build_edges(labels1=["a"] * 5, labels2=["b"] * 5)
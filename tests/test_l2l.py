@@ -127,3 +127,65 @@ class TestL2LGraph(object):
         cf = dummy2(3, 0.01)
         G.build_edges_with_condition(condition_func=cf, use_cfunc_only=True)
         G.build_edges_with_condition(condition_func=cf, use_cfunc_only=False)
+
+    def test_edge_batched(self):
+        np.random.seed(824)
+        S1 = np.float64(np.random.uniform(0, 100, (20, 2)))
+        subset = list(x for x in range(20))
+        random.shuffle(subset)
+        subset = subset[:10]
+        S2 = S1[subset, :]
+        S1 = S1.tolist()
+        S2 = S2.tolist()
+
+        def batch_eucd(mat, i, j):
+            mat = np.array(mat, np.float64)
+            return np.sqrt(np.sum((mat[i, :] - mat[j, :]) ** 2, axis=1))
+
+        def batch_cf(mat1, i1, j1, mat2, i2, j2):
+            mat1 = np.array(mat1, np.float64)
+            mat2 = np.array(mat2, np.float64)
+            ans1 = batch_eucd(mat1, i1, j1)
+            ans2 = batch_eucd(mat2, i2, j2)
+            return np.abs(ans1 - ans2) < 0.01
+
+        G1 = cliquematch.L2LGraph(S1, S2, eucd, eucd)
+        G1.epsilon = 0.001
+        G1.build_edges()
+        G2 = cliquematch.L2LGraph(S1, S2, batch_eucd, batch_eucd)
+        G2.epsilon = 0.001
+        G2.build_edges(batch_size=64)
+        assert G1.n_edges == G2.n_edges
+        assert np.all(G1.to_edgelist() == G2.to_edgelist())
+
+        cf = dummy2(2, 0.01)
+        for use_cfunc_only in [True, False]:
+            G1.build_edges_with_condition(cf, use_cfunc_only)
+            G2.build_edges_with_condition(batch_cf, use_cfunc_only, batch_size=1000)
+            assert G1.n_edges == G2.n_edges
+            assert np.all(G1.to_edgelist() == G2.to_edgelist())
+
+        # the batched function has to return one value per pair
+        G2.d1 = lambda mat, i, j: np.zeros(1)
+        with pytest.raises(RuntimeError):
+            G2.build_edges(batch_size=64)
+
+    def test_edge_keyed(self):
+        np.random.seed(824)
+        S1 = np.float64(np.random.uniform(0, 100, (20, 2)))
+        subset = list(x for x in range(20))
+        random.shuffle(subset)
+        subset = subset[:10]
+        S2 = S1[subset, :]
+        S1 = S1.tolist()
+        S2 = S2.tolist()
+
+        G1 = cliquematch.L2LGraph(S1, S2, eucd, eucd)
+        G2 = cliquematch.L2LGraph(S1, S2, eucd, eucd)
+        # the euclidean distances differ by less than 0.01 if cf is True
+        cf = dummy2(2, 0.01)
+        G1.build_edges_with_condition(cf, True)
+        G2.build_edges_with_condition(cf, True, key1=eucd, key_tolerance=0.02)
+        assert G1.n_edges == G2.n_edges
+        assert np.all(G1.to_edgelist() == G2.to_edgelist())
+        assert G1.get_correspondence() == G2.get_correspondence()